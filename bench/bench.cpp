@@ -0,0 +1,617 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include "devbuild_generator.h"
+#include "../src/chgen/chgen.h"
+#include "../src/data/changelog_binary.h"
+#include "../src/submit/submit.h"
+#include "../src/transfer/merge.h"
+#include "../src/transfer/transfer.h"
+#include "../src/utils/compression.h"
+#include "../src/utils/dirscan.h"
+#include "../src/utils/error.h"
+#include "../src/utils/print.h"
+#include "../src/utils/utils.h"
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Number of heap allocations made by the process, counted by the replaced operator new
+ */
+std::atomic<size_t> allocation_count{0};
+
+void *operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size != 0 ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+// the default memory resource of std::pmr allocates through the aligned overloads
+
+void *operator new(size_t size, std::align_val_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    const auto align = static_cast<size_t>(alignment);
+    if (void *pointer = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+/**
+ * @brief Timings of one benchmark case, in nanoseconds.
+ */
+struct CaseResult {
+    std::string name_;
+    std::vector<int64_t> samples_;
+    /**
+     * @brief Size of the output of the case, for the cases that produce one
+     */
+    size_t output_bytes_ = 0;
+    /**
+     * @brief Heap allocations of one run, for the cases that count them
+     */
+    size_t allocations_ = 0;
+
+    int64_t min() const {
+        return *std::min_element(samples_.begin(), samples_.end());
+    }
+
+    int64_t max() const {
+        return *std::max_element(samples_.begin(), samples_.end());
+    }
+
+    int64_t mean() const {
+        return std::accumulate(samples_.begin(), samples_.end(), int64_t{0}) / static_cast<int64_t>(samples_.size());
+    }
+
+    int64_t median() const {
+        auto sorted = samples_;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+};
+
+struct BenchOptions {
+    bench::GeneratorOptions generator_;
+    int iterations_ = 5;
+    /**
+     * @brief Number of entries of the changelog built by the allocation cases
+     */
+    int changelog_entries_ = 50000;
+    std::string output_ = "cu_submitter_bench.json";
+    std::string workdir_ = std::string(fs::temp_directory_path() / fs::path("cu_submitter_bench"));
+    bool keep_ = false;
+};
+
+/**
+ * @brief Runs a case several times
+ * @param setup Called before each run, outside of the measurement. May be null.
+ * @param run The measured code
+ */
+CaseResult run_case(const std::string &name, int iterations, const std::function<void(int)> &setup,
+                    const std::function<void(int)> &run) {
+    CaseResult result;
+    result.name_ = name;
+
+    for (int i = 0; i < iterations; i++) {
+        if (setup) {
+            setup(i);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        run(i);
+        const auto end = std::chrono::steady_clock::now();
+
+        result.samples_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-28s median %10.3f ms  min %10.3f ms  max %10.3f ms", name.c_str(),
+                  static_cast<double>(result.median()) / 1e6, static_cast<double>(result.min()) / 1e6,
+                  static_cast<double>(result.max()) / 1e6);
+    print(line);
+
+    return result;
+}
+
+/**
+ * @brief Fills a changelog with database entries and assets, as a scan of a large devbuild would
+ * @param entries Total number of entries, spread over the database tables and the asset categories
+ */
+void fill_changelog(data::Changelog &changelog, int entries) {
+    const auto allocator = changelog.get_allocator();
+    // names are formatted in one reused buffer, so that only the changelog allocates
+    std::string buffer;
+    const auto name = [&buffer](const char *prefix, int i) -> std::string_view {
+        buffer.assign(prefix);
+        buffer += " entry name ";
+        buffer += std::to_string(i);
+        return buffer;
+    };
+
+    for (int i = 0; i < entries; i++) {
+        const auto status = i % 3 == 0 ? data::ADDED : data::MODIFIED;
+        const auto id = static_cast<unsigned int>(i + 1);
+
+        switch (i % 6) {
+            case 0: {
+                data::CommonEvent entry(allocator);
+                entry.status_ = status;
+                entry.id_ = id;
+                entry.name_ = name("Common event", i);
+                changelog.common_events_.push_back(std::move(entry));
+                break;
+            }
+            case 1: {
+                data::TilesetInfo entry(allocator);
+                entry.status_ = status;
+                entry.id_ = id;
+                entry.name_ = name("Tileset", i);
+                entry.chipset_name_ = changelog.strings_.intern(name("Chipset", i));
+                changelog.tilesets_.push_back(std::move(entry));
+                break;
+            }
+            case 2: {
+                data::Switch entry(allocator);
+                entry.status_ = status;
+                entry.id_ = id;
+                entry.name_ = name("Switch", i);
+                changelog.switches_.push_back(std::move(entry));
+                break;
+            }
+            case 3: {
+                data::Variable entry(allocator);
+                entry.status_ = status;
+                entry.id_ = id;
+                entry.name_ = name("Variable", i);
+                changelog.variables_.push_back(std::move(entry));
+                break;
+            }
+            case 4: {
+                data::Animation entry(allocator);
+                entry.status_ = status;
+                entry.id_ = id;
+                entry.name_ = name("Animation", i);
+                entry.animation_name_ = changelog.strings_.intern(name("Battle animation", i));
+                changelog.animations_.push_back(std::move(entry));
+                break;
+            }
+            default: {
+                data::Asset asset(allocator);
+                asset.status_ = status;
+                asset.category_ = data::PICTURE;
+                asset.name_ = changelog.strings_.intern(name("Picture", i));
+                buffer += ".png";
+                asset.filename_ = changelog.strings_.intern(buffer);
+                changelog.pictures_.push_back(std::move(asset));
+                break;
+            }
+        }
+    }
+}
+
+bool parse_options(int argc, char *argv[], BenchOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string option = argv[i];
+
+        if (option == "--keep") {
+            options.keep_ = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            error("Missing value for " + option);
+            return false;
+        }
+        const std::string value = argv[++i];
+
+        try {
+            if (option == "--maps") {
+                options.generator_.maps_ = std::stoi(value);
+            } else if (option == "--events") {
+                options.generator_.events_per_map_ = std::stoi(value);
+            } else if (option == "--commands") {
+                options.generator_.commands_per_page_ = std::stoi(value);
+            } else if (option == "--assets") {
+                options.generator_.assets_per_category_ = std::stoi(value);
+            } else if (option == "--asset-size") {
+                options.generator_.asset_size_ = std::stoi(value);
+            } else if (option == "--db-size") {
+                const int size = std::stoi(value);
+                options.generator_.common_events_ = size;
+                options.generator_.tilesets_ = size;
+                options.generator_.switches_ = size;
+                options.generator_.variables_ = size;
+                options.generator_.animations_ = size;
+            } else if (option == "--modified-ratio") {
+                options.generator_.modified_ratio_ = std::stod(value);
+            } else if (option == "--changelog-entries") {
+                options.changelog_entries_ = std::max(0, std::stoi(value));
+            } else if (option == "--iterations") {
+                options.iterations_ = std::max(1, std::stoi(value));
+            } else if (option == "--output") {
+                options.output_ = value;
+            } else if (option == "--workdir") {
+                options.workdir_ = value;
+            } else {
+                error("Unknown option " + option);
+                return false;
+            }
+        } catch (const std::exception &) {
+            error("Invalid value for " + option + ": " + value);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void write_results(const BenchOptions &options, const std::vector<CaseResult> &results) {
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+
+    writer.StartObject();
+
+    writer.String("devbuild");
+    writer.StartObject();
+    writer.String("maps");
+    writer.Int(options.generator_.maps_);
+    writer.String("events_per_map");
+    writer.Int(options.generator_.events_per_map_);
+    writer.String("pages_per_event");
+    writer.Int(options.generator_.pages_per_event_);
+    writer.String("commands_per_page");
+    writer.Int(options.generator_.commands_per_page_);
+    writer.String("common_events");
+    writer.Int(options.generator_.common_events_);
+    writer.String("switches");
+    writer.Int(options.generator_.switches_);
+    writer.String("variables");
+    writer.Int(options.generator_.variables_);
+    writer.String("assets_per_category");
+    writer.Int(options.generator_.assets_per_category_);
+    writer.String("asset_size");
+    writer.Int(options.generator_.asset_size_);
+    writer.String("modified_ratio");
+    writer.Double(options.generator_.modified_ratio_);
+    writer.String("seed");
+    writer.Uint(options.generator_.seed_);
+    writer.EndObject();
+
+    writer.String("iterations");
+    writer.Int(options.iterations_);
+    writer.String("changelog_entries");
+    writer.Int(options.changelog_entries_);
+
+    writer.String("cases");
+    writer.StartArray();
+    for (const auto &result: results) {
+        writer.StartObject();
+        writer.String("name");
+        writer.String(result.name_.c_str());
+        writer.String("min_ns");
+        writer.Int64(result.min());
+        writer.String("median_ns");
+        writer.Int64(result.median());
+        writer.String("mean_ns");
+        writer.Int64(result.mean());
+        writer.String("max_ns");
+        writer.Int64(result.max());
+        if (result.output_bytes_ != 0) {
+            writer.String("output_bytes");
+            writer.Uint64(result.output_bytes_);
+        }
+        if (result.allocations_ != 0) {
+            writer.String("allocations");
+            writer.Uint64(result.allocations_);
+        }
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+
+    std::ofstream file(options.output_);
+    file << buffer.GetString() << '\n';
+    if (!file) {
+        error("Could not write " + options.output_);
+    }
+}
+
+/**
+ * @program cu_submitter_bench
+ * @brief Generates a synthetic base and modified devbuild, then times the core operations on them.
+ */
+int main(int argc, char *argv[]) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        print("USAGE: cu_submitter_bench [--maps <n>] [--events <n>] [--commands <n>] [--assets <n>] "
+              "[--asset-size <bytes>] [--db-size <n>] [--modified-ratio <r>] [--changelog-entries <n>] [--iterations <n>] "
+              "[--output <file.json>] [--workdir <path>] [--keep]");
+        return 1;
+    }
+
+    const fs::path workdir = options.workdir_;
+    const std::string base_path = workdir / fs::path("base");
+    const std::string modified_path = workdir / fs::path("modified");
+
+    fs::remove_all(workdir);
+
+    print("Generating devbuilds in " + options.workdir_ + "...");
+    const bench::DevbuildGenerator generator(options.generator_);
+    if (!generator.generateBase(base_path) || !generator.generateModified(base_path, modified_path)) {
+        error("Could not generate the devbuilds");
+        return 1;
+    }
+
+    std::vector<CaseResult> results;
+    const int iterations = options.iterations_;
+
+    // changelog generation
+    std::shared_ptr<data::Changelog> changelog;
+    results.push_back(run_case("scan", iterations, nullptr, [&](int) {
+        changelog = chgen::ChangelogGenerator::scan(base_path, modified_path);
+    }));
+    if (!changelog) {
+        error("Could not scan the devbuilds");
+        return 1;
+    }
+
+    // the modified side of a scan only, as every scan of a batch but the first one
+    const auto base = chgen::BaseBuild::load(base_path);
+    results.push_back(run_case("scan_shared_base", iterations, nullptr, [&](int) {
+        chgen::ChangelogGenerator::scan(*base, modified_path);
+    }));
+
+    const std::vector<std::string> batch(4, modified_path);
+    results.push_back(run_case("scan_batch_4", iterations, nullptr, [&](int) {
+        chgen::ChangelogGenerator::scanBatch(base_path, batch);
+    }));
+
+    const std::vector<std::string> asset_folders = [] {
+        std::vector<std::string> folders;
+        for (const auto category: data::asset_categories()) {
+            folders.push_back(data::asset_folder(category));
+        }
+        return folders;
+    }();
+
+    utils::BuildListing base_listing;
+    utils::BuildListing modified_listing;
+    results.push_back(run_case("list_build", iterations, nullptr, [&](int) {
+        base_listing = utils::listBuild(base_path, asset_folders);
+        modified_listing = utils::listBuild(modified_path, asset_folders);
+    }));
+
+    results.push_back(run_case("add_assets", iterations, nullptr, [&](int) {
+        data::StringPool strings;
+        for (const auto category: data::asset_categories()) {
+            chgen::add_assets(base_path, modified_path, base_listing, modified_listing, category, strings);
+        }
+    }));
+
+    // every asset that exists in both builds, as the scan would compare it
+    std::vector<std::pair<std::string, std::string>> compared_files;
+    for (const auto &folder: asset_folders) {
+        for (const auto &file: modified_listing.folder(folder).entries_) {
+            if (base_listing.folder(folder).find(file.name_)) {
+                compared_files.emplace_back(std::string(fs::path(base_path) / folder / file.name_),
+                                            std::string(fs::path(modified_path) / folder / file.name_));
+            }
+        }
+    }
+
+    results.push_back(run_case("compare_files", iterations, nullptr, [&](int) {
+        for (const auto &[base_file, modified_file]: compared_files) {
+            utils::compareFiles(base_file, modified_file);
+        }
+    }));
+
+    // changelog construction and destruction, with the default allocator and in an arena
+    size_t allocations = 0;
+    results.push_back(run_case("changelog_heap", iterations, nullptr, [&](int) {
+        const size_t before = allocation_count.load();
+        {
+            const auto built = std::make_shared<data::Changelog>();
+            fill_changelog(*built, options.changelog_entries_);
+        }
+        allocations = allocation_count.load() - before;
+    }));
+    results.back().allocations_ = allocations;
+
+    results.push_back(run_case("changelog_arena", iterations, nullptr, [&](int) {
+        const size_t before = allocation_count.load();
+        {
+            const auto built = data::Changelog::withArena();
+            fill_changelog(*built, options.changelog_entries_);
+        }
+        allocations = allocation_count.load() - before;
+    }));
+    results.back().allocations_ = allocations;
+
+    // changelog output
+    size_t output_bytes = 0;
+    results.push_back(run_case("stringify", iterations, nullptr, [&](int) {
+        output_bytes = changelog->stringify().size();
+    }));
+    results.back().output_bytes_ = output_bytes;
+
+    results.push_back(run_case("serialize", iterations, nullptr, [&](int) {
+        rapidjson::StringBuffer buffer;
+        data::Writer writer(buffer);
+        changelog->Serialize(writer);
+        output_bytes = buffer.GetSize();
+    }));
+    results.back().output_bytes_ = output_bytes;
+
+    // response compression of the JSON changelog, on the fly and served from an already compressed body
+    rapidjson::StringBuffer json_buffer;
+    data::Writer json_writer(json_buffer);
+    changelog->Serialize(json_writer);
+    const std::string_view json(json_buffer.GetString(), json_buffer.GetSize());
+
+    for (const auto encoding: {compression::GZIP, compression::ZSTD}) {
+        if (!compression::available(encoding)) {
+            continue;
+        }
+        const std::string encoding_name = compression::encodingName(encoding);
+
+        std::string compressed;
+        results.push_back(run_case("compress_" + encoding_name, iterations, nullptr, [&](int) {
+            compressed = compression::compress(json, encoding);
+        }));
+        results.back().output_bytes_ = compressed.size();
+
+        if (compression::decompress(compressed, encoding) != json) {
+            error("The " + encoding_name + " body does not decompress to the JSON changelog");
+            return 1;
+        }
+
+        std::string body;
+        results.push_back(run_case("cached_" + encoding_name, iterations, nullptr, [&](int) {
+            body.assign(compressed);
+        }));
+        results.back().output_bytes_ = body.size();
+    }
+
+    std::string binary;
+    results.push_back(run_case("binary_encode", iterations, nullptr, [&](int) {
+        binary = data::encodeBinary(*changelog);
+    }));
+    results.back().output_bytes_ = binary.size();
+
+    std::shared_ptr<data::Changelog> decoded;
+    results.push_back(run_case("binary_decode", iterations, nullptr, [&](int) {
+        decoded = data::BinaryChangelog::view(binary)->decode();
+    }));
+
+    // the binary format must give back the same changelog
+    if (*decoded != *changelog || decoded->stringify() != changelog->stringify()) {
+        error("The binary changelog does not round-trip");
+        return 1;
+    }
+
+    const auto binary_path = workdir / fs::path("changelog.cucl");
+    if (!data::writeBinary(*changelog, binary_path)) {
+        return 1;
+    }
+
+    results.push_back(run_case("binary_open", iterations, nullptr, [&](int) {
+        decoded = data::BinaryChangelog::open(binary_path)->decode();
+    }));
+
+    if (*decoded != *changelog) {
+        error("The mapped binary changelog does not round-trip");
+        return 1;
+    }
+
+    // transfer into a fresh copy of the base build
+    if (!transfer::DevbuildTransferer::getTransferChangelog(base_path, modified_path)) {
+        error("Could not scan the transfer");
+        return 1;
+    }
+
+    const std::string destination_path = workdir / fs::path("destination");
+    results.push_back(run_case("transfer", iterations, [&](int) {
+        fs::remove_all(destination_path);
+        fs::copy(base_path, destination_path, fs::copy_options::recursive);
+    }, [&](int) {
+        transfer::DevbuildTransferer::transfer(destination_path);
+    }));
+
+    // the same transfer into 4 copies, each origin file read once
+    std::vector<std::string> destination_paths;
+    for (int i = 0; i < 4; i++) {
+        destination_paths.push_back(workdir / fs::path("destination_" + std::to_string(i)));
+    }
+    results.push_back(run_case("transfer_fanout_4", iterations, [&](int) {
+        for (const auto &path: destination_paths) {
+            fs::remove_all(path);
+            fs::copy(base_path, path, fs::copy_options::recursive);
+        }
+    }, [&](int) {
+        transfer::DevbuildTransferer::transfer(destination_paths);
+    }));
+
+    // three-way merge into a destination that only edited the events of a map the origin changed: its map tree entry
+    // is the same as in the base, so the destination scan leaves the map out, and the merge must still refuse it
+    const auto merged_map = std::find_if(changelog->maps_.begin(), changelog->maps_.end(), [](const data::Map &map) {
+        return map.status_ == data::Status::MODIFIED;
+    });
+    if (merged_map != changelog->maps_.end()) {
+        const int map_id = static_cast<int>(merged_map->id_);
+        const std::string merge_destination_path = workdir / fs::path("merge_destination");
+        fs::copy(base_path, merge_destination_path, fs::copy_options::recursive);
+        if (!generator.editMapEvents(merge_destination_path, map_id)) {
+            return 1;
+        }
+
+        std::shared_ptr<transfer::MergeReport> report;
+        results.push_back(run_case("merge", iterations, nullptr, [&](int) {
+            report = transfer::ThreeWayMerge::merge(*base, modified_path, merge_destination_path);
+        }));
+
+        const bool conflict = report && std::any_of(report->entries_.begin(), report->entries_.end(),
+                                                    [map_id](const transfer::MergeEntry &entry) {
+            return entry.category_ == "maps" && entry.key_ == data::id_string(map_id) &&
+                   entry.status_ == transfer::MergeStatus::CONFLICT;
+        });
+        if (!conflict) {
+            error("The merge does not report the events of map " + data::id_string(map_id) +
+                  ", edited in the destination, as a conflict");
+            return 1;
+        }
+    }
+
+    // submission into a fresh archive folder
+    if (!submit::SubmissionBuilder::getSubmissionChangelog(base_path, modified_path)) {
+        error("Could not scan the submission");
+        return 1;
+    }
+
+    const std::string archive_path = workdir / fs::path("submission");
+    results.push_back(run_case("submit", iterations, [&](int) {
+        fs::remove_all(archive_path);
+    }, [&](int) {
+        submit::SubmissionBuilder::submit(archive_path);
+    }));
+
+    write_results(options, results);
+    print("Results written to " + options.output_);
+
+    if (!options.keep_) {
+        fs::remove_all(workdir);
+    }
+
+    return 0;
+}
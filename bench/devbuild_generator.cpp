@@ -0,0 +1,330 @@
+#include "devbuild_generator.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <lcf/ldb/reader.h>
+#include <lcf/lmt/reader.h>
+#include <lcf/lmu/reader.h>
+
+#include "../src/chgen/map_index.h"
+#include "../src/data/changelog.h"
+#include "../src/utils/error.h"
+
+namespace fs = std::filesystem;
+
+using Commands = lcf::rpg::EventCommand::Code;
+
+namespace bench {
+
+    lcf::rpg::EventCommand make_command(Commands code, int indent, const std::string &string,
+                                        std::initializer_list<int32_t> parameters) {
+        lcf::rpg::EventCommand command;
+        command.code = static_cast<int32_t>(code);
+        command.indent = indent;
+        command.string = lcf::DBString(string);
+        command.parameters = lcf::DBArray<int32_t>(parameters);
+        return command;
+    }
+
+    std::string track_name(int track) {
+        return "track_" + data::id_string(track);
+    }
+
+    /**
+     * @brief Builds a map whose events mostly show messages, with some BGM changes and warps
+     */
+    lcf::rpg::Map make_map(const GeneratorOptions &options, int map_id, std::mt19937 &rng) {
+        lcf::rpg::Map map;
+        map.width = options.map_width_;
+        map.height = options.map_height_;
+
+        const auto tiles = static_cast<size_t>(options.map_width_) * static_cast<size_t>(options.map_height_);
+        map.lower_layer.resize(tiles);
+        map.upper_layer.resize(tiles);
+        for (size_t i = 0; i < tiles; i++) {
+            map.lower_layer[i] = static_cast<int16_t>(rng() % 5000);
+            map.upper_layer[i] = static_cast<int16_t>(10000 + rng() % 144);
+        }
+
+        std::uniform_int_distribution<int> x_distribution(0, options.map_width_ - 1);
+        std::uniform_int_distribution<int> y_distribution(0, options.map_height_ - 1);
+        std::uniform_int_distribution<int> map_distribution(1, std::max(options.maps_, 1));
+        std::uniform_int_distribution<int> kind_distribution(0, 19);
+
+        for (int e = 0; e < options.events_per_map_; e++) {
+            lcf::rpg::Event event;
+            event.ID = e + 1;
+            event.name = lcf::DBString("EV" + data::id_string(e + 1));
+            event.x = x_distribution(rng);
+            event.y = y_distribution(rng);
+
+            for (int p = 0; p < options.pages_per_event_; p++) {
+                lcf::rpg::EventPage page;
+                page.ID = p + 1;
+
+                for (int c = 0; c < options.commands_per_page_; c++) {
+                    const int kind = kind_distribution(rng);
+
+                    if (kind == 0) {
+                        page.event_commands.push_back(make_command(Commands::PlayBGM, 0,
+                                                                   track_name(static_cast<int>(rng() % 300)),
+                                                                   {0, 100, 100, 50}));
+                    } else if (kind == 1) {
+                        int destination = map_distribution(rng);
+                        if (destination == map_id) {
+                            destination = destination % std::max(options.maps_, 1) + 1;
+                        }
+                        page.event_commands.push_back(make_command(Commands::Teleport, 0, "",
+                                                                   {destination, x_distribution(rng),
+                                                                    y_distribution(rng), 0}));
+                    } else {
+                        page.event_commands.push_back(make_command(Commands::ShowMessage, 0,
+                                                                   "Message " + std::to_string(rng()), {}));
+                    }
+                }
+
+                page.event_commands.push_back(make_command(Commands::END, 0, "", {}));
+                event.pages.push_back(page);
+            }
+
+            map.events.push_back(event);
+        }
+
+        return map;
+    }
+
+    lcf::rpg::MapInfo make_map_info(int map_id, const std::string &name, int track) {
+        lcf::rpg::MapInfo info;
+        info.ID = map_id;
+        info.name = lcf::DBString(data::id_string(map_id) + " " + name);
+        info.parent_map = 0;
+        info.indentation = 1;
+        info.type = 1;
+        info.music.name = track_name(track);
+        return info;
+    }
+
+    bool write_asset(const fs::path &path, int size, std::mt19937 &rng) {
+        std::vector<char> content(static_cast<size_t>(size));
+        for (auto &byte: content) {
+            byte = static_cast<char>(rng());
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        return static_cast<bool>(file);
+    }
+
+    std::string asset_filename(int index) {
+        return "asset_" + data::id_string(index) + ".png";
+    }
+
+    template<typename T>
+    void fill_table(std::vector<T> &table, int size, const std::string &prefix) {
+        table.resize(static_cast<size_t>(size));
+        for (int i = 0; i < size; i++) {
+            table[i].ID = i + 1;
+            // the last tenth is left blank, so that the modified build can add entries
+            if (i < size - size / 10) {
+                table[i].name = lcf::DBString(prefix + " " + data::id_string(i + 1));
+            }
+        }
+    }
+
+    /**
+     * @brief Renames, blanks or fills a share of the entries of a database table
+     */
+    template<typename T>
+    void modify_table(std::vector<T> &table, double ratio, std::mt19937 &rng, const std::string &prefix) {
+        std::bernoulli_distribution modified(ratio);
+
+        for (auto &entry: table) {
+            if (!modified(rng)) {
+                continue;
+            }
+
+            if (entry.name.empty()) {
+                entry.name = lcf::DBString(prefix + " added " + data::id_string(entry.ID));
+            } else if (rng() % 5 == 0) {
+                entry.name = lcf::DBString("");
+            } else {
+                entry.name = lcf::DBString(std::string(entry.name.data()) + " v2");
+            }
+        }
+    }
+
+    DevbuildGenerator::DevbuildGenerator(GeneratorOptions options) : options_(options) {
+    }
+
+    bool DevbuildGenerator::generateBase(const std::string &path) const {
+        std::mt19937 rng(options_.seed_);
+
+        fs::create_directories(path);
+
+        // map tree and maps
+        lcf::rpg::TreeMap tree;
+        lcf::rpg::MapInfo root;
+        root.ID = 0;
+        root.name = lcf::DBString("Collective Unconscious");
+        root.type = 0;
+        tree.maps.push_back(root);
+        tree.tree_order.push_back(0);
+
+        for (int map_id = 1; map_id <= options_.maps_; map_id++) {
+            tree.maps.push_back(make_map_info(map_id, "World " + std::to_string(map_id), map_id % 300));
+            tree.tree_order.push_back(map_id);
+
+            const auto map = make_map(options_, map_id, rng);
+            const auto map_path = std::string(path / fs::path(chgen::MapIndex::filename(map_id)));
+
+            if (!lcf::LMU_Reader::Save(lcf::ToStringView(map_path), map, lcf::EngineVersion::e2k3)) {
+                error("Could not write " + map_path);
+                return false;
+            }
+        }
+
+        const auto lmt_path = std::string(path / fs::path("RPG_RT.lmt"));
+        if (!lcf::LMT_Reader::Save(lcf::ToStringView(lmt_path), tree, lcf::EngineVersion::e2k3)) {
+            error("Could not write " + lmt_path);
+            return false;
+        }
+
+        // database
+        lcf::rpg::Database db;
+        fill_table(db.commonevents, options_.common_events_, "CE");
+        fill_table(db.chipsets, options_.tilesets_, "Tileset");
+        fill_table(db.switches, options_.switches_, "Switch");
+        fill_table(db.variables, options_.variables_, "Variable");
+        fill_table(db.animations, options_.animations_, "Animation");
+
+        for (auto &ce: db.commonevents) {
+            ce.trigger = lcf::rpg::CommonEvent::Trigger::Trigger_call;
+        }
+
+        const auto ldb_path = std::string(path / fs::path("RPG_RT.ldb"));
+        lcf::LDB_Reader::PrepareSave(db);
+        if (!lcf::LDB_Reader::Save(lcf::ToStringView(ldb_path), db)) {
+            error("Could not write " + ldb_path);
+            return false;
+        }
+
+        // assets
+        for (const auto category: data::asset_categories()) {
+            const auto folder = path / fs::path(data::asset_folder(category));
+            fs::create_directories(folder);
+
+            for (int i = 0; i < options_.assets_per_category_; i++) {
+                if (!write_asset(folder / asset_filename(i), options_.asset_size_, rng)) {
+                    error("Could not write " + std::string(folder / asset_filename(i)));
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool DevbuildGenerator::generateModified(const std::string &base_path, const std::string &path) const {
+        std::mt19937 rng(options_.seed_ + 1);
+        std::bernoulli_distribution modified(options_.modified_ratio_);
+
+        // a fresh copy: every last write time changes, most contents don't
+        fs::create_directories(path);
+        fs::copy(base_path, path, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+
+        // maps: edited maps get new events and a new map tree entry
+        auto tree = lcf::LMT_Reader::Load(std::string(path / fs::path("RPG_RT.lmt")));
+        if (!tree) {
+            error("Could not read the generated map tree");
+            return false;
+        }
+
+        for (int map_id = 1; map_id <= options_.maps_ && map_id < static_cast<int>(tree->maps.size()); map_id++) {
+            if (!modified(rng)) {
+                continue;
+            }
+
+            tree->maps[map_id].music.name = track_name(static_cast<int>(rng() % 300));
+
+            const auto map = make_map(options_, map_id, rng);
+            const auto map_path = std::string(path / fs::path(chgen::MapIndex::filename(map_id)));
+
+            if (!lcf::LMU_Reader::Save(lcf::ToStringView(map_path), map, lcf::EngineVersion::e2k3)) {
+                error("Could not write " + map_path);
+                return false;
+            }
+        }
+
+        const auto lmt_path = std::string(path / fs::path("RPG_RT.lmt"));
+        if (!lcf::LMT_Reader::Save(lcf::ToStringView(lmt_path), *tree, lcf::EngineVersion::e2k3)) {
+            error("Could not write " + lmt_path);
+            return false;
+        }
+
+        // database
+        const auto ldb_path = std::string(path / fs::path("RPG_RT.ldb"));
+        auto db = lcf::LDB_Reader::Load(ldb_path);
+        if (!db) {
+            error("Could not read the generated database");
+            return false;
+        }
+
+        modify_table(db->commonevents, options_.modified_ratio_, rng, "CE");
+        modify_table(db->chipsets, options_.modified_ratio_, rng, "Tileset");
+        modify_table(db->switches, options_.modified_ratio_, rng, "Switch");
+        modify_table(db->variables, options_.modified_ratio_, rng, "Variable");
+        modify_table(db->animations, options_.modified_ratio_, rng, "Animation");
+
+        lcf::LDB_Reader::PrepareSave(*db);
+        if (!lcf::LDB_Reader::Save(lcf::ToStringView(ldb_path), *db)) {
+            error("Could not write " + ldb_path);
+            return false;
+        }
+
+        // assets: edit, remove and add a share of each folder
+        const int added = static_cast<int>(options_.assets_per_category_ * options_.modified_ratio_);
+
+        for (const auto category: data::asset_categories()) {
+            const auto folder = path / fs::path(data::asset_folder(category));
+
+            for (int i = 0; i < options_.assets_per_category_; i++) {
+                if (!modified(rng)) {
+                    continue;
+                }
+
+                if (rng() % 4 == 0) {
+                    fs::remove(folder / asset_filename(i));
+                } else if (!write_asset(folder / asset_filename(i), options_.asset_size_, rng)) {
+                    return false;
+                }
+            }
+
+            for (int i = 0; i < added; i++) {
+                const int index = options_.assets_per_category_ + i;
+                if (!write_asset(folder / asset_filename(index), options_.asset_size_, rng)) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool DevbuildGenerator::editMapEvents(const std::string &path, int map_id) const {
+        std::mt19937 rng(options_.seed_ + 2 + static_cast<uint32_t>(map_id));
+
+        const auto map = make_map(options_, map_id, rng);
+        const auto map_path = std::string(path / fs::path(chgen::MapIndex::filename(map_id)));
+
+        if (!lcf::LMU_Reader::Save(lcf::ToStringView(map_path), map, lcf::EngineVersion::e2k3)) {
+            error("Could not write " + map_path);
+            return false;
+        }
+
+        return true;
+    }
+
+} // bench
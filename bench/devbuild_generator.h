@@ -0,0 +1,92 @@
+#ifndef CU_SUBMITTER_DEVBUILD_GENERATOR_H
+#define CU_SUBMITTER_DEVBUILD_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+
+namespace bench {
+
+    /**
+     * @brief Shape of a synthetic devbuild.
+     */
+    struct GeneratorOptions {
+        /**
+         * @brief Number of MapXXXX.lmu files
+         */
+        int maps_ = 200;
+        int events_per_map_ = 20;
+        int pages_per_event_ = 2;
+        int commands_per_page_ = 20;
+        /**
+         * @brief Size of each map in tiles
+         */
+        int map_width_ = 40;
+        int map_height_ = 30;
+
+        /**
+         * @brief Number of entries in each database table
+         */
+        int common_events_ = 500;
+        int tilesets_ = 100;
+        int switches_ = 2000;
+        int variables_ = 2000;
+        int animations_ = 100;
+
+        /**
+         * @brief Number of files in each asset folder
+         */
+        int assets_per_category_ = 100;
+        /**
+         * @brief Size of each asset file in bytes
+         */
+        int asset_size_ = 4096;
+
+        /**
+         * @brief Share of maps, database entries and assets changed in the modified build, between 0 and 1
+         */
+        double modified_ratio_ = 0.05;
+
+        uint32_t seed_ = 42;
+    };
+
+    /**
+     * @brief Writes synthetic RPG Maker builds shaped like a Collective Unconscious devbuild.
+     */
+    class DevbuildGenerator {
+    public:
+        explicit DevbuildGenerator(GeneratorOptions options);
+
+        /**
+         * @brief Writes a base build
+         * @param path Root of the build. Created if needed.
+         * @return false if a file could not be written
+         */
+        bool generateBase(const std::string &path) const;
+
+        /**
+         * @brief Writes a modified copy of a base build: a share of the maps, database entries and assets
+         * are edited, added or removed, and every file gets a new last write time.
+         * @param base_path Root of a build written by generateBase
+         * @param path Root of the modified build. Created if needed.
+         * @return false if a file could not be written
+         */
+        bool generateModified(const std::string &base_path, const std::string &path) const;
+
+        /**
+         * @brief Gives a map of a build new events and leaves its map tree entry as it is, like an edit made in the
+         * map editor only
+         * @return false if the map could not be written
+         */
+        bool editMapEvents(const std::string &path, int map_id) const;
+
+        const GeneratorOptions &options() const {
+            return options_;
+        }
+
+    private:
+        GeneratorOptions options_;
+    };
+
+} // bench
+
+#endif //CU_SUBMITTER_DEVBUILD_GENERATOR_H
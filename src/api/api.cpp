@@ -1,10 +1,68 @@
 #include "api.h"
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+
+#include "../utils/metrics.h"
+
 namespace CUSubmitterService {
 
-    Service::Service(Pistache::Address addr)
+    namespace {
+
+        /**
+         * @return Whether an If-None-Match header lists the ETag, or is "*". Weak ETags are compared as strong ones.
+         */
+        bool matches_etag(std::string_view if_none_match, std::string_view etag) {
+            while (!if_none_match.empty()) {
+                const size_t end = if_none_match.find(',');
+                auto candidate = if_none_match.substr(0, end);
+                if_none_match = end == std::string_view::npos ? std::string_view() : if_none_match.substr(end + 1);
+
+                while (!candidate.empty() && candidate.front() == ' ') {
+                    candidate.remove_prefix(1);
+                }
+                while (!candidate.empty() && candidate.back() == ' ') {
+                    candidate.remove_suffix(1);
+                }
+                if (candidate.substr(0, 2) == "W/") {
+                    candidate.remove_prefix(2);
+                }
+
+                if (candidate == "*" || candidate == etag) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @return The value of a numeric query parameter, the default value if there is none, or std::nullopt if it
+         * is not a number
+         */
+        std::optional<size_t> size_parameter(const std::optional<std::string> &parameter, size_t default_value) {
+            if (!parameter) {
+                return default_value;
+            }
+
+            size_t value = 0;
+            const auto result = std::from_chars(parameter->data(), parameter->data() + parameter->size(), value);
+            if (result.ec != std::errc() || result.ptr != parameter->data() + parameter->size()) {
+                return std::nullopt;
+            }
+            return value;
+        }
+
+    }
+
+    Service::Service(Pistache::Address addr, size_t compression_min_size, size_t base_cache_size,
+                     const std::vector<std::string>& pinned_bases)
             : server(std::make_shared<Pistache::Http::Endpoint>(addr)),
-              port(addr.port()) {
+              port(addr.port()), compression_min_size_(compression_min_size),
+              bases_(base_cache_size, pinned_bases) {
     }
 
     void Service::run(size_t thr) {
@@ -17,6 +75,9 @@ namespace CUSubmitterService {
         configureRoutes();
         server->setHandler(router.handler());
 
+        // the requests for a pinned base that is still loading wait for it
+        bases_.preload();
+
         server->serve();
     }
 
@@ -31,12 +92,20 @@ namespace CUSubmitterService {
 
         Routes::Get(router, "/", Routes::bind(&Service::ready, this));
         Routes::Post(router, "/chgen", Routes::bind(&Service::generateChangelog, this));
+        Routes::Post(router, "/chgen/batch", Routes::bind(&Service::generateChangelogBatch, this));
         Routes::Post(router, "/transfer", Routes::bind(&Service::generateTransferChangelog, this));
+        Routes::Post(router, "/transfer/merge", Routes::bind(&Service::mergeTransfer, this));
+        Routes::Post(router, "/transfer/archive", Routes::bind(&Service::generateArchiveChangelog, this));
         Routes::Post(router, "/transfer/confirm", Routes::bind(&Service::transfer, this));
         Routes::Get(router, "/transfer/changelog", Routes::bind(&Service::lastTransferChangelog, this));
         Routes::Post(router, "/submit", Routes::bind(&Service::generateSubmissionChangelog, this));
         Routes::Post(router, "/submit/confirm", Routes::bind(&Service::submit, this));
         Routes::Get(router, "/submit/changelog", Routes::bind(&Service::lastSubmissionChangelog, this));
+        Routes::Post(router, "/snapshot", Routes::bind(&Service::snapshot, this));
+        Routes::Post(router, "/inbox", Routes::bind(&Service::indexInbox, this));
+        Routes::Get(router, "/changelog/:id", Routes::bind(&Service::changelogPage, this));
+        Routes::Get(router, "/changelog/:id/delta", Routes::bind(&Service::changelogDelta, this));
+        Routes::Get(router, "/metrics", Routes::bind(&Service::metrics, this));
     }
 
     void Service::logRequest(const Request &request) {
@@ -44,6 +113,80 @@ namespace CUSubmitterService {
             Pistache::Http::methodString(request.method()) + " " + request.resource());
     }
 
+    std::unique_ptr<trace::Session> Service::startTrace(const Request &request) {
+        const auto parameter = request.query().get("trace");
+        if (!parameter || parameter->empty() || *parameter == "0" || *parameter == "false") {
+            return nullptr;
+        }
+
+        return std::make_unique<trace::Session>();
+    }
+
+    void Service::finishTrace(const std::unique_ptr<trace::Session> &session, const std::string &operation, Response &response) {
+        if (!session) {
+            return;
+        }
+
+        static std::atomic<uint64_t> sequence{0};
+
+        const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        const std::string filename = operation + "_" + std::to_string(now) + "_" + std::to_string(sequence++) + ".json";
+
+        std::filesystem::create_directories("traces");
+        const std::string path = std::filesystem::path("traces") / std::filesystem::path(filename);
+
+        if (!session->write(path)) {
+            error("Could not write " + path);
+            return;
+        }
+
+        log("Trace written to " + path);
+        response.headers().addRaw(Pistache::Http::Header::Raw("X-Trace-File", path));
+    }
+
+    std::string Service::headerValue(const Request &request, const std::string &name) {
+        if (const auto raw = request.headers().tryGetRaw(name)) {
+            return raw->value();
+        }
+
+        // headers known to Pistache are parsed instead of kept raw
+        if (const auto header = request.headers().tryGet(name)) {
+            std::ostringstream value;
+            header->write(value);
+            return value.str();
+        }
+
+        return "";
+    }
+
+    void Service::sendBody(const Request &request, Response &response, std::string_view body,
+                           const Pistache::Http::Mime::MediaType &mime) const {
+        response.headers().addRaw(Pistache::Http::Header::Raw("Vary", "Accept-Encoding"));
+
+        const auto encoding = body.size() >= compression_min_size_
+                ? compression::negotiate(headerValue(request, "Accept-Encoding")) : compression::IDENTITY;
+
+        if (encoding == compression::IDENTITY) {
+            response.send(Pistache::Http::Code::Ok, body.data(), body.size(), mime);
+            return;
+        }
+
+        response.headers().addRaw(Pistache::Http::Header::Raw("Content-Encoding", compression::encodingName(encoding)));
+        response.setMime(mime);
+
+        // each compressed block is sent as a chunk while the next one is compressed
+        auto stream = response.stream(Pistache::Http::Code::Ok);
+        compression::Compressor compressor(encoding, [&stream](const char *data, size_t size) {
+            stream.write(data, static_cast<std::streamsize>(size));
+            stream.flush();
+        });
+
+        compressor.write(body);
+        compressor.finish();
+        stream.ends();
+    }
+
     void Service::ready(const Request &request, Response response) {
         try {
             logRequest(request);
@@ -61,8 +204,11 @@ namespace CUSubmitterService {
         try {
             logRequest(request);
 
+            const auto trace_session = startTrace(request);
+            trace::Activate activate(trace_session.get());
+
             const std::string& body = request.body();
-            log("Raw content :\n" + body);
+            debug("Raw content :\n" + body);
 
             rapidjson::Document document;
             document.Parse(body.c_str());
@@ -79,7 +225,8 @@ namespace CUSubmitterService {
             log("Parameter base_path : " + base_path);
             log("Parameter modified_path : " + modified_path);
 
-            const auto changelog = chgen::ChangelogGenerator::scan(base_path, modified_path);
+            const auto base = bases_.get(base_path);
+            const auto changelog = base ? chgen::ChangelogGenerator::scan(*base, modified_path) : nullptr;
             if (changelog == nullptr) {
                 response.send(Pistache::Http::Code::Bad_Request, "Could not generate changelog", MIME(Text, Plain));
                 return;
@@ -92,8 +239,74 @@ namespace CUSubmitterService {
 
             changelog->Serialize(writer);
 
-            const std::string string_changelog = sb.GetString();
-            response.send(Pistache::Http::Code::Ok, string_changelog, MIME(Application, Json));
+            finishTrace(trace_session, "chgen", response);
+
+            sendBody(request, response, std::string_view(sb.GetString(), sb.GetSize()), MIME(Application, Json));
+        } catch (const std::runtime_error &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
+        } catch (const std::exception &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Internal_Server_Error, e.what(), MIME(Text, Plain));
+        }
+    }
+
+    void Service::generateChangelogBatch(const Service::Request &request, Service::Response response) {
+        try {
+            logRequest(request);
+
+            const auto trace_session = startTrace(request);
+            trace::Activate activate(trace_session.get());
+
+            const std::string& body = request.body();
+            debug("Raw content :\n" + body);
+
+            rapidjson::Document document;
+            document.Parse(body.c_str());
+
+            if (!(document.HasMember("base_path") && document.HasMember("modified_paths") &&
+                  document["modified_paths"].IsArray())) {
+                error("Incorrect arguments");
+                response.send(Pistache::Http::Code::Bad_Request);
+                return;
+            }
+
+            const std::string base_path = document["base_path"].GetString();
+
+            std::vector<std::string> modified_paths;
+            for (const auto &path: document["modified_paths"].GetArray()) {
+                if (!path.IsString()) {
+                    error("Incorrect arguments");
+                    response.send(Pistache::Http::Code::Bad_Request);
+                    return;
+                }
+                modified_paths.emplace_back(path.GetString());
+            }
+
+            log("Parameter base_path : " + base_path);
+            log("Parameter modified_paths : " + std::to_string(modified_paths.size()) + " builds");
+
+            const auto base = bases_.get(base_path);
+            const auto changelogs = base ? chgen::ChangelogGenerator::scanBatch(*base, modified_paths)
+                                         : std::vector<std::shared_ptr<data::Changelog>>(modified_paths.size());
+
+            rapidjson::StringBuffer sb;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+
+            // one changelog per modified path, in the request order; null if the build could not be scanned
+            writer.StartArray();
+            for (const auto &changelog: changelogs) {
+                if (changelog) {
+                    changelog->Serialize(writer);
+                } else {
+                    writer.Null();
+                }
+            }
+            writer.EndArray();
+
+            finishTrace(trace_session, "chgen_batch", response);
+
+            sendBody(request, response, std::string_view(sb.GetString(), sb.GetSize()), MIME(Application, Json));
         } catch (const std::runtime_error &e) {
             log("Error: " + std::string(e.what()));
             response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
@@ -107,8 +320,11 @@ namespace CUSubmitterService {
         try {
             logRequest(request);
 
+            const auto trace_session = startTrace(request);
+            trace::Activate activate(trace_session.get());
+
             const std::string& body = request.body();
-            log("Raw content :\n" + body);
+            debug("Raw content :\n" + body);
 
             rapidjson::Document document;
             document.Parse(body.c_str());
@@ -125,19 +341,24 @@ namespace CUSubmitterService {
             log("Parameter unmodified_copy_path : " + unmodified_copy_path);
             log("Parameter modified_copy_path : " + modified_copy_path);
 
-            const auto changelog = transfer::DevbuildTransferer::getTransferChangelog(unmodified_copy_path, modified_copy_path);
+            const auto base = bases_.get(unmodified_copy_path);
+            const auto changelog = base ? transfer::DevbuildTransferer::getTransferChangelog(*base, modified_copy_path) : nullptr;
             if (changelog == nullptr) {
                 response.send(Pistache::Http::Code::Bad_Request, "Could not generate changelog", MIME(Text, Plain));
                 return;
             }
 
+            const auto stored = changelogs_.save("transfer", changelog);
+            response.headers().addRaw(Pistache::Http::Header::Raw("X-Changelog-Id", stored->id()));
+
             rapidjson::StringBuffer sb;
             rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
 
             changelog->Serialize(writer);
 
-            const std::string string_changelog = sb.GetString();
-            response.send(Pistache::Http::Code::Ok, string_changelog, MIME(Application, Json));
+            finishTrace(trace_session, "transfer", response);
+
+            sendBody(request, response, std::string_view(sb.GetString(), sb.GetSize()), MIME(Application, Json));
         } catch (const std::runtime_error &e) {
             log("Error: " + std::string(e.what()));
             response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
@@ -147,30 +368,83 @@ namespace CUSubmitterService {
         }
     }
 
-    void Service::transfer(const Service::Request &request, Service::Response response) {
+    bool Service::destinationPaths(const rapidjson::Document &document, std::vector<std::string> &destination_paths) {
+        if (document.HasMember("destination_path") && document["destination_path"].IsString()) {
+            destination_paths.emplace_back(document["destination_path"].GetString());
+            return true;
+        }
+
+        if (!document.HasMember("destination_paths") || !document["destination_paths"].IsArray()) {
+            return false;
+        }
+        for (const auto &path: document["destination_paths"].GetArray()) {
+            if (!path.IsString()) {
+                return false;
+            }
+            destination_paths.emplace_back(path.GetString());
+        }
+        return !destination_paths.empty();
+    }
+
+    void Service::mergeTransfer(const Service::Request &request, Service::Response response) {
         try {
             logRequest(request);
 
+            const auto trace_session = startTrace(request);
+            trace::Activate activate(trace_session.get());
+
             const std::string& body = request.body();
-            log("Raw content :\n" + body);
+            debug("Raw content :\n" + body);
 
             rapidjson::Document document;
             document.Parse(body.c_str());
 
-            if (!document.HasMember("destination_path")) {
+            std::vector<std::string> destination_paths;
+            if (!(document.HasMember("unmodified_copy_path") && document.HasMember("modified_copy_path") &&
+                  destinationPaths(document, destination_paths))) {
                 error("Incorrect arguments");
                 response.send(Pistache::Http::Code::Bad_Request);
                 return;
             }
 
-            const std::string destination_path = document["destination_path"].GetString();
+            const std::string unmodified_copy_path = document["unmodified_copy_path"].GetString();
+            const std::string modified_copy_path = document["modified_copy_path"].GetString();
 
-            log("Parameter destination_path : " + destination_path);
+            log("Parameter unmodified_copy_path : " + unmodified_copy_path);
+            log("Parameter modified_copy_path : " + modified_copy_path);
+            for (const auto &destination_path: destination_paths) {
+                log("Parameter destination_path : " + destination_path);
+            }
 
-            transfer::DevbuildTransferer::transfer(destination_path);
-            transfer::DevbuildTransferer::exportChangelog();
+            const auto base = bases_.get(unmodified_copy_path);
+            const auto reports = base ? transfer::DevbuildTransferer::getMergeReports(*base, modified_copy_path, destination_paths)
+                                      : std::vector<std::shared_ptr<transfer::MergeReport>>();
+            if (reports.empty()) {
+                response.send(Pistache::Http::Code::Bad_Request, "Could not generate changelog", MIME(Text, Plain));
+                return;
+            }
 
-            response.send(Pistache::Http::Code::Ok);
+            // the changes still to transfer, served by GET /transfer/changelog like those of POST /transfer
+            const auto stored = changelogs_.save("transfer", transfer::DevbuildTransferer::getTransferChangelog());
+            response.headers().addRaw(Pistache::Http::Header::Raw("X-Changelog-Id", stored->id()));
+
+            rapidjson::StringBuffer sb;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+
+            // an object for destination_path, an array of one per destination for destination_paths
+            if (document.HasMember("destination_paths")) {
+                writer.StartArray();
+                for (const auto &report: reports) {
+                    report->Serialize(writer);
+                }
+                writer.EndArray();
+            } else {
+                reports.front()->Serialize(writer);
+            }
+
+            finishTrace(trace_session, "transfer_merge", response);
+
+            sendBody(request, response, std::string_view(sb.GetString(), sb.GetSize()), MIME(Application, Json));
         } catch (const std::runtime_error &e) {
             log("Error: " + std::string(e.what()));
             response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
@@ -180,23 +454,172 @@ namespace CUSubmitterService {
         }
     }
 
-    void Service::lastTransferChangelog(const Service::Request &request, Service::Response response) {
+    void Service::generateArchiveChangelog(const Service::Request &request, Service::Response response) {
         try {
             logRequest(request);
 
-            const auto changelog = transfer::DevbuildTransferer::getTransferChangelog();
+            const auto trace_session = startTrace(request);
+            trace::Activate activate(trace_session.get());
+
+            const std::string& body = request.body();
+            debug("Raw content :\n" + body);
+
+            rapidjson::Document document;
+            document.Parse(body.c_str());
+
+            if (!document.HasMember("archive_path")) {
+                error("Incorrect arguments");
+                response.send(Pistache::Http::Code::Bad_Request);
+                return;
+            }
+
+            const std::string archive_path = document["archive_path"].GetString();
+
+            log("Parameter archive_path : " + archive_path);
+
+            const auto changelog = transfer::DevbuildTransferer::getArchiveChangelog(archive_path);
             if (changelog == nullptr) {
-                response.send(Pistache::Http::Code::Bad_Request, "Could not generate changelog", MIME(Text, Plain));
+                response.send(Pistache::Http::Code::Bad_Request, "Could not read the changelog of the archive", MIME(Text, Plain));
                 return;
             }
 
+            const auto stored = changelogs_.save("transfer", changelog);
+            response.headers().addRaw(Pistache::Http::Header::Raw("X-Changelog-Id", stored->id()));
+
             rapidjson::StringBuffer sb;
             rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
 
             changelog->Serialize(writer);
 
-            const std::string string_changelog = sb.GetString();
-            response.send(Pistache::Http::Code::Ok, string_changelog, MIME(Application, Json));
+            finishTrace(trace_session, "transfer_archive", response);
+
+            sendBody(request, response, std::string_view(sb.GetString(), sb.GetSize()), MIME(Application, Json));
+        } catch (const std::runtime_error &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
+        } catch (const std::exception &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Internal_Server_Error, e.what(), MIME(Text, Plain));
+        }
+    }
+
+    void Service::transfer(const Service::Request &request, Service::Response response) {
+        try {
+            logRequest(request);
+
+            const auto trace_session = startTrace(request);
+            trace::Activate activate(trace_session.get());
+
+            const std::string& body = request.body();
+            debug("Raw content :\n" + body);
+
+            rapidjson::Document document;
+            document.Parse(body.c_str());
+
+            std::vector<std::string> destination_paths;
+            if (!destinationPaths(document, destination_paths)) {
+                error("Incorrect arguments");
+                response.send(Pistache::Http::Code::Bad_Request);
+                return;
+            }
+
+            for (const auto &destination_path: destination_paths) {
+                log("Parameter destination_path : " + destination_path);
+            }
+
+            if (!transfer::DevbuildTransferer::transfer(destination_paths)) {
+                const auto &reports = transfer::DevbuildTransferer::getMergeReports();
+                const auto conflicting = std::find_if(reports.begin(), reports.end(), [](const auto &report) {
+                    return report->hasConflicts();
+                });
+                if (conflicting != reports.end()) {
+                    response.send(Pistache::Http::Code::Conflict, (*conflicting)->destination_path_ + " also changed " +
+                                  std::to_string((*conflicting)->count(transfer::MergeStatus::CONFLICT)) + " of the entries", MIME(Text, Plain));
+                } else {
+                    response.send(Pistache::Http::Code::Bad_Request, "Could not transfer", MIME(Text, Plain));
+                }
+                return;
+            }
+            transfer::DevbuildTransferer::exportChangelog();
+
+            finishTrace(trace_session, "transfer_confirm", response);
+
+            response.send(Pistache::Http::Code::Ok);
+        } catch (const std::runtime_error &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
+        } catch (const std::exception &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Internal_Server_Error, e.what(), MIME(Text, Plain));
+        }
+    }
+
+    void Service::sendChangelog(const Request &request, Response &response, const data::StoredChangelog &changelog) const {
+        const auto format = request.query().get("format");
+        const bool text = format && *format == "text";
+        const std::string representation = text ? "text" : "json";
+
+        const auto body = changelog.body(representation, [&changelog, text]() {
+            if (text) {
+                data::TextWriter writer;
+                changelog.changelog()->Render(writer);
+                return writer.str();
+            }
+
+            rapidjson::StringBuffer sb;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+            changelog.changelog()->Serialize(writer);
+            return std::string(sb.GetString(), sb.GetSize());
+        });
+
+        const auto encoding = body->size() >= compression_min_size_
+                ? compression::negotiate(headerValue(request, "Accept-Encoding")) : compression::IDENTITY;
+
+        // every representation has its own ETag, as a strong ETag identifies the exact bytes
+        std::string etag = "\"" + changelog.version() + "-" + representation;
+        if (encoding != compression::IDENTITY) {
+            etag += std::string("-") + compression::encodingName(encoding);
+        }
+        etag += "\"";
+
+        response.headers().addRaw(Pistache::Http::Header::Raw("ETag", etag));
+        response.headers().addRaw(Pistache::Http::Header::Raw("X-Changelog-Id", changelog.id()));
+        response.headers().addRaw(Pistache::Http::Header::Raw("Vary", "Accept-Encoding"));
+        // revalidated on every request, which costs a header check while the changelog is unchanged
+        response.headers().addRaw(Pistache::Http::Header::Raw("Cache-Control", "no-cache"));
+
+        if (matches_etag(headerValue(request, "If-None-Match"), etag)) {
+            response.send(Pistache::Http::Code::Not_Modified);
+            return;
+        }
+
+        const auto mime = text ? MIME(Text, Plain) : MIME(Application, Json);
+
+        if (encoding == compression::IDENTITY) {
+            response.send(Pistache::Http::Code::Ok, body->data(), body->size(), mime);
+            return;
+        }
+
+        const auto compressed = changelog.body(representation + "-" + compression::encodingName(encoding), [&body, encoding]() {
+            return compression::compress(*body, encoding);
+        });
+
+        response.headers().addRaw(Pistache::Http::Header::Raw("Content-Encoding", compression::encodingName(encoding)));
+        response.send(Pistache::Http::Code::Ok, compressed->data(), compressed->size(), mime);
+    }
+
+    void Service::lastTransferChangelog(const Service::Request &request, Service::Response response) {
+        try {
+            logRequest(request);
+
+            // saved when it was generated, so that it is still served after a restart
+            const auto changelog = changelogs_.latest("transfer");
+            if (changelog == nullptr) {
+                response.send(Pistache::Http::Code::Bad_Request, "Could not generate changelog", MIME(Text, Plain));
+                return;
+            }
+
+            sendChangelog(request, response, *changelog);
         } catch (const std::runtime_error &e) {
             log("Error: " + std::string(e.what()));
             response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
@@ -210,8 +633,11 @@ namespace CUSubmitterService {
         try {
             logRequest(request);
 
+            const auto trace_session = startTrace(request);
+            trace::Activate activate(trace_session.get());
+
             const std::string& body = request.body();
-            log("Raw content :\n" + body);
+            debug("Raw content :\n" + body);
 
             rapidjson::Document document;
             document.Parse(body.c_str());
@@ -234,19 +660,24 @@ namespace CUSubmitterService {
                 log("Parameter archive_path : " + archive_path);
             }
 
-            const auto changelog = submit::SubmissionBuilder::getSubmissionChangelog(unmodified_copy_path, modified_copy_path);
+            const auto base = bases_.get(unmodified_copy_path);
+            const auto changelog = base ? submit::SubmissionBuilder::getSubmissionChangelog(*base, modified_copy_path) : nullptr;
             if (changelog == nullptr) {
                 response.send(Pistache::Http::Code::Bad_Request, "Could not generate changelog", MIME(Text, Plain));
                 return;
             }
 
+            const auto stored = changelogs_.save("submit", changelog);
+            response.headers().addRaw(Pistache::Http::Header::Raw("X-Changelog-Id", stored->id()));
+
             rapidjson::StringBuffer sb;
             rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
 
             changelog->Serialize(writer);
 
-            const std::string string_changelog = sb.GetString();
-            response.send(Pistache::Http::Code::Ok, string_changelog, MIME(Application, Json));
+            finishTrace(trace_session, "submit", response);
+
+            sendBody(request, response, std::string_view(sb.GetString(), sb.GetSize()), MIME(Application, Json));
         } catch (const std::runtime_error &e) {
             log("Error: " + std::string(e.what()));
             response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
@@ -260,8 +691,11 @@ namespace CUSubmitterService {
         try {
             logRequest(request);
 
+            const auto trace_session = startTrace(request);
+            trace::Activate activate(trace_session.get());
+
             const std::string& body = request.body();
-            log("Raw content :\n" + body);
+            debug("Raw content :\n" + body);
 
             rapidjson::Document document;
             document.Parse(body.c_str());
@@ -277,6 +711,8 @@ namespace CUSubmitterService {
                 submit::SubmissionBuilder::submit();
             }
 
+            finishTrace(trace_session, "submit_confirm", response);
+
             response.send(Pistache::Http::Code::Ok);
         } catch (const std::runtime_error &e) {
             log("Error: " + std::string(e.what()));
@@ -291,19 +727,107 @@ namespace CUSubmitterService {
         try {
             logRequest(request);
 
-            const auto changelog = submit::SubmissionBuilder::getSubmissionChangelog();
+            const auto changelog = changelogs_.latest("submit");
             if (changelog == nullptr) {
                 response.send(Pistache::Http::Code::Bad_Request, "Could not generate changelog", MIME(Text, Plain));
                 return;
             }
 
+            sendChangelog(request, response, *changelog);
+        } catch (const std::runtime_error &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
+        } catch (const std::exception &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Internal_Server_Error, e.what(), MIME(Text, Plain));
+        }
+    }
+
+    void Service::snapshot(const Service::Request &request, Service::Response response) {
+        try {
+            logRequest(request);
+
+            const auto trace_session = startTrace(request);
+            trace::Activate activate(trace_session.get());
+
+            const std::string& body = request.body();
+            debug("Raw content :\n" + body);
+
+            rapidjson::Document document;
+            document.Parse(body.c_str());
+
+            if (!(document.HasMember("devbuild_path") && document.HasMember("snapshot_path"))) {
+                error("Incorrect arguments");
+                response.send(Pistache::Http::Code::Bad_Request);
+                return;
+            }
+
+            const std::string devbuild_path = document["devbuild_path"].GetString();
+            const std::string snapshot_path = document["snapshot_path"].GetString();
+            const bool hardlink = document.HasMember("hardlink") && document["hardlink"].IsBool() &&
+                                  document["hardlink"].GetBool();
+
+            log("Parameter devbuild_path : " + devbuild_path);
+            log("Parameter snapshot_path : " + snapshot_path);
+
+            const auto result = snapshot::SnapshotBuilder::snapshot(devbuild_path, snapshot_path, hardlink);
+            if (!result) {
+                response.send(Pistache::Http::Code::Bad_Request, "Could not create snapshot", MIME(Text, Plain));
+                return;
+            }
+
             rapidjson::StringBuffer sb;
             rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+            result->Serialize(writer);
 
-            changelog->Serialize(writer);
+            finishTrace(trace_session, "snapshot", response);
+
+            sendBody(request, response, std::string_view(sb.GetString(), sb.GetSize()), MIME(Application, Json));
+        } catch (const std::runtime_error &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
+        } catch (const std::exception &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Internal_Server_Error, e.what(), MIME(Text, Plain));
+        }
+    }
+
+    void Service::indexInbox(const Service::Request &request, Service::Response response) {
+        try {
+            logRequest(request);
+
+            const auto trace_session = startTrace(request);
+            trace::Activate activate(trace_session.get());
+
+            const std::string& body = request.body();
+            debug("Raw content :\n" + body);
+
+            rapidjson::Document document;
+            document.Parse(body.c_str());
+
+            if (!document.HasMember("inbox_path")) {
+                error("Incorrect arguments");
+                response.send(Pistache::Http::Code::Bad_Request);
+                return;
+            }
+
+            const std::string inbox_path = document["inbox_path"].GetString();
+
+            log("Parameter inbox_path : " + inbox_path);
+
+            const auto index = submit::InboxIndexer::index(inbox_path);
+            if (!index) {
+                response.send(Pistache::Http::Code::Bad_Request, "Could not index the inbox", MIME(Text, Plain));
+                return;
+            }
+
+            rapidjson::StringBuffer sb;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+            index->Serialize(writer);
 
-            const std::string string_changelog = sb.GetString();
-            response.send(Pistache::Http::Code::Ok, string_changelog, MIME(Application, Json));
+            finishTrace(trace_session, "inbox", response);
+
+            sendBody(request, response, std::string_view(sb.GetString(), sb.GetSize()), MIME(Application, Json));
         } catch (const std::runtime_error &e) {
             log("Error: " + std::string(e.what()));
             response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
@@ -313,5 +837,127 @@ namespace CUSubmitterService {
         }
     }
 
-} // CUSubmitterService
+    void Service::changelogPage(const Service::Request &request, Service::Response response) {
+        try {
+            logRequest(request);
+
+            const auto id = request.param(":id").as<std::string>();
+            const auto changelog = changelogs_.find(id);
+            if (changelog == nullptr) {
+                response.send(Pistache::Http::Code::Not_Found, "No changelog " + id, MIME(Text, Plain));
+                return;
+            }
+
+            const auto &index = changelog->index();
+
+            rapidjson::StringBuffer sb;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+
+            const auto category = request.query().get("category");
+            if (!category) {
+                index.SerializeSummary(writer);
+            } else {
+                data::ChangelogIndex::Query query;
+                query.category_ = *category;
+
+                if (const auto status = request.query().get("status")) {
+                    query.status_ = data::parse_status(*status);
+                    if (!query.status_) {
+                        response.send(Pistache::Http::Code::Bad_Request, "Unknown status " + *status, MIME(Text, Plain));
+                        return;
+                    }
+                }
+
+                const auto offset = size_parameter(request.query().get("offset"), 0);
+                const auto limit = size_parameter(request.query().get("limit"), query.limit_);
+                if (!offset || !limit) {
+                    response.send(Pistache::Http::Code::Bad_Request, "Invalid offset or limit", MIME(Text, Plain));
+                    return;
+                }
+                query.offset_ = *offset;
+                query.limit_ = *limit;
+                query.cursor_ = request.query().get("cursor");
+
+                index.SerializePage(writer, query);
+            }
+
+            response.headers().addRaw(Pistache::Http::Header::Raw("X-Changelog-Id", changelog->id()));
+            sendBody(request, response, std::string_view(sb.GetString(), sb.GetSize()), MIME(Application, Json));
+        } catch (const std::invalid_argument &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Bad_Request, e.what(), MIME(Text, Plain));
+        } catch (const std::runtime_error &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
+        } catch (const std::exception &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Internal_Server_Error, e.what(), MIME(Text, Plain));
+        }
+    }
+
+    void Service::changelogDelta(const Service::Request &request, Service::Response response) {
+        try {
+            logRequest(request);
+
+            const auto since = request.query().get("since");
+            if (!since) {
+                error("Incorrect arguments");
+                response.send(Pistache::Http::Code::Bad_Request);
+                return;
+            }
+
+            const auto id = request.param(":id").as<std::string>();
+            const auto changelog = changelogs_.find(id);
+            const auto previous = changelogs_.find(*since);
+            if (changelog == nullptr || previous == nullptr) {
+                response.send(Pistache::Http::Code::Not_Found, "No changelog " + (changelog ? *since : id), MIME(Text, Plain));
+                return;
+            }
+
+            // outside of the rendering, which holds the lock of the changelog
+            const auto &index = changelog->index();
+            const auto &previous_index = previous->index();
+
+            // kept with the changelog, as the client re-asks for the same delta until it scans again
+            const auto body = changelog->body("delta-" + previous->id(), [&]() {
+                rapidjson::StringBuffer sb;
+                rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+
+                writer.StartObject();
+
+                writer.String("id");
+                writer.String(changelog->id().c_str(), static_cast<rapidjson::SizeType>(changelog->id().size()));
+
+                writer.String("since");
+                writer.String(previous->id().c_str(), static_cast<rapidjson::SizeType>(previous->id().size()));
+
+                writer.String("categories");
+                index.SerializeDelta(writer, previous_index);
+
+                writer.EndObject();
+
+                return std::string(sb.GetString(), sb.GetSize());
+            });
+
+            response.headers().addRaw(Pistache::Http::Header::Raw("X-Changelog-Id", changelog->id()));
+            sendBody(request, response, *body, MIME(Application, Json));
+        } catch (const std::runtime_error &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Not_Found, e.what(), MIME(Text, Plain));
+        } catch (const std::exception &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Internal_Server_Error, e.what(), MIME(Text, Plain));
+        }
+    }
+
+    void Service::metrics(const Service::Request &, Service::Response response) {
+        try {
+            response.send(Pistache::Http::Code::Ok, metrics::prometheus(),
+                          Pistache::Http::Mime::MediaType::fromString("text/plain; version=0.0.4"));
+        } catch (const std::exception &e) {
+            log("Error: " + std::string(e.what()));
+            response.send(Pistache::Http::Code::Internal_Server_Error, e.what(), MIME(Text, Plain));
+        }
+    }
 
+} // CUSubmitterService
\ No newline at end of file
@@ -7,17 +7,30 @@
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 
+#include "../chgen/base_build_cache.h"
 #include "../chgen/chgen.h"
 #include "../data/changelog.h"
+#include "../data/changelog_store.h"
 #include "../transfer/transfer.h"
+#include "../submit/inbox.h"
 #include "../submit/submit.h"
+#include "../snapshot/snapshot.h"
+#include "../utils/compression.h"
 #include "../utils/log.h"
+#include "../utils/trace.h"
 
 namespace CUSubmitterService {
 
     class Service {
     public:
-        explicit Service(Pistache::Address addr);
+        /**
+         * @param compression_min_size Response bodies smaller than this are never compressed
+         * @param base_cache_size Memory the parsed base builds kept between requests may use
+         * @param pinned_bases Base builds parsed when the server starts and never evicted
+         */
+        explicit Service(Pistache::Address addr, size_t compression_min_size = compression::default_min_size,
+                         size_t base_cache_size = chgen::BaseBuildCache::default_memory_budget,
+                         const std::vector<std::string>& pinned_bases = {});
 
         void run(size_t thr = std::thread::hardware_concurrency());
 
@@ -31,18 +44,76 @@ namespace CUSubmitterService {
 
         void ready(const Request& request, Response response);
         void generateChangelog(const Request& request, Response response);
+        void generateChangelogBatch(const Request& request, Response response);
         void generateTransferChangelog(const Request& request, Response response);
+        void mergeTransfer(const Request& request, Response response);
+        void generateArchiveChangelog(const Request& request, Response response);
         void transfer(const Request& request, Response response);
         void lastTransferChangelog(const Request& request, Response response);
         void generateSubmissionChangelog(const Request& request, Response response);
         void submit(const Request& request, Response response);
         void lastSubmissionChangelog(const Request& request, Response response);
+        void snapshot(const Request& request, Response response);
+        void indexInbox(const Request& request, Response response);
+        void changelogPage(const Request& request, Response response);
+        void changelogDelta(const Request& request, Response response);
+        void metrics(const Request& request, Response response);
 
         static void logRequest(const Request& request);
 
+        /**
+         * @brief Reads the devbuilds of a transfer: destination_path, or the destination_paths array
+         * @return false if the request has neither
+         */
+        static bool destinationPaths(const rapidjson::Document& document, std::vector<std::string>& destination_paths);
+
+        /**
+         * @brief Starts a trace of the request if it has a trace=1 query parameter
+         * @return The trace session, or nullptr if the request is not traced
+         */
+        static std::unique_ptr<trace::Session> startTrace(const Request& request);
+
+        /**
+         * @brief Writes the trace of a request in the traces folder and returns its path in the X-Trace-File header
+         * @param session May be null, in which case nothing happens
+         * @param operation Prefix of the trace file name
+         */
+        static void finishTrace(const std::unique_ptr<trace::Session>& session, const std::string& operation, Response& response);
+
+        /**
+         * @return The value of a request header, or an empty string if the request does not have it
+         */
+        static std::string headerValue(const Request& request, const std::string& name);
+
+        /**
+         * @brief Sends a response body, compressed with the best encoding of the Accept-Encoding header
+         * @details Bodies of at least compression_min_size_ bytes are compressed as they are sent, in chunks.
+         */
+        void sendBody(const Request& request, Response& response, std::string_view body,
+                      const Pistache::Http::Mime::MediaType& mime) const;
+
+        /**
+         * @brief Sends a stored changelog as JSON, or as the text changelog if the request has a format=text query
+         * parameter
+         * @details The body is rendered and compressed once per representation and kept with the changelog. Its ETag
+         * is derived from the changelog version, and a request whose If-None-Match has it gets a 304 Not Modified.
+         */
+        void sendChangelog(const Request& request, Response& response, const data::StoredChangelog& changelog) const;
+
         std::shared_ptr<Pistache::Http::Endpoint> server;
         Pistache::Rest::Router router;
         Pistache::Port port;
+        size_t compression_min_size_;
+
+        /**
+         * @brief Every generated transfer and submission changelog, in the changelogs folder
+         */
+        data::ChangelogStore changelogs_{"changelogs"};
+
+        /**
+         * @brief The base builds of the scans, parsed once and kept while they do not change
+         */
+        chgen::BaseBuildCache bases_;
     };
 
 } // CUSubmitterService
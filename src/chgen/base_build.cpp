@@ -0,0 +1,228 @@
+#include "base_build.h"
+
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <lcf/ldb/reader.h>
+#include <lcf/lmt/reader.h>
+
+#include "../data/changelog.h"
+#include "../utils/error.h"
+#include "../utils/log.h"
+#include "../utils/metrics.h"
+#include "../utils/utils.h"
+
+namespace fs = std::filesystem;
+
+namespace chgen {
+
+    namespace {
+
+        template<typename T>
+        size_t vector_memory(const std::vector<T> &vector) {
+            return vector.capacity() * sizeof(T);
+        }
+
+        size_t listing_memory(const utils::DirectoryListing &listing) {
+            size_t memory = vector_memory(listing.entries_);
+            for (const auto &entry: listing.entries_) {
+                memory += entry.name_.capacity();
+            }
+            return memory;
+        }
+
+        size_t commands_memory(const std::vector<lcf::rpg::EventCommand> &commands) {
+            size_t memory = vector_memory(commands);
+            for (const auto &command: commands) {
+                memory += command.parameters.size() * sizeof(int32_t) + command.string.size();
+            }
+            return memory;
+        }
+
+        size_t map_events_memory(const MapEvents &events) {
+            return sizeof(MapEvents) + vector_memory(events.event_x_) + vector_memory(events.event_y_) +
+                   vector_memory(events.code_) + vector_memory(events.indent_) + vector_memory(events.event_) +
+                   vector_memory(events.params_offset_) + vector_memory(events.string_offset_) +
+                   vector_memory(events.params_) + events.strings_.capacity();
+        }
+
+        /**
+         * @brief Drops the tables a scan does not compare
+         */
+        void project_database(lcf::rpg::Database &database) {
+            database.actors = {};
+            database.skills = {};
+            database.items = {};
+            database.enemies = {};
+            database.troops = {};
+            database.terrains = {};
+            database.attributes = {};
+            database.states = {};
+            database.classes = {};
+            database.battleranimations = {};
+        }
+
+    }
+
+    utils::BuildListing list_build(const std::string &path) {
+        std::vector<std::string> asset_folders;
+        for (const auto category: data::asset_categories()) {
+            asset_folders.push_back(data::asset_folder(category));
+        }
+
+        return utils::listBuild(path, asset_folders);
+    }
+
+    uint64_t build_fingerprint(const utils::BuildListing &listing) {
+        uint64_t hash = utils::hashBytes(nullptr, 0);
+
+        const auto add_listing = [&hash](const utils::DirectoryListing &directory) {
+            for (const auto &entry: directory.entries_) {
+                if (entry.name_ == snapshot_manifest) {
+                    continue;
+                }
+
+                hash = utils::hashBytes(entry.name_.data(), entry.name_.size() + 1, hash);
+                const uint64_t fields[] = {entry.size_, static_cast<uint64_t>(entry.mtime_), entry.inode_};
+                hash = utils::hashBytes(reinterpret_cast<const char *>(fields), sizeof(fields), hash);
+            }
+        };
+
+        add_listing(listing.root_);
+        for (const auto &[folder, directory]: listing.folders_) {
+            hash = utils::hashBytes(folder.data(), folder.size() + 1, hash);
+            add_listing(directory);
+        }
+
+        return hash;
+    }
+
+    std::optional<uint64_t> snapshot_fingerprint(const std::string &path) {
+        std::ifstream manifest(path / fs::path(snapshot_manifest));
+        if (!manifest.is_open()) {
+            return std::nullopt;
+        }
+
+        std::string key;
+        std::string value;
+        while (manifest >> key && std::getline(manifest >> std::ws, value)) {
+            if (key != "fingerprint") {
+                continue;
+            }
+
+            uint64_t fingerprint = 0;
+            const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), fingerprint, 16);
+            if (ec == std::errc() && end == value.data() + value.size()) {
+                return fingerprint;
+            }
+        }
+
+        error("Invalid snapshot manifest in " + path);
+        return std::nullopt;
+    }
+
+    std::shared_ptr<const BaseBuild> BaseBuild::load(const std::string &path) {
+        log("Loading base build " + path + "...");
+
+        std::shared_ptr<BaseBuild> build(new BaseBuild());
+        build->path_ = path;
+
+        metrics::ScopedTimer list_timer("base", "list_build");
+
+        build->listing_ = list_build(path);
+        if (build->listing_.root_.entries_.empty()) {
+            return nullptr;
+        }
+
+        build->fingerprint_ = build_fingerprint(build->listing_);
+
+        if (const auto recorded = snapshot_fingerprint(path)) {
+            if (*recorded != build->fingerprint_) {
+                // e.g. a hard linked snapshot whose devbuild was saved over: the edits would be in both builds, and
+                // missing from the changelog
+                error("The snapshot " + path + " was modified since it was created, it cannot be used as a base "
+                      "build. Make a new snapshot of the unmodified devbuild");
+                return nullptr;
+            }
+            log("Base build " + path + " is an unmodified snapshot");
+        }
+
+        list_timer.stop();
+
+        metrics::ScopedTimer map_tree_timer("base", "load_map_tree");
+
+        const fs::path lmt_path = path / fs::path("RPG_RT.lmt");
+        if (!fs::exists(lmt_path)) {
+            error("Missing file: " + std::string(lmt_path));
+            return nullptr;
+        }
+
+        build->map_tree_ = lcf::LMT_Reader::Load(std::string(lmt_path));
+        if (!build->map_tree_) {
+            error("Could not read " + std::string(lmt_path));
+            return nullptr;
+        }
+
+        if (const auto *lmt = build->listing_.root_.find("RPG_RT.lmt")) {
+            metrics::add(metrics::BYTES_READ, lmt->size_);
+        }
+
+        build->map_index_ = MapIndex(&build->listing_.root_, build->map_tree_.get());
+
+        map_tree_timer.stop();
+
+        metrics::ScopedTimer database_timer("base", "load_database");
+
+        const fs::path ldb_path = path / fs::path("RPG_RT.ldb");
+        build->database_ = lcf::LDB_Reader::Load(std::string(ldb_path));
+        if (!build->database_) {
+            error("Could not read " + std::string(ldb_path));
+            return nullptr;
+        }
+
+        if (const auto *ldb = build->listing_.root_.find("RPG_RT.ldb")) {
+            metrics::add(metrics::BYTES_READ, ldb->size_);
+        }
+
+        project_database(*build->database_);
+
+        auto &memory = build->memory_usage_;
+        memory = sizeof(BaseBuild) + listing_memory(build->listing_.root_);
+        for (const auto &[folder, directory]: build->listing_.folders_) {
+            memory += listing_memory(directory);
+        }
+        memory += vector_memory(build->map_tree_->maps) + vector_memory(build->map_tree_->tree_order);
+        for (const auto &common_event: build->database_->commonevents) {
+            memory += sizeof(common_event) + commands_memory(common_event.event_commands);
+        }
+        memory += vector_memory(build->database_->chipsets) + vector_memory(build->database_->switches) +
+                  vector_memory(build->database_->variables) + vector_memory(build->database_->animations);
+
+        return build;
+    }
+
+    std::shared_ptr<const MapEvents> BaseBuild::mapEvents(int map_id, std::string_view content,
+                                                          const std::vector<int32_t> &codes) const {
+        {
+            std::lock_guard lock(maps_mutex_);
+            const auto found = map_events_.find(map_id);
+            if (found != map_events_.end()) {
+                return found->second;
+            }
+        }
+
+        // parsed outside of the lock, so that scans parsing different maps do not wait for each other
+        std::shared_ptr<const MapEvents> events = LmuScanner::parse(content.data(), content.size(), codes);
+        if (!events) {
+            return nullptr;
+        }
+
+        std::lock_guard lock(maps_mutex_);
+        const auto [found, inserted] = map_events_.emplace(map_id, std::move(events));
+        if (inserted) {
+            map_events_memory_usage_ += map_events_memory(*found->second);
+        }
+        return found->second;
+    }
+
+} // chgen
@@ -0,0 +1,127 @@
+#ifndef CU_SUBMITTER_BASE_BUILD_H
+#define CU_SUBMITTER_BASE_BUILD_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <lcf/rpg/database.h>
+#include <lcf/rpg/treemap.h>
+
+#include "../utils/dirscan.h"
+#include "lmu_scanner.h"
+#include "map_index.h"
+
+namespace chgen {
+
+    /**
+     * @brief Lists a build with the folders of every asset category
+     */
+    utils::BuildListing list_build(const std::string &path);
+
+    /**
+     * @brief Name of the file a snapshot records its fingerprint in, at its root
+     */
+    constexpr std::string_view snapshot_manifest = ".cu_snapshot";
+
+    /**
+     * @brief Digest of the name, size, last write time and inode of every listed file of a build
+     * @details Any file of the build written, added, removed or replaced changes it. The snapshot manifest is left
+     * out, so that a snapshot can record its own fingerprint.
+     */
+    uint64_t build_fingerprint(const utils::BuildListing &listing);
+
+    /**
+     * @brief Reads the fingerprint a snapshot recorded when it was created
+     * @return std::nullopt if the build has no snapshot manifest
+     */
+    std::optional<uint64_t> snapshot_fingerprint(const std::string &path);
+
+    /**
+     * @brief The base side of a scan: the listing, map tree and database of a build, parsed once.
+     * @details A loaded base build is read-only, so the scans of several modified builds can share it and run in
+     * parallel. The events of a base map are parsed the first time a scan needs them, and kept for the next scans.
+     * Only the database tables a scan compares are kept, the others are dropped after loading.
+     */
+    class BaseBuild {
+    public:
+        /**
+         * @brief Lists a build and parses its map tree and database
+         * @return nullptr if the build is empty or misses one of them
+         */
+        static std::shared_ptr<const BaseBuild> load(const std::string &path);
+
+        BaseBuild(const BaseBuild &) = delete;
+
+        BaseBuild &operator=(const BaseBuild &) = delete;
+
+        const std::string &path() const {
+            return path_;
+        }
+
+        const utils::BuildListing &listing() const {
+            return listing_;
+        }
+
+        const lcf::rpg::TreeMap &mapTree() const {
+            return *map_tree_;
+        }
+
+        const MapIndex &mapIndex() const {
+            return map_index_;
+        }
+
+        /**
+         * @return The database, with only the common events, tilesets, switches, variables and animations
+         */
+        const lcf::rpg::Database &database() const {
+            return *database_;
+        }
+
+        /**
+         * @return The build_fingerprint of the listing the build was loaded from
+         */
+        uint64_t fingerprint() const {
+            return fingerprint_;
+        }
+
+        /**
+         * @return Estimate of the memory held by the build, parsed maps included
+         */
+        size_t memoryUsage() const {
+            return memory_usage_ + map_events_memory_usage_.load();
+        }
+
+        /**
+         * @brief Returns the events of a map of the build, parsing them the first time
+         * @param content The content of the map file
+         * @param codes The event commands to decode, the same for every call
+         * @return nullptr if the map cannot be parsed
+         */
+        std::shared_ptr<const MapEvents> mapEvents(int map_id, std::string_view content,
+                                                   const std::vector<int32_t> &codes) const;
+
+    private:
+        BaseBuild() = default;
+
+        std::string path_;
+        utils::BuildListing listing_;
+        std::unique_ptr<lcf::rpg::TreeMap> map_tree_;
+        MapIndex map_index_;
+        std::unique_ptr<lcf::rpg::Database> database_;
+        uint64_t fingerprint_ = 0;
+        size_t memory_usage_ = 0;
+
+        mutable std::mutex maps_mutex_;
+        mutable std::atomic<size_t> map_events_memory_usage_{0};
+        mutable std::unordered_map<int, std::shared_ptr<const MapEvents>> map_events_;
+    };
+
+} // chgen
+
+#endif //CU_SUBMITTER_BASE_BUILD_H
@@ -0,0 +1,313 @@
+#include "base_build_cache.h"
+
+#include <chrono>
+#include <filesystem>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "../utils/error.h"
+#include "../utils/log.h"
+
+namespace fs = std::filesystem;
+
+namespace chgen {
+
+    namespace {
+
+        constexpr uint32_t watched_events = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                                            IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+        /**
+         * @return The build of an entry if it is loaded, nullptr if it is loading or could not be loaded
+         */
+        std::shared_ptr<const BaseBuild> loaded(const std::shared_future<std::shared_ptr<const BaseBuild>> &loading) {
+            if (!loading.valid() || loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return nullptr;
+            }
+
+            try {
+                return loading.get();
+            } catch (const std::exception &) {
+                return nullptr;
+            }
+        }
+
+    }
+
+    /**
+     * @brief Tells whether a file of a loaded build changed since it was loaded
+     */
+    class BaseBuildCache::Watch {
+    public:
+        explicit Watch(const BaseBuild &build) : path_(build.path()), fingerprint_(build.fingerprint()) {
+            fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (fd_ < 0) {
+                return;
+            }
+
+            // the same folders as the listing, whose files are all the scan reads
+            bool watched = inotify_add_watch(fd_, path_.c_str(), watched_events) >= 0;
+            for (const auto &[folder, listing]: build.listing().folders_) {
+                const std::string folder_path = path_ + "/" + folder;
+                std::error_code ec;
+                if (watched && fs::is_directory(folder_path, ec)) {
+                    watched = inotify_add_watch(fd_, folder_path.c_str(), watched_events) >= 0;
+                }
+            }
+
+            if (!watched) {
+                // e.g. out of watches: a partial watch would miss changes
+                ::close(fd_);
+                fd_ = -1;
+                return;
+            }
+
+            // changes made while the build was parsed, before the watches existed, raised no event
+            changed_ = build_fingerprint(list_build(path_)) != fingerprint_;
+        }
+
+        ~Watch() {
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+        }
+
+        Watch(const Watch &) = delete;
+
+        Watch &operator=(const Watch &) = delete;
+
+        bool changed() {
+            std::lock_guard lock(mutex_);
+
+            if (changed_) {
+                return true;
+            }
+
+            if (fd_ >= 0) {
+                // any event means a change, their content does not matter
+                alignas(inotify_event) char events[4096];
+                while (::read(fd_, events, sizeof(events)) > 0) {
+                    changed_ = true;
+                }
+                return changed_;
+            }
+
+            changed_ = build_fingerprint(list_build(path_)) != fingerprint_;
+            return changed_;
+        }
+
+    private:
+        std::string path_;
+        uint64_t fingerprint_;
+
+        std::mutex mutex_;
+        int fd_ = -1;
+        bool changed_ = false;
+    };
+
+    BaseBuildCache::BaseBuildCache(size_t memory_budget, const std::vector<std::string> &pinned)
+            : memory_budget_(memory_budget) {
+        for (const auto &path: pinned) {
+            auto &entry = entries_[key(path)];
+            entry.path_ = path;
+            entry.pinned_ = true;
+            entry.generation_ = ++generations_;
+        }
+    }
+
+    BaseBuildCache::~BaseBuildCache() {
+        if (preload_thread_.joinable()) {
+            preload_thread_.join();
+        }
+    }
+
+    void BaseBuildCache::preload() {
+        std::vector<std::string> pinned;
+        {
+            std::lock_guard lock(mutex_);
+            for (const auto &[entry_key, entry]: entries_) {
+                if (entry.pinned_) {
+                    pinned.push_back(entry.path_);
+                }
+            }
+        }
+
+        if (pinned.empty() || preload_thread_.joinable()) {
+            return;
+        }
+
+        preload_thread_ = std::thread([this, pinned = std::move(pinned)]() {
+            for (const auto &path: pinned) {
+                try {
+                    if (get(path) == nullptr) {
+                        error("Could not preload base build " + path);
+                    }
+                } catch (const std::exception &e) {
+                    error("Could not preload base build " + path + ": " + e.what());
+                }
+            }
+        });
+    }
+
+    std::shared_ptr<const BaseBuild> BaseBuildCache::get(const std::string &path) {
+        const std::string entry_key = key(path);
+
+        for (;;) {
+            std::promise<std::shared_ptr<const BaseBuild>> promise;
+            std::shared_future<std::shared_ptr<const BaseBuild>> loading;
+            uint64_t generation;
+            bool loader = false;
+
+            {
+                std::lock_guard lock(mutex_);
+
+                auto &entry = entries_[entry_key];
+                if (entry.path_.empty()) {
+                    entry.path_ = path;
+                    entry.generation_ = ++generations_;
+                }
+                entry.last_used_ = ++clock_;
+
+                // the first request for a build loads it, the others wait for it
+                if (!entry.loading_.valid()) {
+                    entry.loading_ = promise.get_future().share();
+                    loader = true;
+                }
+
+                loading = entry.loading_;
+                generation = entry.generation_;
+            }
+
+            if (loader) {
+                std::shared_ptr<const BaseBuild> build;
+                try {
+                    build = BaseBuild::load(path);
+                } catch (...) {
+                    promise.set_exception(std::current_exception());
+                    drop(entry_key, generation);
+                    throw;
+                }
+
+                auto watch = build ? std::make_shared<Watch>(*build) : nullptr;
+                {
+                    std::lock_guard lock(mutex_);
+
+                    const auto found = entries_.find(entry_key);
+                    if (found != entries_.end() && found->second.generation_ == generation) {
+                        found->second.watch_ = std::move(watch);
+                    }
+                }
+
+                promise.set_value(build);
+
+                if (!build) {
+                    // failures are not cached, the build may be fixed before the next request
+                    drop(entry_key, generation);
+                    return nullptr;
+                }
+
+                std::lock_guard lock(mutex_);
+                evict(entry_key);
+                return build;
+            }
+
+            auto build = loading.get();
+            if (!build) {
+                return nullptr;
+            }
+
+            std::shared_ptr<Watch> watch;
+            {
+                std::lock_guard lock(mutex_);
+
+                const auto found = entries_.find(entry_key);
+                if (found == entries_.end() || found->second.generation_ != generation) {
+                    // evicted or reloaded meanwhile, the build is still the one that was asked for
+                    return build;
+                }
+                watch = found->second.watch_;
+
+                // the maps parsed by the scans grow the cached builds
+                evict(entry_key);
+            }
+
+            if (!watch || !watch->changed()) {
+                return build;
+            }
+
+            log("Base build " + path + " changed, reloading it");
+            drop(entry_key, generation);
+        }
+    }
+
+    size_t BaseBuildCache::memoryUsage() {
+        std::lock_guard lock(mutex_);
+
+        size_t memory = 0;
+        for (const auto &[entry_key, entry]: entries_) {
+            if (const auto build = loaded(entry.loading_)) {
+                memory += build->memoryUsage();
+            }
+        }
+        return memory;
+    }
+
+    std::string BaseBuildCache::key(const std::string &path) {
+        std::error_code ec;
+        const auto canonical = fs::weakly_canonical(path, ec);
+        return ec ? path : canonical.string();
+    }
+
+    void BaseBuildCache::drop(const std::string &entry_key, uint64_t generation) {
+        std::lock_guard lock(mutex_);
+
+        const auto found = entries_.find(entry_key);
+        if (found == entries_.end() || found->second.generation_ != generation) {
+            return;
+        }
+
+        if (!found->second.pinned_) {
+            entries_.erase(found);
+            return;
+        }
+
+        found->second.loading_ = {};
+        found->second.watch_.reset();
+        found->second.generation_ = ++generations_;
+    }
+
+    void BaseBuildCache::evict(const std::string &kept) {
+        size_t memory = 0;
+        for (const auto &[entry_key, entry]: entries_) {
+            if (const auto build = loaded(entry.loading_)) {
+                memory += build->memoryUsage();
+            }
+        }
+
+        while (memory > memory_budget_) {
+            auto evicted = entries_.end();
+            size_t evicted_memory = 0;
+
+            for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+                if (it->second.pinned_ || it->first == kept ||
+                    (evicted != entries_.end() && it->second.last_used_ >= evicted->second.last_used_)) {
+                    continue;
+                }
+                if (const auto build = loaded(it->second.loading_)) {
+                    evicted = it;
+                    evicted_memory = build->memoryUsage();
+                }
+            }
+
+            if (evicted == entries_.end()) {
+                // only pinned builds and the one in use are left
+                break;
+            }
+
+            log("Evicting base build " + evicted->second.path_ + " from the cache");
+            memory -= evicted_memory;
+            entries_.erase(evicted);
+        }
+    }
+
+} // chgen
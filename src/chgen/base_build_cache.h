@@ -0,0 +1,106 @@
+#ifndef CU_SUBMITTER_BASE_BUILD_CACHE_H
+#define CU_SUBMITTER_BASE_BUILD_CACHE_H
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "base_build.h"
+
+namespace chgen {
+
+    /**
+     * @brief Keeps parsed base builds in memory between scans.
+     * @details Pinned builds are loaded ahead of time by preload() and are never evicted. Other builds are kept after
+     * a scan against them, and the least recently used ones are evicted when the estimated memory of every cached
+     * build exceeds the budget.
+     * The listed folders of each cached build are watched with inotify, and a build is reloaded on its next use once
+     * one of its files changed. Where inotify is not available, the build is listed again on each use and reloaded
+     * if its fingerprint changed, which is still much cheaper than parsing it.
+     */
+    class BaseBuildCache {
+    public:
+        static constexpr size_t default_memory_budget = 1024 * 1024 * 1024;
+
+        /**
+         * @param memory_budget Memory the cached builds may use, estimated with BaseBuild::memoryUsage
+         * @param pinned Paths of the builds to keep resident
+         */
+        explicit BaseBuildCache(size_t memory_budget = default_memory_budget, const std::vector<std::string> &pinned = {});
+
+        /**
+         * @brief Waits for preload to finish
+         */
+        ~BaseBuildCache();
+
+        BaseBuildCache(const BaseBuildCache &) = delete;
+
+        BaseBuildCache &operator=(const BaseBuildCache &) = delete;
+
+        /**
+         * @brief Starts loading the pinned builds in the background. Requests for them wait for their loading.
+         */
+        void preload();
+
+        /**
+         * @brief Returns a parsed build, loading it if it is not cached or if its files changed since it was loaded
+         * @return nullptr if the build could not be loaded
+         */
+        std::shared_ptr<const BaseBuild> get(const std::string &path);
+
+        /**
+         * @return The estimated memory of the cached builds
+         */
+        size_t memoryUsage();
+
+    private:
+        class Watch;
+
+        struct Entry {
+            std::string path_;
+            bool pinned_ = false;
+            uint64_t last_used_ = 0;
+            /**
+             * @brief Changes each time the entry is created or reloaded, so that a stale build is only dropped once
+             */
+            uint64_t generation_ = 0;
+            std::shared_future<std::shared_ptr<const BaseBuild>> loading_;
+            std::shared_ptr<Watch> watch_;
+        };
+
+        /**
+         * @return The key of a path in entries_, so that several spellings of a path share their entry
+         */
+        static std::string key(const std::string &path);
+
+        /**
+         * @brief Forgets the build of an entry so that the next request reloads it, unless it was already reloaded.
+         * @details Entries that are not pinned are erased, so that paths that are never requested again, or cannot be
+         * loaded, do not stay in entries_.
+         */
+        void drop(const std::string &key, uint64_t generation);
+
+        /**
+         * @brief Evicts the least recently used builds that are not pinned until the cache fits in its budget
+         * @param kept Key of a build that must not be evicted
+         */
+        void evict(const std::string &kept);
+
+        size_t memory_budget_;
+
+        std::mutex mutex_;
+        std::unordered_map<std::string, Entry> entries_;
+        uint64_t clock_ = 0;
+        uint64_t generations_ = 0;
+
+        std::thread preload_thread_;
+    };
+
+} // chgen
+
+#endif //CU_SUBMITTER_BASE_BUILD_CACHE_H
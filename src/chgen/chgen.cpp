@@ -1,181 +1,146 @@
 #include "chgen.h"
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include "../utils/error.h"
 #include "../utils/log.h"
+#include "../utils/metrics.h"
+#include "../utils/trace.h"
+#include "../utils/dirscan.h"
 #include "../utils/utils.h"
+#include "lmu_scanner.h"
+#include "map_index.h"
+#include "map_prefetcher.h"
 
 using Commands = lcf::rpg::EventCommand::Code;
 
 namespace chgen {
 
     /**
-     * @brief Lists the content of a directory
-     * @param path the path of the directory
-     * @return a vector containing the names of the files in the directory
+     * @brief Lists all events containing a play music event in a map
+     * @param events the event commands of the map we want to analyze
+     * @param base_track the name of the main music of the map; we don't want to scan bgm events that return to this track
+     * @param strings The pool the track names are interned in
+     * @param allocator The allocator of the changelog
+     * @return a list of the BGMEvent objects
      */
-    std::vector<std::string> list_directory_content(std::string path) {
-        std::vector<std::string> content;
-
-        try {
-            if (!fs::exists(path)) {
-                error("The specified path does not exist.");
-                return content;
+    std::pmr::vector<data::BGMEvent> list_bgm_events(const MapEvents &events, const std::string &base_track,
+                                                     data::StringPool &strings,
+                                                     const data::Changelog::allocator_type &allocator) {
+        std::pmr::vector<data::BGMEvent> bgm_events(allocator);
+
+        for (size_t i = 0; i < events.size(); i++) {
+            // We don't list the BGM event if it returns to the main music of the map
+            if (events.code_[i] == static_cast<int>(Commands::PlayBGM) && events.string(i) != base_track) {
+                data::BGMEvent bgm_event;
+
+                bgm_event.coordinates_.x = events.x(i);
+                bgm_event.coordinates_.y = events.y(i);
+                // the same few tracks are played all over a map, each is stored once
+                bgm_event.track_name_ = strings.intern(events.string(i));
+                bgm_event.volume_ = events.param(i, 1);
+                bgm_event.speed_ = events.param(i, 2);
+
+                bgm_events.push_back(std::move(bgm_event));
             }
-
-            if (!fs::is_directory(path)) {
-                error("The specified path is not a directory.");
-                return content;
-            }
-
-            for (const auto &file: fs::directory_iterator(path)) {
-                content.push_back(file.path().filename().string());
-            }
-
-        } catch (const std::exception &e) {
-            error(std::string(e.what()));
         }
 
-        return content;
+        return bgm_events;
     }
 
     /**
-     * @brief Lists all events containing a play music event in a map
-     * @param map the map we want to analyze
-     * @param base_track the name of the main music of the map; we don't want to scan bgm events that return to this track
-     * @return a list of the BGMEvent objects
+     * @brief Lists the assets added, removed or modified in a category
+     * @param base_listing The listing of the base build
+     * @param modified_listing The listing of the modified build
+     * @param strings The pool the asset names are interned in
+     * @return a list of the Asset objects, removed assets first
      */
-    std::vector<data::BGMEvent> list_bgm_events(std::unique_ptr<lcf::rpg::Map> map, std::string base_track) {
-        std::vector<data::BGMEvent> bgm_events;
-
-        for (const auto &event: map->events) {
-            for (const auto &page: event.pages) {
-                for (const auto &command: page.event_commands) {
-                    // We don't list the BGM event if it returns to the main music of the map
-                    if (command.code == static_cast<int>(Commands::PlayBGM) && command.string.data() != base_track) {
-                        data::BGMEvent bgm_event;
-
-                        bgm_event.coordinates_.x = event.x;
-                        bgm_event.coordinates_.y = event.y;
-                        bgm_event.track_name_ = command.string.data();
-                        auto params = command.parameters.begin();
-                        bgm_event.volume_ = *std::next(params, 1);
-                        bgm_event.speed_ = *std::next(params, 2);
-
-                        bgm_events.push_back(bgm_event);
-                    }
+    std::pmr::vector<data::Asset>
+    add_assets(const std::string &base_path, const std::string &modified_path, const utils::BuildListing &base_listing,
+               const utils::BuildListing &modified_listing, data::AssetCategory category, data::StringPool &strings,
+               const data::Changelog::allocator_type &allocator) {
+        std::pmr::vector<data::Asset> assets(allocator);
+
+        const std::string folder = data::asset_folder(category);
+        trace::Span span("assets", folder);
+
+        const auto &base_assets = base_listing.folder(folder).entries_;
+        const auto &modified_assets = modified_listing.folder(folder).entries_;
+
+        const auto make_asset = [category, &strings, &allocator](const utils::FileEntry &file, data::Status status) {
+            data::Asset changelog_asset(allocator);
+            changelog_asset.category_ = category;
+            changelog_asset.status_ = status;
+            changelog_asset.name_ = strings.intern(std::string_view(file.name_).substr(0, file.name_.find_first_of('.')));
+            changelog_asset.filename_ = strings.intern(file.name_);
+            return changelog_asset;
+        };
+
+        // Both listings are sorted by name, so a single merge pass pairs them up
+        std::pmr::vector<data::Asset> added_or_modified(allocator);
+        auto base_it = begin(base_assets);
+        auto modified_it = begin(modified_assets);
+
+        while (base_it != end(base_assets) || modified_it != end(modified_assets)) {
+            if (modified_it == end(modified_assets) ||
+                (base_it != end(base_assets) && base_it->name_ < modified_it->name_)) {
+                if (!base_it->is_directory_) {
+                    // asset removed
+                    assets.push_back(make_asset(*base_it, data::Status::REMOVED));
                 }
+                ++base_it;
+                continue;
             }
-        }
-
-        return bgm_events;
-    }
 
-    std::vector<data::Asset>
-    add_assets(std::string base_path, std::string modified_path, data::AssetCategory category) {
-        std::vector<data::Asset> assets;
-
-        std::string folder;
-        switch (category) {
-            case data::AssetCategory::MENU_THEME:
-                folder = "System";
-                break;
-            case data::AssetCategory::CHARSET:
-                folder = "CharSet";
-                break;
-            case data::AssetCategory::CHIPSET:
-                folder = "ChipSet";
-                break;
-            case data::AssetCategory::MUSIC:
-                folder = "Music";
-                break;
-            case data::AssetCategory::SOUND:
-                folder = "Sound";
-                break;
-            case data::AssetCategory::PANORAMA:
-                folder = "Panorama";
-                break;
-            case data::AssetCategory::PICTURE:
-                folder = "Picture";
-                break;
-            case data::AssetCategory::BATTLE_ANIMATION:
-                folder = "Battle";
-                break;
-        }
+            if (base_it == end(base_assets) || modified_it->name_ < base_it->name_) {
+                if (!modified_it->is_directory_) {
+                    // asset added
+                    added_or_modified.push_back(make_asset(*modified_it, data::Status::ADDED));
+                }
+                ++modified_it;
+                continue;
+            }
 
-        auto base_asset_content = list_directory_content(std::string(base_path / fs::path(folder)));
-        auto modified_asset_content = list_directory_content(std::string(modified_path / fs::path(folder)));
+            const auto &base_asset = *base_it++;
+            const auto &modified_asset = *modified_it++;
 
-        for (const auto &asset: base_asset_content) {
-            const auto asset_name = asset.substr(0, asset.find_first_of('.'));
-            /*if (asset_name.rfind("record_player_", 0) == 0) {
-                // ignore record player assets
+            if (base_asset.is_directory_ || modified_asset.is_directory_ ||
+                base_asset.mtime_ == modified_asset.mtime_) {
+                // asset unchanged
                 continue;
-            }*/
-
-            if (std::find(begin(modified_asset_content), end(modified_asset_content), asset) ==
-                end(modified_asset_content)) {
-                // asset removed
-                data::Asset changelog_asset;
-                changelog_asset.category_ = category;
-                changelog_asset.status_ = data::Status::REMOVED;
-                changelog_asset.name_ = asset_name;
-                changelog_asset.filename_ = asset;
-                assets.push_back(changelog_asset);
             }
-        }
 
-        for (const auto &asset: modified_asset_content) {
-            const auto asset_name = asset.substr(0, asset.find_first_of('.'));
-            /*if (asset_name.rfind("record_player_", 0) == 0) {
-                // ignore record player assets
-                continue;
-            }*/
-
-            if (std::find(begin(base_asset_content), end(base_asset_content), asset) ==
-                end(base_asset_content)) {
-                // asset added
-                data::Asset changelog_asset;
-                changelog_asset.category_ = category;
-                changelog_asset.status_ = data::Status::ADDED;
-                changelog_asset.name_ = asset_name;
-                changelog_asset.filename_ = asset;
-                assets.push_back(changelog_asset);
-            } else {
-                // asset modified
-                try {
-                    const auto base_asset_path = base_path / fs::path(folder) / fs::path(asset);
-                    const auto modified_asset_path = modified_path / fs::path(folder) / fs::path(asset);
-
-                    const auto base_lastwritetime = fs::last_write_time(base_asset_path);
-                    const auto modified_lastwritetime = fs::last_write_time(modified_asset_path);
-
-
-                    if (base_lastwritetime != modified_lastwritetime) {
-                        if (utils::compareFiles(base_asset_path, modified_asset_path)) {
-                            // asset unchanged
-                            continue;
-                        }
-
-                        data::Asset changelog_asset;
-                        changelog_asset.category_ = category;
-                        changelog_asset.status_ = data::Status::MODIFIED;
-                        changelog_asset.name_ = asset_name;
-                        changelog_asset.filename_ = asset;
-                        assets.push_back(changelog_asset);
-                    }
-                } catch (const std::exception &e) {
-                    error(std::string(e.what()));
+            if (base_asset.size_ == modified_asset.size_) {
+                const auto base_asset_path = base_path / fs::path(folder) / fs::path(base_asset.name_);
+                const auto modified_asset_path = modified_path / fs::path(folder) / fs::path(modified_asset.name_);
+
+                if (utils::compareFiles(base_asset_path, modified_asset_path)) {
+                    // asset unchanged
+                    continue;
                 }
             }
+
+            // asset modified
+            added_or_modified.push_back(make_asset(modified_asset, data::Status::MODIFIED));
         }
 
+        assets.insert(end(assets), std::make_move_iterator(begin(added_or_modified)),
+                      std::make_move_iterator(end(added_or_modified)));
+
         return assets;
     }
 
-    std::vector<data::CommonEvent>
-    add_ce(std::vector<lcf::rpg::CommonEvent> base_ce_list, std::vector<lcf::rpg::CommonEvent> modified_ce_list) {
-        std::vector<data::CommonEvent> commonEvents;
+    std::pmr::vector<data::CommonEvent>
+    add_ce(const std::vector<lcf::rpg::CommonEvent> &base_ce_list,
+           const std::vector<lcf::rpg::CommonEvent> &modified_ce_list,
+           const data::Changelog::allocator_type &allocator) {
+        trace::Span span("database", "common events");
+
+        std::pmr::vector<data::CommonEvent> commonEvents(allocator);
 
         for (size_t i = 0; i < std::min(base_ce_list.size(), modified_ce_list.size()); i++) {
             const auto &base_ce = base_ce_list[i];
@@ -186,10 +151,10 @@ namespace chgen {
                 continue;
             }
 
-            const std::string &base_ce_name = base_ce.name.data();
-            const std::string &modified_ce_name = modified_ce.name.data();
+            const std::string_view base_ce_name(base_ce.name.data(), base_ce.name.size());
+            const std::string_view modified_ce_name(modified_ce.name.data(), modified_ce.name.size());
 
-            data::CommonEvent changelog_ce;
+            data::CommonEvent changelog_ce(allocator);
             changelog_ce.id_ = modified_ce.ID;
             changelog_ce.name_ = modified_ce_name;
 
@@ -206,16 +171,19 @@ namespace chgen {
                 changelog_ce.status_ = data::Status::MODIFIED;
             }
 
-            commonEvents.push_back(changelog_ce);
+            commonEvents.push_back(std::move(changelog_ce));
         }
 
         return commonEvents;
     }
 
-    std::vector<data::TilesetInfo>
-    add_tilesets(std::vector<lcf::rpg::Chipset> base_tileset_list,
-                 std::vector<lcf::rpg::Chipset> modified_tileset_list) {
-        std::vector<data::TilesetInfo> tilesets;
+    std::pmr::vector<data::TilesetInfo>
+    add_tilesets(const std::vector<lcf::rpg::Chipset> &base_tileset_list,
+                 const std::vector<lcf::rpg::Chipset> &modified_tileset_list, data::StringPool &strings,
+                 const data::Changelog::allocator_type &allocator) {
+        trace::Span span("database", "tilesets");
+
+        std::pmr::vector<data::TilesetInfo> tilesets(allocator);
 
         for (size_t i = 0; i < std::min(base_tileset_list.size(), modified_tileset_list.size()); i++) {
             const auto &base_tileset = base_tileset_list[i];
@@ -226,13 +194,15 @@ namespace chgen {
                 continue;
             }
 
-            const std::string &base_tileset_name = base_tileset.name.data();
-            const std::string &modified_tileset_name = modified_tileset.name.data();
+            const std::string_view base_tileset_name(base_tileset.name.data(), base_tileset.name.size());
+            const std::string_view modified_tileset_name(modified_tileset.name.data(), modified_tileset.name.size());
 
-            data::TilesetInfo changelog_tileset;
+            data::TilesetInfo changelog_tileset(allocator);
             changelog_tileset.id_ = modified_tileset.ID;
             changelog_tileset.name_ = modified_tileset_name;
-            changelog_tileset.chipset_name_ = modified_tileset.chipset_name.data();
+            // most tilesets share a handful of chipsets
+            changelog_tileset.chipset_name_ = strings.intern(
+                    std::string_view(modified_tileset.chipset_name.data(), modified_tileset.chipset_name.size()));
 
 
             if (base_tileset_name.empty()) {
@@ -247,15 +217,19 @@ namespace chgen {
                 changelog_tileset.status_ = data::Status::MODIFIED;
             }
 
-            tilesets.push_back(changelog_tileset);
+            tilesets.push_back(std::move(changelog_tileset));
         }
 
         return tilesets;
     }
 
-    std::vector<data::Switch>
-    add_switches(std::vector<lcf::rpg::Switch> base_switch_list, std::vector<lcf::rpg::Switch> modified_variable_list) {
-        std::vector<data::Switch> switches;
+    std::pmr::vector<data::Switch>
+    add_switches(const std::vector<lcf::rpg::Switch> &base_switch_list,
+                 const std::vector<lcf::rpg::Switch> &modified_variable_list,
+                 const data::Changelog::allocator_type &allocator) {
+        trace::Span span("database", "switches");
+
+        std::pmr::vector<data::Switch> switches(allocator);
 
         for (size_t i = 0; i < std::min(base_switch_list.size(), modified_variable_list.size()); i++) {
             const auto &base_switch = base_switch_list[i];
@@ -266,10 +240,10 @@ namespace chgen {
                 continue;
             }
 
-            const std::string &base_switch_name = base_switch.name.data();
-            const std::string &modified_switch_name = modified_switch.name.data();
+            const std::string_view base_switch_name(base_switch.name.data(), base_switch.name.size());
+            const std::string_view modified_switch_name(modified_switch.name.data(), modified_switch.name.size());
 
-            data::Switch changelog_switch;
+            data::Switch changelog_switch(allocator);
             changelog_switch.id_ = modified_switch.ID;
             changelog_switch.name_ = modified_switch_name;
 
@@ -285,15 +259,19 @@ namespace chgen {
                 changelog_switch.status_ = data::Status::MODIFIED;
             }
 
-            switches.push_back(changelog_switch);
+            switches.push_back(std::move(changelog_switch));
         }
 
         return switches;
     }
 
-    std::vector<data::Variable>
-    add_variables(std::vector<lcf::rpg::Variable> base_var_list, std::vector<lcf::rpg::Variable> modified_var_list) {
-        std::vector<data::Variable> variables;
+    std::pmr::vector<data::Variable>
+    add_variables(const std::vector<lcf::rpg::Variable> &base_var_list,
+                  const std::vector<lcf::rpg::Variable> &modified_var_list,
+                  const data::Changelog::allocator_type &allocator) {
+        trace::Span span("database", "variables");
+
+        std::pmr::vector<data::Variable> variables(allocator);
 
         for (size_t i = 0; i < std::min(base_var_list.size(), modified_var_list.size()); i++) {
             const auto &base_var = base_var_list[i];
@@ -304,10 +282,10 @@ namespace chgen {
                 continue;
             }
 
-            const std::string &base_var_name = base_var.name.data();
-            const std::string &modified_var_name = modified_var.name.data();
+            const std::string_view base_var_name(base_var.name.data(), base_var.name.size());
+            const std::string_view modified_var_name(modified_var.name.data(), modified_var.name.size());
 
-            data::Variable changelog_var;
+            data::Variable changelog_var(allocator);
             changelog_var.id_ = modified_var.ID;
             changelog_var.name_ = modified_var_name;
 
@@ -324,16 +302,19 @@ namespace chgen {
                 changelog_var.status_ = data::Status::MODIFIED;
             }
 
-            variables.push_back(changelog_var);
+            variables.push_back(std::move(changelog_var));
         }
 
         return variables;
     }
 
-    std::vector<data::Animation>
-    add_animations(std::vector<lcf::rpg::Animation> base_anim_list,
-                   std::vector<lcf::rpg::Animation> modified_anim_list) {
-        std::vector<data::Animation> animations;
+    std::pmr::vector<data::Animation>
+    add_animations(const std::vector<lcf::rpg::Animation> &base_anim_list,
+                   const std::vector<lcf::rpg::Animation> &modified_anim_list,
+                   const data::Changelog::allocator_type &allocator) {
+        trace::Span span("database", "animations");
+
+        std::pmr::vector<data::Animation> animations(allocator);
 
         for (size_t i = 0; i < std::min(base_anim_list.size(), modified_anim_list.size()); i++) {
             const auto &base_anim = base_anim_list[i];
@@ -344,10 +325,10 @@ namespace chgen {
                 continue;
             }
 
-            const std::string &base_anim_name = base_anim.name.data();
-            const std::string &modified_anim_name = modified_anim.name.data();
+            const std::string_view base_anim_name(base_anim.name.data(), base_anim.name.size());
+            const std::string_view modified_anim_name(modified_anim.name.data(), modified_anim.name.size());
 
-            data::Animation changelog_anim;
+            data::Animation changelog_anim(allocator);
             changelog_anim.id_ = modified_anim.ID;
             changelog_anim.name_ = modified_anim_name;
 
@@ -363,7 +344,7 @@ namespace chgen {
                 changelog_anim.status_ = data::Status::MODIFIED;
             }
 
-            animations.push_back(changelog_anim);
+            animations.push_back(std::move(changelog_anim));
         }
 
         return animations;
@@ -371,72 +352,146 @@ namespace chgen {
 
     /**
      * @brief Lists all events containing a transfer player event to another map  in a map
-     * @param map The map we want to analyze
+     * @param events The event commands of the map we want to analyze
      * @param map_id The ID of the map in argument map; We don't want to list inter-map warps
      * @return A list of the Connection objects
      */
-    std::vector<data::Connection> list_warp_events(std::unique_ptr<lcf::rpg::Map> map, int map_id) {
+    std::vector<data::Connection> list_warp_events(const MapEvents &events, int map_id) {
         std::vector<data::Connection> connections;
-        data::Map map_data;
-        map_data.id_ = map_id;
-
-        for (const auto &event: map->events) {
-            for (const auto &page: event.pages) {
-                for (const auto &command: page.event_commands) {
-                    if (command.code != static_cast<int>(Commands::Teleport)) {
-                        continue;
-                    }
-                    data::Connection connection;
-                    connection.type_ = data::ConnectionType::ONEWAY;
-                    connection.status_ = data::Status::ADDED;
-                    connection.from_map_ = map_data;
-                    connection.from_coordinates_ = data::Coordinates{event.x, event.y};
-
-                    auto params = command.parameters.begin();
-                    connection.to_map_ = data::Map{};
-                    connection.to_map_.id_ = *params;
-                    connection.to_coordinates_ = data::Coordinates{*std::next(params, 1), *std::next(params, 2)};
-
-                    if (connection.from_map_.id_ == connection.to_map_.id_) {
-                        // same map
-                        continue;
-                    }
-                    connections.push_back(connection);
-                }
+
+        for (size_t i = 0; i < events.size(); i++) {
+            if (events.code_[i] != static_cast<int>(Commands::Teleport)) {
+                continue;
+            }
+            const auto to_map_id = static_cast<unsigned int>(events.param(i, 0));
+            if (to_map_id == static_cast<unsigned int>(map_id)) {
+                // same map
+                continue;
             }
+
+            data::Connection connection;
+            connection.type_ = data::ConnectionType::ONEWAY;
+            connection.status_ = data::Status::ADDED;
+            connection.from_map_id_ = map_id;
+            connection.from_coordinates_ = data::Coordinates{events.x(i), events.y(i)};
+
+            connection.to_map_id_ = to_map_id;
+            connection.to_coordinates_ = data::Coordinates{events.param(i, 1), events.param(i, 2)};
+
+            connections.push_back(std::move(connection));
         }
 
         return connections;
     }
 
 
+    /**
+     * @brief A changed map waiting for its files to be read
+     */
+    struct MapCandidate {
+        int id_;
+        const lcf::rpg::MapInfo *base_info_;
+        const lcf::rpg::MapInfo *modified_info_;
+    };
+
     /**
      * @brief Scans two RPG Maker game files for changes that are relevant in Collective Unconscious.
      * @param base_path The base path, usually the newest devbuild
      * @param modified_path The path of the build we made changes on
+     * @param stats If not null, filled with the number of maps decided at each step of the map scan
      * @return A changelog object containing the changes between the two builds
      */
     std::shared_ptr<data::Changelog>
-    ChangelogGenerator::scan(const std::string &base_path, const std::string &modified_path) {
-        log("Scanning changes between " + base_path + " and " + modified_path + "...");
-
-        auto base_content = list_directory_content(base_path);
-        if (base_content.empty()) {
+    ChangelogGenerator::scan(const std::string &base_path, const std::string &modified_path, ScanStats *stats) {
+        const auto base = BaseBuild::load(base_path);
+        if (base == nullptr) {
             return nullptr;
         }
 
-        auto modified_content = list_directory_content(modified_path);
-        if (modified_content.empty()) {
+        return scan(*base, modified_path, stats);
+    }
+
+    std::vector<std::shared_ptr<data::Changelog>>
+    ChangelogGenerator::scanBatch(const std::string &base_path, const std::vector<std::string> &modified_paths,
+                                  size_t threads) {
+        // parsing the base dominates a scan, so it is only done once for the whole batch
+        const auto base = BaseBuild::load(base_path);
+        if (base == nullptr) {
+            return std::vector<std::shared_ptr<data::Changelog>>(modified_paths.size());
+        }
+
+        return scanBatch(*base, modified_paths, threads);
+    }
+
+    std::vector<std::shared_ptr<data::Changelog>>
+    ChangelogGenerator::scanBatch(const BaseBuild &base, const std::vector<std::string> &modified_paths,
+                                  size_t threads) {
+        std::vector<std::shared_ptr<data::Changelog>> changelogs(modified_paths.size());
+
+        std::atomic<size_t> next{0};
+        auto *session = trace::Session::current();
+
+        const auto work = [&]() {
+            trace::Activate activate(session);
+
+            for (size_t i = next++; i < modified_paths.size(); i = next++) {
+                try {
+                    changelogs[i] = scan(base, modified_paths[i]);
+                } catch (const std::exception &e) {
+                    error("Could not scan " + modified_paths[i] + ": " + e.what());
+                }
+            }
+        };
+
+        std::vector<std::future<void>> workers;
+        const size_t worker_count = std::clamp<size_t>(threads, 1, std::max<size_t>(modified_paths.size(), 1));
+        for (size_t i = 1; i < worker_count; i++) {
+            workers.push_back(std::async(std::launch::async, work));
+        }
+
+        work();
+        for (auto &worker: workers) {
+            worker.get();
+        }
+
+        return changelogs;
+    }
+
+    /**
+     * @brief Scans a modified build for changes against a loaded base build.
+     * @param base The base build, usually the newest devbuild
+     * @param modified_path The path of the build we made changes on
+     * @param stats If not null, filled with the number of maps decided at each step of the map scan
+     * @return A changelog object containing the changes between the two builds
+     */
+    std::shared_ptr<data::Changelog>
+    ChangelogGenerator::scan(const BaseBuild &base, const std::string &modified_path, ScanStats *stats) {
+        const std::string &base_path = base.path();
+        log("Scanning changes between " + base_path + " and " + modified_path + "...");
+
+        metrics::ScopedTimer total_timer("scan", "total");
+        metrics::ScopedTimer list_timer("scan", "list_build");
+
+        // Every file of both builds is listed and stat'ed once, the base when it was loaded; the diff stages below
+        // only read these tables
+        const auto &base_listing = base.listing();
+
+        const auto modified_listing = list_build(modified_path);
+        if (modified_listing.root_.entries_.empty()) {
             return nullptr;
         }
 
-        auto changelog = std::make_shared<data::Changelog>();
+        list_timer.stop();
+
+        // every entry is allocated in the arena of the changelog, released at once when it is dropped
+        auto changelog = data::Changelog::withArena();
+        const auto allocator = changelog->get_allocator();
 
         // TODO: get developer name
         changelog->developer_ = "No_dev_name";
 
         auto now = time(nullptr);
-        changelog->date_ = localtime(&now);
+        localtime_r(&now, &changelog->date_);
 
         // TODO: get summary name
         changelog->summary_ = "";
@@ -445,35 +500,8 @@ namespace chgen {
         changelog->map_policy_ = "";
         changelog->asset_policy_ = "";
 
-        // maps
-        std::vector<std::string> base_maps;
-        std::remove_copy_if(begin(base_content), end(base_content), std::back_inserter(base_maps),
-                            [](const std::string &s) {
-                                return s.substr(s.find_last_of('.') + 1) != "lmu";
-                            });
-
-        std::sort(begin(base_maps), end(base_maps), [](const std::string &a, const std::string &b) {
-            return std::stoi(a.substr(3, a.find_first_of('.'))) < std::stoi(b.substr(3, b.find_first_of('.')));
-        });
-
-        std::vector<std::string> modified_maps;
-        std::remove_copy_if(begin(modified_content), end(modified_content), std::back_inserter(modified_maps),
-                            [](const std::string &s) {
-                                return s.substr(s.find_last_of('.') + 1) != "lmu";
-                            });
-
-        std::sort(begin(modified_maps), end(modified_maps), [](const std::string &a, const std::string &b) {
-            return std::stoi(a.substr(3, a.find_first_of('.'))) < std::stoi(b.substr(3, b.find_first_of('.')));
-        });
-
         // map tree
-        fs::path base_lmt_path = base_path / fs::path("RPG_RT.lmt");
-        if (!fs::exists(base_lmt_path)) {
-            error("Missing file: " + std::string(base_lmt_path));
-            return nullptr;
-        }
-
-        auto base_map_tree = lcf::LMT_Reader::Load(std::string(base_lmt_path));
+        metrics::ScopedTimer map_tree_timer("scan", "load_map_tree");
 
         fs::path modified_lmt_path = modified_path / fs::path("RPG_RT.lmt");
         if (!fs::exists(modified_lmt_path)) {
@@ -483,45 +511,110 @@ namespace chgen {
 
         auto modified_map_tree = lcf::LMT_Reader::Load(std::string(modified_lmt_path));
 
+        if (const auto *lmt = modified_listing.root_.find("RPG_RT.lmt")) {
+            metrics::add(metrics::BYTES_READ, lmt->size_);
+        }
+
+        map_tree_timer.stop();
+
         // maps scan
-        for (const auto &map: modified_maps) {
+        metrics::ScopedTimer maps_timer("scan", "maps");
+
+        const std::vector<int32_t> scanned_commands = {
+                static_cast<int32_t>(Commands::PlayBGM),
+                static_cast<int32_t>(Commands::Teleport)
+        };
+
+        ScanStats map_stats;
+        const lcf::rpg::MapInfo blank_map_info;
+
+        // Dense ID -> file and map tree entry tables, so that nothing below searches or assumes index == ID
+        const MapIndex &base_index = base.mapIndex();
+        const MapIndex modified_index(&modified_listing.root_, modified_map_tree.get());
 
-            if (std::find(begin(base_maps), end(base_maps), map) == end(base_maps)) {
+        // First pass: everything that can be decided without reading the map files
+        std::vector<MapCandidate> candidates;
+        std::vector<MapFileRequest> map_files;
+
+        for (const int map_id: modified_index.fileIds()) {
+            const auto &modified_file = *modified_index.find(map_id)->file_;
+
+            const auto *base_entry = base_index.find(map_id);
+            if (!base_entry || !base_entry->file_) {
                 // empty map file added
                 continue;
             }
 
-            const auto base_lastwritetime = fs::last_write_time(base_path / fs::path(map));
-            const auto modified_lastwritetime = fs::last_write_time(modified_path / fs::path(map));
+            const auto &base_file = *base_entry->file_;
 
-            if (base_lastwritetime == modified_lastwritetime) {
+            if (base_file.mtime_ == modified_file.mtime_) {
                 // map file unchanged
+                map_stats.maps_same_mtime_++;
                 continue;
             }
 
-            const int map_id = std::stoi(map.substr(3, map.find_first_of('.')));
-
             if (map_id == 7) {
                 // ignore record player
                 continue;
             }
 
-            auto base_map = base_map_tree->maps[map_id];
-            auto modified_map = modified_map_tree->maps[map_id];
+            const auto *modified_map = modified_index.info(map_id);
+            if (!modified_map) {
+                error("Map " + data::id_string(map_id) + " is missing from " + std::string(modified_lmt_path));
+                continue;
+            }
+
+            // a map missing from the base map tree is compared against a blank entry
+            const auto *base_map = base_index.info(map_id);
+            if (!base_map) {
+                base_map = &blank_map_info;
+            }
 
-            if (base_map == modified_map) {
+            if (*base_map == *modified_map) {
                 // map unchanged
+                map_stats.maps_same_info_++;
                 continue;
             }
 
-            const std::string modified_map_name = modified_map.name.data();
-            const std::string base_map_name = base_map.name.data();
-            if (modified_map_name.length() < 5) {
+            if (std::string(modified_map->name.data()).length() < 5) {
                 // empty map (just the id in the name)
                 continue;
             }
 
-            data::Map changelog_map;
+            candidates.push_back(MapCandidate{map_id, base_map, modified_map});
+            map_files.push_back(MapFileRequest{std::string(base_path / fs::path(base_file.name_)),
+                                               std::string(modified_path / fs::path(modified_file.name_))});
+        }
+
+        // Second pass: the prefetcher reads the next map files while we parse the current ones
+        MapPrefetcher prefetcher(std::move(map_files));
+
+        while (auto files = prefetcher.next()) {
+            const auto &candidate = candidates[files->index_];
+            const int map_id = candidate.id_;
+            trace::Span span("map", MapIndex::filename(map_id));
+            const auto &base_map = *candidate.base_info_;
+            const auto &modified_map = *candidate.modified_info_;
+
+            if (!files->base_ok_ || !files->modified_ok_) {
+                error("Could not read Map" + data::id_string(map_id) + ".lmu");
+                prefetcher.release(std::move(files));
+                continue;
+            }
+
+            // A fresh copy of a build changes every last write time, so we check whether the file content
+            // actually changed before parsing anything.
+            bool same_content = false;
+            if (files->base_content_.size() != files->modified_content_.size()) {
+                map_stats.maps_size_changed_++;
+            } else {
+                same_content = files->base_content_ == files->modified_content_;
+            }
+
+            const std::string modified_map_name = modified_map.name.data();
+            const std::string base_map_name = base_map.name.data();
+
+            data::Map changelog_map(allocator);
 
             if (base_map_name != modified_map_name) {
                 changelog_map.status_ = data::Status::ADDED;
@@ -530,78 +623,131 @@ namespace chgen {
             }
 
             changelog_map.id_ = map_id;
-            changelog_map.name_ = modified_map_name.substr(5);
+            changelog_map.name_ = changelog->strings_.intern(std::string_view(modified_map_name).substr(5));
+
+            // only the commands we report on are decoded, tile layers are skipped
+            const auto modified_lmu = LmuScanner::parse(files->modified_content_.data(),
+                                                        files->modified_content_.size(), scanned_commands);
+
+            // the map tree entry changed but the map file did not: there is no warp to compare
+            // base maps are parsed once per base build, and shared by every scan against it
+            std::shared_ptr<const MapEvents> base_lmu;
+            if (modified_lmu && same_content) {
+                map_stats.maps_same_content_++;
+            } else if (modified_lmu) {
+                base_lmu = base.mapEvents(map_id, files->base_content_, scanned_commands);
+                map_stats.maps_parsed_++;
+            }
 
-            auto modified_lmu = lcf::LMU_Reader::Load(std::string(modified_path / fs::path(map)));
-            auto modified_lmu_copy = std::make_unique<lcf::rpg::Map>(*modified_lmu);
+            prefetcher.release(std::move(files));
 
-            auto base_lmu = lcf::LMU_Reader::Load(std::string(base_path / fs::path(map)));
+            if (!modified_lmu || (!same_content && !base_lmu)) {
+                error("Could not parse Map" + data::id_string(map_id) + ".lmu");
+                continue;
+            }
 
             if (map_id != 7) {
                 // ignore bgm events for record player
-                changelog_map.bgm_events_ = list_bgm_events(std::move(modified_lmu), modified_map.music.name);
+                changelog_map.bgm_events_ = list_bgm_events(*modified_lmu, modified_map.music.name, changelog->strings_,
+                                                           allocator);
             }
 
             changelog_map.main_music_ = modified_map.music;
 
-            changelog->maps_.push_back(changelog_map);
+            changelog->maps_.push_back(std::move(changelog_map));
+
+            if (same_content) {
+                continue;
+            }
 
             // connections
             // TODO: put a warning to tell the user that all connections to a different map ID will be noted
-            auto base_warps = list_warp_events(std::move(base_lmu), map_id);
-            auto modified_warps = list_warp_events(std::move(modified_lmu_copy), map_id);
+            auto base_warps = list_warp_events(*base_lmu, map_id);
+            auto modified_warps = list_warp_events(*modified_lmu, map_id);
 
-            std::vector<data::Connection> warps;
+            // warps are matched by (from coordinates, to map, to coordinates); the first warp of a key is kept
+            std::unordered_set<data::ConnectionKey, data::ConnectionKeyHash> base_keys;
+            std::unordered_map<data::ConnectionKey, const data::Connection *, data::ConnectionKeyHash> modified_index;
+            base_keys.reserve(base_warps.size());
+            modified_index.reserve(modified_warps.size());
 
+            for (const auto &warp: base_warps) {
+                base_keys.emplace(warp);
+            }
             for (const auto &warp: modified_warps) {
-                if (std::find(begin(base_warps), end(base_warps), warp) == end(base_warps)) {
+                modified_index.emplace(data::ConnectionKey(warp), &warp);
+            }
+
+            for (auto &warp: modified_warps) {
+                if (base_keys.find(data::ConnectionKey(warp)) == base_keys.end()) {
                     // warp added
-                    warps.push_back(warp);
+                    changelog->connections_.push_back(warp);
                 }
             }
 
-            for (const auto &warp: base_warps) {
-                if (std::find(begin(modified_warps), end(modified_warps), warp) == end(modified_warps)) {
+            for (auto &warp: base_warps) {
+                const auto modified_warp = modified_index.find(data::ConnectionKey(warp));
+                if (modified_warp == modified_index.end()) {
                     // warp removed
-                    auto removed_warp = warp;
-                    removed_warp.status_ = data::Status::REMOVED;
-                    warps.push_back(removed_warp);
-                } else {
+                    warp.status_ = data::Status::REMOVED;
+                    changelog->connections_.push_back(warp);
+                } else if (warp != *modified_warp->second) {
                     // warp modified
-                    auto modified_warp = std::find(begin(modified_warps), end(modified_warps), warp);
-                    if (warp != *modified_warp) {
-                        auto modified_warp = warp;
-                        modified_warp.status_ = data::Status::MODIFIED;
-                        warps.push_back(modified_warp);
-                    }
+                    warp.status_ = data::Status::MODIFIED;
+                    changelog->connections_.push_back(warp);
                 }
             }
+        }
 
-            for (const auto &warp: warps) {
-                changelog->connections_.push_back(warp);
-            }
+        log("Maps: " + std::to_string(map_stats.maps_same_mtime_) + " unchanged (last write time), " +
+            std::to_string(map_stats.maps_same_info_) + " unchanged (map tree entry), " +
+            std::to_string(map_stats.maps_size_changed_) + " with a different size, " +
+            std::to_string(map_stats.maps_same_content_) + " byte-identical, " +
+            std::to_string(map_stats.maps_parsed_) + " parsed");
+
+        if (stats) {
+            *stats = map_stats;
         }
 
+        maps_timer.stop();
 
         // database stuff
-        auto base_db = lcf::LDB_Reader::Load(std::string(base_path / fs::path("RPG_RT.ldb")));
+        metrics::ScopedTimer database_timer("scan", "load_database");
+
+        const auto &base_db = base.database();
         auto modified_db = lcf::LDB_Reader::Load(std::string(modified_path / fs::path("RPG_RT.ldb")));
+        if (!modified_db) {
+            error("Could not read " + std::string(modified_path / fs::path("RPG_RT.ldb")));
+            return nullptr;
+        }
+
+        if (const auto *ldb = modified_listing.root_.find("RPG_RT.ldb")) {
+            metrics::add(metrics::BYTES_READ, ldb->size_);
+        }
+
+        database_timer.stop();
 
-        changelog->common_events_ = add_ce(base_db->commonevents, modified_db->commonevents);
-        changelog->tilesets_ = add_tilesets(base_db->chipsets, modified_db->chipsets);
-        changelog->switches_ = add_switches(base_db->switches, modified_db->switches);
-        changelog->variables_ = add_variables(base_db->variables, modified_db->variables);
-        changelog->animations_ = add_animations(base_db->animations, modified_db->animations);
+        metrics::ScopedTimer diff_timer("scan", "diff_database");
+
+        changelog->common_events_ = add_ce(base_db.commonevents, modified_db->commonevents, allocator);
+        changelog->tilesets_ = add_tilesets(base_db.chipsets, modified_db->chipsets, changelog->strings_, allocator);
+        changelog->switches_ = add_switches(base_db.switches, modified_db->switches, allocator);
+        changelog->variables_ = add_variables(base_db.variables, modified_db->variables, allocator);
+        changelog->animations_ = add_animations(base_db.animations, modified_db->animations, allocator);
+
+        diff_timer.stop();
 
         // assets
-        changelog->menu_themes_ = add_assets(base_path, modified_path, data::AssetCategory::MENU_THEME);
-        changelog->charsets_ = add_assets(base_path, modified_path, data::AssetCategory::CHARSET);
-        changelog->chipsets_ = add_assets(base_path, modified_path, data::AssetCategory::CHIPSET);
-        changelog->musics_ = add_assets(base_path, modified_path, data::AssetCategory::MUSIC);
-        changelog->sounds_ = add_assets(base_path, modified_path, data::AssetCategory::SOUND);
-        changelog->panoramas_ = add_assets(base_path, modified_path, data::AssetCategory::PANORAMA);
-        changelog->pictures_ = add_assets(base_path, modified_path, data::AssetCategory::PICTURE);
-        changelog->animation_files_ = add_assets(base_path, modified_path, data::AssetCategory::BATTLE_ANIMATION);
+        metrics::ScopedTimer assets_timer("scan", "assets");
+
+        changelog->menu_themes_ = add_assets(base_path, modified_path, base_listing, modified_listing, data::AssetCategory::MENU_THEME, changelog->strings_, allocator);
+        changelog->charsets_ = add_assets(base_path, modified_path, base_listing, modified_listing, data::AssetCategory::CHARSET, changelog->strings_, allocator);
+        changelog->chipsets_ = add_assets(base_path, modified_path, base_listing, modified_listing, data::AssetCategory::CHIPSET, changelog->strings_, allocator);
+        changelog->musics_ = add_assets(base_path, modified_path, base_listing, modified_listing, data::AssetCategory::MUSIC, changelog->strings_, allocator);
+        changelog->sounds_ = add_assets(base_path, modified_path, base_listing, modified_listing, data::AssetCategory::SOUND, changelog->strings_, allocator);
+        changelog->panoramas_ = add_assets(base_path, modified_path, base_listing, modified_listing, data::AssetCategory::PANORAMA, changelog->strings_, allocator);
+        changelog->pictures_ = add_assets(base_path, modified_path, base_listing, modified_listing, data::AssetCategory::PICTURE, changelog->strings_, allocator);
+        changelog->animation_files_ = add_assets(base_path, modified_path, base_listing, modified_listing, data::AssetCategory::BATTLE_ANIMATION, changelog->strings_, allocator);
 
 
         return changelog;
@@ -613,21 +759,27 @@ namespace chgen {
      * @param at The path where we want to save the file. If empty, the file will be saved in the current directory.
      */
     void ChangelogGenerator::generate(const std::shared_ptr<data::Changelog> &changelog, const std::string& at) {
-        std::string date = data::date_string(changelog->date_);
+        std::string date = data::date_string(&changelog->date_);
         std::string date_formatted = date.substr(0, 2) + date.substr(3, 3) + date.substr(7, date.length());
 
-        std::string filename = at / fs::path(changelog->developer_ + "_" + date_formatted + "_changelog.txt");
+        const std::string developer(changelog->developer_);
+        std::string filename = at / fs::path(developer + "_" + date_formatted + "_changelog.txt");
 
         // this ensures that we don't overwrite any existing file
         for (int i = 2; fs::exists(filename); i++) {
-            filename = at / fs::path(changelog->developer_ + "_" + date_formatted + "_changelog_" +
+            filename = at / fs::path(developer + "_" + date_formatted + "_changelog_" +
                        std::to_string(i) + ".txt");
         }
 
         std::ofstream file;
         file.open(filename);
 
-        file << changelog->stringify() << '\n';
+        {
+            // rendered straight into the file, flushed before checking that it exists
+            data::TextWriter writer(file);
+            changelog->Render(writer);
+            writer << '\n';
+        }
 
         if (!fs::exists(filename)) {
             error("Could not generate file " + filename);
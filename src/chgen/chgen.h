@@ -4,24 +4,107 @@
 #include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <thread>
+#include <vector>
 #include <lcf/lmt/reader.h>
 #include <lcf/lmu/reader.h>
 #include <lcf/ldb/reader.h>
 #include "../data/changelog.h"
+#include "../utils/dirscan.h"
+#include "base_build.h"
 
 namespace fs = std::filesystem;
 
 namespace chgen {
 
+    /**
+     * @brief Counters of how far map files went through the scan before being decided on.
+     */
+    struct ScanStats {
+        /**
+         * @brief Maps skipped because both files have the same last write time
+         */
+        size_t maps_same_mtime_ = 0;
+        /**
+         * @brief Maps skipped because their map tree entry is unchanged
+         */
+        size_t maps_same_info_ = 0;
+        /**
+         * @brief Maps whose files differ in size, so their content was not compared
+         */
+        size_t maps_size_changed_ = 0;
+        /**
+         * @brief Maps whose files are byte-identical; only the modified side is parsed for BGM events
+         */
+        size_t maps_same_content_ = 0;
+        /**
+         * @brief Maps whose base and modified files were both parsed
+         */
+        size_t maps_parsed_ = 0;
+    };
+
+    /**
+     * @brief Lists the assets added, removed or modified in a category.
+     * @param base_path
+     * @param modified_path
+     * @param base_listing The listing of the base build
+     * @param modified_listing The listing of the modified build
+     * @param category
+     * @param strings Pool the asset names are interned in, usually the one of the changelog
+     * @param allocator Allocator of the changelog the assets are added to
+     * @return The changed assets, removed assets first.
+     */
+    std::pmr::vector<data::Asset>
+    add_assets(const std::string &base_path, const std::string &modified_path, const utils::BuildListing &base_listing,
+               const utils::BuildListing &modified_listing, data::AssetCategory category, data::StringPool &strings,
+               const data::Changelog::allocator_type &allocator = {});
+
     class ChangelogGenerator {
     public:
         /**
          * @brief Scans the base and modified paths for changes.
          * @param base_path
          * @param modified_path
+         * @param stats If not null, filled with the map scan counters.
          * @return A changelog object.
          */
-        static std::shared_ptr<data::Changelog> scan(const std::string& base_path, const std::string& modified_path);
+        static std::shared_ptr<data::Changelog> scan(const std::string& base_path, const std::string& modified_path,
+                                                     ScanStats* stats = nullptr);
+
+        /**
+         * @brief Scans a modified path for changes against an already loaded base build.
+         * @details The base build is only read, several scans can share it concurrently.
+         * @param base
+         * @param modified_path
+         * @param stats If not null, filled with the map scan counters.
+         * @return A changelog object.
+         */
+        static std::shared_ptr<data::Changelog> scan(const BaseBuild& base, const std::string& modified_path,
+                                                     ScanStats* stats = nullptr);
+
+        /**
+         * @brief Scans several modified builds against the same base, loaded once and shared by parallel scans.
+         * @param base_path
+         * @param modified_paths
+         * @param threads Number of builds scanned at the same time
+         * @return One changelog per modified path, in the same order; nullptr for the builds that could not be
+         * scanned, and for every build if the base could not be loaded.
+         */
+        static std::vector<std::shared_ptr<data::Changelog>>
+        scanBatch(const std::string& base_path, const std::vector<std::string>& modified_paths,
+                  size_t threads = std::thread::hardware_concurrency());
+
+        /**
+         * @brief Scans several modified builds in parallel against an already loaded base build.
+         * @param base
+         * @param modified_paths
+         * @param threads Number of builds scanned at the same time
+         * @return One changelog per modified path, in the same order; nullptr for the builds that could not be
+         * scanned.
+         */
+        static std::vector<std::shared_ptr<data::Changelog>>
+        scanBatch(const BaseBuild& base, const std::vector<std::string>& modified_paths,
+                  size_t threads = std::thread::hardware_concurrency());
 
         /**
          * @brief Generates a changelog file.
@@ -0,0 +1,261 @@
+#include "lmu_scanner.h"
+
+#include <algorithm>
+#include <fstream>
+#include "../utils/error.h"
+
+namespace chgen {
+
+    /**
+     * Chunk IDs of the .lmu format we need to look into. Everything else is skipped by length.
+     */
+    constexpr uint32_t MAP_EVENTS_CHUNK = 0x51;
+    constexpr uint32_t EVENT_X_CHUNK = 0x02;
+    constexpr uint32_t EVENT_Y_CHUNK = 0x03;
+    constexpr uint32_t EVENT_PAGES_CHUNK = 0x05;
+    constexpr uint32_t PAGE_COMMANDS_CHUNK = 0x34;
+
+    const std::string_view LMU_HEADER = "LcfMapUnit";
+
+    /**
+     * @brief Bounds checked cursor over a chunk of an lcf file
+     */
+    struct ChunkReader {
+        const uint8_t *pos;
+        const uint8_t *end;
+        bool failed = false;
+
+        bool eof() const {
+            return failed || pos >= end;
+        }
+
+        /**
+         * @brief Reads a BER compressed integer
+         */
+        uint32_t readInt() {
+            uint32_t value = 0;
+
+            for (int i = 0; i < 5; i++) {
+                if (pos >= end) {
+                    failed = true;
+                    return 0;
+                }
+
+                const uint8_t byte = *pos++;
+                value = (value << 7) | (byte & 0x7F);
+
+                if (!(byte & 0x80)) {
+                    return value;
+                }
+            }
+
+            failed = true;
+            return 0;
+        }
+
+        /**
+         * @brief Splits the next length bytes into their own reader and moves past them
+         */
+        ChunkReader sub(uint32_t length) {
+            if (static_cast<size_t>(end - pos) < length) {
+                failed = true;
+                return ChunkReader{end, end, true};
+            }
+
+            ChunkReader chunk{pos, pos + length};
+            pos += length;
+            return chunk;
+        }
+
+        std::string_view readBytes(uint32_t length) {
+            const auto chunk = sub(length);
+            return {reinterpret_cast<const char *>(chunk.pos), static_cast<size_t>(chunk.end - chunk.pos)};
+        }
+
+        /**
+         * @brief Reads a chunk header
+         * @return false once the terminating 0 of the structure is reached
+         */
+        bool nextChunk(uint32_t &id, uint32_t &length) {
+            if (eof()) {
+                return false;
+            }
+
+            id = readInt();
+            if (id == 0) {
+                return false;
+            }
+
+            length = readInt();
+            return !failed;
+        }
+    };
+
+    void parse_commands(ChunkReader reader, MapEvents &events, uint32_t event_index, const std::vector<int32_t> &codes,
+                        bool &failed) {
+        while (!reader.eof()) {
+            const auto code = static_cast<int32_t>(reader.readInt());
+            if (code == 0) {
+                // end of the command list, followed by 3 padding zeros
+                break;
+            }
+
+            const auto indent = static_cast<int32_t>(reader.readInt());
+            const auto string = reader.readBytes(reader.readInt());
+            const auto param_count = reader.readInt();
+
+            const bool keep = codes.empty() || std::find(begin(codes), end(codes), code) != end(codes);
+
+            if (keep) {
+                events.code_.push_back(code);
+                events.indent_.push_back(indent);
+                events.event_.push_back(event_index);
+                events.strings_.append(string);
+                events.string_offset_.push_back(static_cast<uint32_t>(events.strings_.size()));
+            }
+
+            for (uint32_t i = 0; i < param_count; i++) {
+                if (reader.eof()) {
+                    reader.failed = true;
+                    break;
+                }
+
+                const auto param = static_cast<int32_t>(reader.readInt());
+                if (keep) {
+                    events.params_.push_back(param);
+                }
+            }
+
+            if (keep) {
+                events.params_offset_.push_back(static_cast<uint32_t>(events.params_.size()));
+            }
+        }
+
+        failed = failed || reader.failed;
+    }
+
+    void parse_pages(ChunkReader reader, MapEvents &events, uint32_t event_index, const std::vector<int32_t> &codes,
+                     bool &failed) {
+        const auto page_count = reader.readInt();
+
+        for (uint32_t i = 0; i < page_count; i++) {
+            if (reader.eof()) {
+                reader.failed = true;
+                break;
+            }
+
+            reader.readInt(); // page ID
+
+            uint32_t id;
+            uint32_t length;
+            while (reader.nextChunk(id, length)) {
+                auto chunk = reader.sub(length);
+
+                if (id == PAGE_COMMANDS_CHUNK) {
+                    parse_commands(chunk, events, event_index, codes, failed);
+                }
+            }
+        }
+
+        failed = failed || reader.failed;
+    }
+
+    void parse_events(ChunkReader reader, MapEvents &events, const std::vector<int32_t> &codes, bool &failed) {
+        const auto event_count = reader.readInt();
+
+        // the count comes from the file, don't trust it more than its size
+        const auto reserved = std::min<size_t>(event_count, reader.end - reader.pos);
+        events.event_x_.reserve(reserved);
+        events.event_y_.reserve(reserved);
+
+        for (uint32_t i = 0; i < event_count; i++) {
+            if (reader.eof()) {
+                reader.failed = true;
+                break;
+            }
+
+            reader.readInt(); // event ID
+
+            const auto event_index = static_cast<uint32_t>(events.event_x_.size());
+            events.event_x_.push_back(0);
+            events.event_y_.push_back(0);
+
+            uint32_t id;
+            uint32_t length;
+            while (reader.nextChunk(id, length)) {
+                auto chunk = reader.sub(length);
+
+                switch (id) {
+                    case EVENT_X_CHUNK:
+                        events.event_x_[event_index] = static_cast<int32_t>(chunk.readInt());
+                        break;
+                    case EVENT_Y_CHUNK:
+                        events.event_y_[event_index] = static_cast<int32_t>(chunk.readInt());
+                        break;
+                    case EVENT_PAGES_CHUNK:
+                        parse_pages(chunk, events, event_index, codes, failed);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        failed = failed || reader.failed;
+    }
+
+    std::unique_ptr<MapEvents> LmuScanner::parse(const char *data, size_t size, const std::vector<int32_t> &codes) {
+        const auto bytes = reinterpret_cast<const uint8_t *>(data);
+        ChunkReader reader{bytes, bytes + size};
+
+        if (reader.readBytes(reader.readInt()) != LMU_HEADER) {
+            error("Invalid map file header");
+            return nullptr;
+        }
+
+        auto events = std::make_unique<MapEvents>();
+        bool failed = false;
+
+        uint32_t id;
+        uint32_t length;
+        while (reader.nextChunk(id, length)) {
+            auto chunk = reader.sub(length);
+
+            if (id == MAP_EVENTS_CHUNK) {
+                parse_events(chunk, *events, codes, failed);
+            }
+        }
+
+        if (failed || reader.failed) {
+            error("Truncated or corrupted map file");
+            return nullptr;
+        }
+
+        return events;
+    }
+
+    std::unique_ptr<MapEvents> LmuScanner::load(const std::string &path, const std::vector<int32_t> &codes) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            error("Could not open " + path);
+            return nullptr;
+        }
+
+        std::string content(static_cast<size_t>(file.tellg()), '\0');
+        file.seekg(0, std::ios::beg);
+        file.read(content.data(), static_cast<std::streamsize>(content.size()));
+
+        if (!file) {
+            error("Could not read " + path);
+            return nullptr;
+        }
+
+        auto events = parse(content.data(), content.size(), codes);
+        if (!events) {
+            error("Could not parse " + path);
+        }
+
+        return events;
+    }
+
+} // chgen
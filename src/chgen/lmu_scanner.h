@@ -0,0 +1,98 @@
+#ifndef CU_SUBMITTER_LMU_SCANNER_H
+#define CU_SUBMITTER_LMU_SCANNER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace chgen {
+
+    /**
+     * @brief Compact, struct-of-arrays view of the event commands of a map file.
+     * @details Only the data needed by the changelog generator is kept: the position of each event and the
+     * commands of all of its pages, flattened in file order. Command i owns the parameters
+     * params_[params_offset_[i], params_offset_[i + 1]) and the string strings_[string_offset_[i], string_offset_[i + 1]).
+     */
+    struct MapEvents {
+        /**
+         * @brief Coordinates of each event, indexed by event position in the file
+         */
+        std::vector<int32_t> event_x_;
+        std::vector<int32_t> event_y_;
+
+        /**
+         * @brief Per command data
+         */
+        std::vector<int32_t> code_;
+        std::vector<int32_t> indent_;
+        std::vector<uint32_t> event_;
+        std::vector<uint32_t> params_offset_{0};
+        std::vector<uint32_t> string_offset_{0};
+
+        /**
+         * @brief Storage shared by all commands
+         */
+        std::vector<int32_t> params_;
+        std::string strings_;
+
+        /**
+         * @return The number of commands
+         */
+        size_t size() const {
+            return code_.size();
+        }
+
+        /**
+         * @return The string argument of the command at index i
+         */
+        std::string_view string(size_t i) const {
+            return std::string_view(strings_).substr(string_offset_[i], string_offset_[i + 1] - string_offset_[i]);
+        }
+
+        /**
+         * @return The n-th parameter of the command at index i, or 0 if the command has fewer parameters
+         */
+        int32_t param(size_t i, size_t n) const {
+            const size_t offset = params_offset_[i] + n;
+            return offset < params_offset_[i + 1] ? params_[offset] : 0;
+        }
+
+        int32_t x(size_t i) const {
+            return event_x_[event_[i]];
+        }
+
+        int32_t y(size_t i) const {
+            return event_y_[event_[i]];
+        }
+    };
+
+    /**
+     * @brief Lightweight reader for .lmu files.
+     * @details Walks the chunk stream of the map, skips everything that is not an event (tile layers included)
+     * by its chunk length and decodes event pages and commands only.
+     */
+    class LmuScanner {
+    public:
+        /**
+         * @brief Reads a map file and extracts its event commands
+         * @param path Path of the .lmu file
+         * @param codes Event command codes to keep. If empty, all commands are kept.
+         * @return The extracted events, or nullptr if the file could not be read
+         */
+        static std::unique_ptr<MapEvents> load(const std::string &path, const std::vector<int32_t> &codes = {});
+
+        /**
+         * @brief Extracts the event commands of a map file already in memory
+         * @param data Content of the .lmu file
+         * @param size Size of the content in bytes
+         * @param codes Event command codes to keep. If empty, all commands are kept.
+         * @return The extracted events, or nullptr if the content is not a valid map
+         */
+        static std::unique_ptr<MapEvents> parse(const char *data, size_t size, const std::vector<int32_t> &codes = {});
+    };
+
+} // chgen
+
+#endif //CU_SUBMITTER_LMU_SCANNER_H
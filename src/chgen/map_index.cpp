@@ -0,0 +1,112 @@
+#include "map_index.h"
+
+#include "../data/changelog.h"
+
+namespace chgen {
+
+    MapIndex::MapIndex(const utils::DirectoryListing *root, const lcf::rpg::TreeMap *tree)
+            : tree_(tree) {
+        if (root) {
+            for (const auto &file: root->entries_) {
+                const int map_id = parseMapId(file.name_);
+                if (map_id < 0 || file.is_directory_) {
+                    continue;
+                }
+
+                entry(map_id).file_ = file;
+            }
+        }
+
+        if (tree) {
+            for (size_t i = 0; i < tree->maps.size(); i++) {
+                const int map_id = tree->maps[i].ID;
+                if (map_id < 0 || map_id > max_map_id) {
+                    continue;
+                }
+
+                entry(map_id).info_position_ = static_cast<int>(i);
+            }
+        }
+    }
+
+    MapIndexEntry &MapIndex::entry(int map_id) {
+        if (static_cast<size_t>(map_id) >= entries_.size()) {
+            entries_.resize(static_cast<size_t>(map_id) + 1);
+        }
+
+        return entries_[map_id];
+    }
+
+    const MapIndexEntry *MapIndex::find(int map_id) const {
+        if (map_id < 0 || static_cast<size_t>(map_id) >= entries_.size()) {
+            return nullptr;
+        }
+
+        return &entries_[map_id];
+    }
+
+    const lcf::rpg::MapInfo *MapIndex::info(int map_id) const {
+        const auto *map_entry = find(map_id);
+        if (!map_entry || map_entry->info_position_ < 0 || !tree_) {
+            return nullptr;
+        }
+
+        return &tree_->maps[map_entry->info_position_];
+    }
+
+    bool MapIndex::hasFile(int map_id) const {
+        const auto *map_entry = find(map_id);
+        return map_entry && map_entry->file_;
+    }
+
+    std::vector<int> MapIndex::fileIds() const {
+        std::vector<int> ids;
+
+        for (size_t i = 0; i < entries_.size(); i++) {
+            if (entries_[i].file_) {
+                ids.push_back(static_cast<int>(i));
+            }
+        }
+
+        return ids;
+    }
+
+    void MapIndex::setInfoPosition(int map_id, int position) {
+        if (map_id < 0 || map_id > max_map_id) {
+            return;
+        }
+
+        entry(map_id).info_position_ = position;
+    }
+
+    int MapIndex::parseMapId(std::string_view filename) {
+        // Map + at least one digit + .lmu
+        if (filename.size() < 8 || filename.substr(0, 3) != "Map" || filename.substr(filename.size() - 4) != ".lmu") {
+            return -1;
+        }
+
+        const auto digits = filename.substr(3, filename.size() - 7);
+        if (digits.size() > 9) {
+            return -1;
+        }
+
+        int map_id = 0;
+        for (const char c: digits) {
+            if (c < '0' || c > '9') {
+                return -1;
+            }
+            map_id = map_id * 10 + (c - '0');
+        }
+
+        if (map_id > max_map_id) {
+            return -1;
+        }
+
+        return map_id;
+    }
+
+    std::string MapIndex::filename(int map_id) {
+        return "Map" + data::id_string(map_id) + ".lmu";
+    }
+
+} // chgen
@@ -0,0 +1,96 @@
+#ifndef CU_SUBMITTER_MAP_INDEX_H
+#define CU_SUBMITTER_MAP_INDEX_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <lcf/rpg/treemap.h>
+
+#include "../utils/dirscan.h"
+
+namespace chgen {
+
+    /**
+     * @brief What a build knows about one map ID.
+     */
+    struct MapIndexEntry {
+        /**
+         * @brief The MapXXXX.lmu file of the map, if the build has one
+         */
+        std::optional<utils::FileEntry> file_;
+        /**
+         * @brief Position of the map in TreeMap::maps, -1 if the map tree has no entry with this ID
+         */
+        int info_position_ = -1;
+    };
+
+    /**
+     * @brief Dense map ID -> map file and map tree entry table of a build.
+     * @details Built once per build, so that map lookups neither search the file list nor assume that the
+     * map tree stores map N at index N.
+     */
+    class MapIndex {
+    public:
+        /**
+         * @brief Highest map ID RPG Maker 2000/2003 supports. Map files and map tree entries above it are ignored.
+         */
+        static constexpr int max_map_id = 9999;
+
+        MapIndex() = default;
+
+        /**
+         * @param root The listing of the root of the build. May be null to only index the map tree.
+         * @param tree The map tree of the build. May be null to only index the map files.
+         * It must outlive the index; entries may be appended to it, but not removed or reordered.
+         */
+        MapIndex(const utils::DirectoryListing *root, const lcf::rpg::TreeMap *tree);
+
+        /**
+         * @return The entry of a map ID, or nullptr if the build knows nothing about it
+         */
+        const MapIndexEntry *find(int map_id) const;
+
+        /**
+         * @return The map tree entry of a map ID, or nullptr if there is none
+         */
+        const lcf::rpg::MapInfo *info(int map_id) const;
+
+        /**
+         * @return True if the build has a map file for this ID
+         */
+        bool hasFile(int map_id) const;
+
+        /**
+         * @return The IDs of every map file of the build, in ascending order
+         */
+        std::vector<int> fileIds() const;
+
+        /**
+         * @brief Records that a map tree entry was appended to the tree at the given position
+         * @details Ignored if map_id is above max_map_id
+         */
+        void setInfoPosition(int map_id, int position);
+
+        /**
+         * @brief Extracts the map ID of a map file name
+         * @param filename A file name like Map0042.lmu
+         * @return The map ID, or -1 if the name is not a map file name or the ID is above max_map_id
+         */
+        static int parseMapId(std::string_view filename);
+
+        /**
+         * @return The file name of a map, like Map0042.lmu
+         */
+        static std::string filename(int map_id);
+
+    private:
+        MapIndexEntry &entry(int map_id);
+
+        std::vector<MapIndexEntry> entries_;
+        const lcf::rpg::TreeMap *tree_ = nullptr;
+    };
+
+} // chgen
+
+#endif //CU_SUBMITTER_MAP_INDEX_H
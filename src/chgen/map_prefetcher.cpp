@@ -0,0 +1,154 @@
+#include "map_prefetcher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../utils/metrics.h"
+
+namespace chgen {
+
+    MapPrefetcher::MapPrefetcher(std::vector<MapFileRequest> requests, size_t in_flight)
+            : requests_(std::move(requests)),
+              in_flight_(std::max<size_t>(in_flight, 1)),
+              session_(trace::Session::current()) {
+        for (size_t i = 0; i < in_flight_; i++) {
+            free_.push_back(std::make_unique<PrefetchedMap>());
+        }
+
+        io_thread_ = std::thread(&MapPrefetcher::run, this);
+    }
+
+    MapPrefetcher::~MapPrefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        free_cv_.notify_all();
+
+        if (io_thread_.joinable()) {
+            io_thread_.join();
+        }
+    }
+
+    std::unique_ptr<PrefetchedMap> MapPrefetcher::next() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_cv_.wait(lock, [this] { return !ready_.empty() || done_; });
+
+        if (ready_.empty()) {
+            return nullptr;
+        }
+
+        auto buffer = std::move(ready_.front());
+        ready_.pop_front();
+        return buffer;
+    }
+
+    void MapPrefetcher::release(std::unique_ptr<PrefetchedMap> buffer) {
+        if (!buffer) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(std::move(buffer));
+        }
+        free_cv_.notify_one();
+    }
+
+    void MapPrefetcher::run() {
+        trace::Activate activate(session_);
+
+        // the first files are read right away, no need to hint them
+        for (size_t i = 0; i < requests_.size(); i++) {
+            const size_t upcoming = i + in_flight_;
+            if (upcoming < requests_.size()) {
+                advise(requests_[upcoming].base_path_);
+                advise(requests_[upcoming].modified_path_);
+            }
+
+            std::unique_ptr<PrefetchedMap> buffer;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                free_cv_.wait(lock, [this] { return !free_.empty() || stop_; });
+
+                if (stop_) {
+                    break;
+                }
+
+                buffer = std::move(free_.back());
+                free_.pop_back();
+            }
+
+            buffer->index_ = i;
+
+            const auto &modified_path = requests_[i].modified_path_;
+            trace::Span span("io", "read " + modified_path.substr(modified_path.rfind('/') + 1));
+            buffer->base_ok_ = readFile(requests_[i].base_path_, buffer->base_content_);
+            buffer->modified_ok_ = readFile(requests_[i].modified_path_, buffer->modified_content_);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ready_.push_back(std::move(buffer));
+            }
+            ready_cv_.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        ready_cv_.notify_all();
+    }
+
+    void MapPrefetcher::advise(const std::string &path) {
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+
+    bool MapPrefetcher::readFile(const std::string &path, std::string &content) {
+        content.clear();
+
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) != 0) {
+            close(fd);
+            return false;
+        }
+
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        content.resize(static_cast<size_t>(file_stat.st_size));
+
+        size_t offset = 0;
+        while (offset < content.size()) {
+            const auto bytes = read(fd, content.data() + offset, content.size() - offset);
+            if (bytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes <= 0) {
+                break;
+            }
+            offset += static_cast<size_t>(bytes);
+        }
+
+        close(fd);
+        metrics::add(metrics::BYTES_READ, offset);
+
+        // the file may have shrunk since fstat
+        content.resize(offset);
+        return offset == static_cast<size_t>(file_stat.st_size);
+    }
+
+} // chgen
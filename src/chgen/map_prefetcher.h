@@ -0,0 +1,107 @@
+#ifndef CU_SUBMITTER_MAP_PREFETCHER_H
+#define CU_SUBMITTER_MAP_PREFETCHER_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../utils/trace.h"
+
+namespace chgen {
+
+    /**
+     * @brief A pair of map files to read ahead of parsing
+     */
+    struct MapFileRequest {
+        std::string base_path_;
+        std::string modified_path_;
+    };
+
+    /**
+     * @brief Content of a map file pair, read by the prefetcher. The buffers are reused between requests.
+     */
+    struct PrefetchedMap {
+        /**
+         * @brief Position of the request in the list given to the prefetcher
+         */
+        size_t index_ = 0;
+
+        std::string base_content_;
+        std::string modified_content_;
+
+        bool base_ok_ = false;
+        bool modified_ok_ = false;
+    };
+
+    /**
+     * @brief I/O stage of the map scan.
+     * @details A background thread reads the requested map files, in order, into a bounded pool of buffers
+     * while the caller parses the previous ones. Upcoming files are announced to the kernel with posix_fadvise
+     * so that their readahead starts before we get to them.
+     */
+    class MapPrefetcher {
+    public:
+        /**
+         * @param requests The map files to read, in the order they will be handed out
+         * @param in_flight Maximum number of buffers read ahead of the caller
+         */
+        explicit MapPrefetcher(std::vector<MapFileRequest> requests, size_t in_flight = 4);
+
+        ~MapPrefetcher();
+
+        MapPrefetcher(const MapPrefetcher &) = delete;
+        MapPrefetcher &operator=(const MapPrefetcher &) = delete;
+
+        /**
+         * @brief Waits for the next map file pair
+         * @return The content of the next request, or nullptr once every request has been handed out
+         */
+        std::unique_ptr<PrefetchedMap> next();
+
+        /**
+         * @brief Gives a buffer back to the I/O stage once it has been parsed
+         */
+        void release(std::unique_ptr<PrefetchedMap> buffer);
+
+    private:
+        void run();
+
+        /**
+         * @brief Hints the kernel that a file is about to be read
+         */
+        static void advise(const std::string &path);
+
+        /**
+         * @brief Reads a whole file into a buffer, reusing its capacity
+         * @return false if the file could not be read
+         */
+        static bool readFile(const std::string &path, std::string &content);
+
+        const std::vector<MapFileRequest> requests_;
+        const size_t in_flight_;
+
+        std::mutex mutex_;
+        std::condition_variable ready_cv_;
+        std::condition_variable free_cv_;
+
+        std::deque<std::unique_ptr<PrefetchedMap>> ready_;
+        std::vector<std::unique_ptr<PrefetchedMap>> free_;
+
+        bool done_ = false;
+        bool stop_ = false;
+
+        /**
+         * @brief Trace session of the thread that created the prefetcher, activated on the I/O thread
+         */
+        trace::Session *session_;
+
+        std::thread io_thread_;
+    };
+
+} // chgen
+
+#endif //CU_SUBMITTER_MAP_PREFETCHER_H
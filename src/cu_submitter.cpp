@@ -1,121 +1,344 @@
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include "api/api.h"
 #include "chgen/chgen.h"
 #include "transfer/transfer.h"
+#include "submit/inbox.h"
 #include "submit/submit.h"
+#include "snapshot/snapshot.h"
+#include "utils/compression.h"
 #include "utils/error.h"
+#include "utils/logger.h"
 #include "utils/print.h"
+#include "utils/trace.h"
 
 /**
- * @program cu_submitter
- * @brief The main entry point for the program.
+ * @brief Runs a CLI command
+ * @return The exit code of the program
  */
-int main(int argc, char* argv[])
+int runCommand(int argc, char* argv[])
 {
-    if (argc >= 2 && std::string(argv[1]) != "-p") {
-        //CLI mode
-        const std::string option = argv[1];
-
-        if (option == "--help" || option == "--usage") {
-            std::string usage_message = "USAGE\n";
-            usage_message += "-----\n";
-            usage_message += "[-p <port>] : opens backend server on specific port; 3000 by default\n";
-            usage_message += "--help | --usage : prints this message\n";
-            usage_message += "--chgen <base_path> <modified_path> : generates a changelog text file\n";
-            usage_message += "--transfer <unmodified_copy_path> <modified_copy_path> <destination_path> : transfers the modified files to the destination path\n";
-            usage_message += "--submit <unmodified_copy_path> <modified_copy_path> [<archive_path>] : copy the modified files to a submission folder\n";
-
-            print(usage_message);
-        } else if (option == "--chgen") {
-            if (argc < 4) {
-                error("Not enough arguments");
-                return 1;
-            }
+    const std::string option = argv[1];
 
-            const auto changelog = chgen::ChangelogGenerator::scan(argv[2], argv[3]);
-            if (changelog == nullptr) {
-                error("Could not generate changelog");
-                return 1;
-            }
+    if (option == "--help" || option == "--usage") {
+        std::string usage_message = "USAGE\n";
+        usage_message += "-----\n";
+        usage_message += "[-p <port>] : opens backend server on specific port; 3000 by default\n";
+        usage_message += "--help | --usage : prints this message\n";
+        usage_message += "--chgen <base_path> <modified_path> : generates a changelog text file\n";
+        usage_message += "--chgen-batch <base_path> <modified_path>... : generates a changelog text file per modified build, parsing the base once\n";
+        usage_message += "--transfer <unmodified_copy_path> <modified_copy_path> <destination_path>... [--overwrite] : transfers the modified files to every destination path; refused if a destination changed the same entries, unless --overwrite\n";
+        usage_message += "--transfer-archive <archive_path> <destination_path>... : transfers a submission archive to every destination path, reading the files from the archive without extracting it\n";
+        usage_message += "--submit <unmodified_copy_path> <modified_copy_path> [<archive_path>] : copy the modified files to a submission folder\n";
+        usage_message += "--index-inbox <inbox_path> : lists what every submission archive of inbox_path changes, and the entries changed by several of them\n";
+        usage_message += "--snapshot <devbuild_path> <snapshot_path> [--hardlink] : makes an unmodified copy of a devbuild to work from, cloning its files where the filesystem allows; --hardlink links the files that cannot be cloned instead of copying them\n";
+        usage_message += "--trace <trace_file> : with --chgen, --chgen-batch, --transfer, --transfer-archive, --submit or --snapshot, writes a Chrome trace of the command to trace_file\n";
+        usage_message += "--compress-min-size <bytes> : with -p, smallest response body sent compressed; 1024 by default\n";
+        usage_message += "--pin-base <base_path> : with -p, parses a base build at startup and keeps it in memory; can be repeated\n";
+        usage_message += "--base-cache-size <megabytes> : with -p, memory the parsed base builds may use; 1024 by default\n";
 
-            chgen::ChangelogGenerator::generate(changelog);
-        } else if (option == "--transfer") {
-            if (argc < 5) {
-                error("Not enough arguments");
-                return 1;
+        print(usage_message);
+    } else if (option == "--chgen") {
+        if (argc < 4) {
+            error("Not enough arguments");
+            return 1;
+        }
+
+        const auto changelog = chgen::ChangelogGenerator::scan(argv[2], argv[3]);
+        if (changelog == nullptr) {
+            error("Could not generate changelog");
+            return 1;
+        }
+
+        chgen::ChangelogGenerator::generate(changelog);
+    } else if (option == "--chgen-batch") {
+        if (argc < 4) {
+            error("Not enough arguments");
+            return 1;
+        }
+
+        const std::vector<std::string> modified_paths(argv + 3, argv + argc);
+        const auto changelogs = chgen::ChangelogGenerator::scanBatch(argv[2], modified_paths);
+
+        int status = 0;
+        for (size_t i = 0; i < changelogs.size(); i++) {
+            if (changelogs[i] == nullptr) {
+                error("Could not generate changelog of " + modified_paths[i]);
+                status = 1;
+                continue;
             }
 
-            const std::string base = argv[2];
-            const std::string from = argv[3];
-            const std::string to = argv[4];
+            log("Changelog of " + modified_paths[i] + ":");
+            chgen::ChangelogGenerator::generate(changelogs[i]);
+        }
 
-            const auto changelog = transfer::DevbuildTransferer::getTransferChangelog(base, from);
+        return status;
+    } else if (option == "--transfer") {
+        if (argc < 5) {
+            error("Not enough arguments");
+            return 1;
+        }
 
-            if (changelog == nullptr) {
-                error("Could not generate changelog");
-                return 1;
+        const std::string base = argv[2];
+        const std::string from = argv[3];
+
+        // every devbuild the modifications are transferred to
+        std::vector<std::string> destinations;
+        bool overwrite = false;
+        for (int i = 4; i < argc; i++) {
+            if (std::string(argv[i]) == "--overwrite") {
+                overwrite = true;
+            } else {
+                destinations.emplace_back(argv[i]);
             }
+        }
 
-            std::cout << "Changelog: \n";
-            std::cout << changelog->stringify() << "\n\n";
+        std::shared_ptr<data::Changelog> changelog;
+        std::vector<std::shared_ptr<transfer::MergeReport>> merge_reports;
 
-            std::cout << "Confirm transfer ? (O/N) ";
-            char confirm;
-            std::cin >> confirm;
-            if (confirm == 'N' || confirm == 'n') {
-                error("Transfer cancelled");
-                return 8;
+        if (overwrite) {
+            changelog = transfer::DevbuildTransferer::getTransferChangelog(base, from);
+        } else {
+            const auto base_build = chgen::BaseBuild::load(base);
+            if (base_build) {
+                merge_reports = transfer::DevbuildTransferer::getMergeReports(*base_build, from, destinations);
+                changelog = transfer::DevbuildTransferer::getTransferChangelog();
             }
+        }
 
-            transfer::DevbuildTransferer::transfer(to);
+        if (changelog == nullptr) {
+            error("Could not generate changelog");
+            return 1;
+        }
 
-            transfer::DevbuildTransferer::exportChangelog();
-        } else if (option == "--submit") {
-            if (argc < 4) {
-                error("Not enough arguments");
-                return 1;
+        logging::flush();
+        std::cout << "Changelog: \n";
+        {
+            data::TextWriter writer(std::cout);
+            changelog->Render(writer);
+            writer << "\n\n";
+
+            for (const auto &merge_report: merge_reports) {
+                merge_report->Render(writer);
+                writer << "\n";
             }
+        }
+
+        const bool conflicts = std::any_of(merge_reports.begin(), merge_reports.end(), [](const auto &merge_report) {
+            return merge_report->hasConflicts();
+        });
+        if (conflicts) {
+            error("The destination also changed the conflicting entries. Merge them by hand, or transfer with --overwrite to override them");
+            return 9;
+        }
 
-            const std::string base = argv[2];
-            const std::string modified = argv[3];
-            const std::string archive = argc >= 5 ? argv[4] : "";
+        std::cout << "Confirm transfer ? (O/N) ";
+        char confirm;
+        std::cin >> confirm;
+        if (confirm == 'N' || confirm == 'n') {
+            error("Transfer cancelled");
+            return 8;
+        }
 
-            const auto changelog = submit::SubmissionBuilder::getSubmissionChangelog(base, modified);
+        if (!transfer::DevbuildTransferer::transfer(destinations)) {
+            return 1;
+        }
+
+        transfer::DevbuildTransferer::exportChangelog();
+    } else if (option == "--transfer-archive") {
+        if (argc < 4) {
+            error("Not enough arguments");
+            return 1;
+        }
 
-            if (changelog == nullptr) {
-                error("Could not generate changelog");
+        const std::vector<std::string> destinations(argv + 3, argv + argc);
+
+        const auto changelog = transfer::DevbuildTransferer::getArchiveChangelog(argv[2]);
+        if (changelog == nullptr) {
+            error("Could not read the changelog of the archive");
+            return 1;
+        }
+
+        logging::flush();
+        std::cout << "Changelog: \n";
+        {
+            data::TextWriter writer(std::cout);
+            changelog->Render(writer);
+            writer << "\n\n";
+        }
+
+        std::cout << "Confirm transfer ? (O/N) ";
+        char confirm;
+        std::cin >> confirm;
+        if (confirm == 'N' || confirm == 'n') {
+            error("Transfer cancelled");
+            return 8;
+        }
+
+        try {
+            if (!transfer::DevbuildTransferer::transfer(destinations)) {
                 return 1;
             }
+        } catch (const std::exception &e) {
+            // e.g. a corrupted entry
+            error(std::string(e.what()));
+            return 1;
+        }
+
+        transfer::DevbuildTransferer::exportChangelog();
+    } else if (option == "--submit") {
+        if (argc < 4) {
+            error("Not enough arguments");
+            return 1;
+        }
 
-            std::cout << "Changelog: \n";
-            std::cout << changelog->stringify() << "\n\n";
+        const std::string base = argv[2];
+        const std::string modified = argv[3];
+        const std::string archive = argc >= 5 ? argv[4] : "";
 
-            std::cout << "Confirm ? (O/N) ";
-            char confirm;
-            std::cin >> confirm;
-            if (confirm == 'N' || confirm == 'n') {
-                error("Submission cancelled");
-                return 8;
+        const auto changelog = submit::SubmissionBuilder::getSubmissionChangelog(base, modified);
+
+        if (changelog == nullptr) {
+            error("Could not generate changelog");
+            return 1;
+        }
+
+        logging::flush();
+        std::cout << "Changelog: \n";
+        {
+            data::TextWriter writer(std::cout);
+            changelog->Render(writer);
+            writer << "\n\n";
+        }
+
+        std::cout << "Confirm ? (O/N) ";
+        char confirm;
+        std::cin >> confirm;
+        if (confirm == 'N' || confirm == 'n') {
+            error("Submission cancelled");
+            return 8;
+        }
+
+        try {
+            if (archive.length() > 0) {
+                submit::SubmissionBuilder::submit(archive);
+            } else {
+                submit::SubmissionBuilder::submit();
             }
 
+            //submit::SubmissionBuilder::compress();
+        } catch (const std::exception &e) {
+            error(std::string(e.what()));
+        }
+    } else if (option == "--index-inbox") {
+        if (argc < 3) {
+            error("Not enough arguments");
+            return 1;
+        }
+
+        const auto index = submit::InboxIndexer::index(argv[2]);
+        if (index == nullptr) {
+            error("Could not index the inbox");
+            return 1;
+        }
+
+        logging::flush();
+        data::TextWriter writer(std::cout);
+        index->Render(writer);
+    } else if (option == "--snapshot") {
+        if (argc < 4) {
+            error("Not enough arguments");
+            return 1;
+        }
+
+        const bool hardlink = argc >= 5 && std::string(argv[4]) == "--hardlink";
+
+        const auto result = snapshot::SnapshotBuilder::snapshot(argv[2], argv[3], hardlink);
+        if (!result) {
+            error("Could not create snapshot");
+            return 1;
+        }
+    } else {
+        error("Invalid arguments");
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @program cu_submitter
+ * @brief The main entry point for the program.
+ */
+int main(int argc, char* argv[])
+{
+    // options shared by every mode are taken out before the mode is read
+    std::vector<char*> arguments;
+    std::string trace_path;
+    size_t compression_min_size = compression::default_min_size;
+    size_t base_cache_size = chgen::BaseBuildCache::default_memory_budget;
+    std::vector<std::string> pinned_bases;
+
+    for (int i = 0; i < argc; i++) {
+        const std::string argument = argv[i];
+
+        if (argument == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (argument == "--log-level" && i + 1 < argc) {
+            logging::Level level;
+            if (!logging::parseLevel(argv[++i], level)) {
+                error("Invalid log level: " + std::string(argv[i]));
+                return 1;
+            }
+            logging::setLevel(level);
+        } else if (argument == "--compress-min-size" && i + 1 < argc) {
+            try {
+                compression_min_size = std::stoul(argv[++i]);
+            } catch (const std::exception &) {
+                error("Invalid compression size: " + std::string(argv[i]));
+                return 1;
+            }
+        } else if (argument == "--pin-base" && i + 1 < argc) {
+            pinned_bases.emplace_back(argv[++i]);
+        } else if (argument == "--base-cache-size" && i + 1 < argc) {
             try {
-                if (archive.length() > 0) {
-                    submit::SubmissionBuilder::submit(archive);
-                } else {
-                    submit::SubmissionBuilder::submit();
-                }
-
-                //submit::SubmissionBuilder::compress();
-            } catch (const std::exception &e) {
-                error(std::string(e.what()));
+                base_cache_size = std::stoul(argv[++i]) * 1024 * 1024;
+            } catch (const std::exception &) {
+                error("Invalid base cache size: " + std::string(argv[i]));
+                return 1;
+            }
+        } else if (argument == "--log-file" && i + 1 < argc) {
+            if (!logging::setFile(argv[++i])) {
+                error("Could not open log file " + std::string(argv[i]));
+                return 1;
             }
         } else {
-            error("Invalid arguments");
-            return 1;
+            arguments.push_back(argv[i]);
+        }
+    }
+
+    argc = static_cast<int>(arguments.size());
+    argv = arguments.data();
+
+    if (argc >= 2 && std::string(argv[1]) != "-p") {
+        //CLI mode
+        trace::Session session;
+        trace::Activate activate(trace_path.empty() ? nullptr : &session);
+
+        const int status = runCommand(argc, argv);
+
+        if (!trace_path.empty()) {
+            if (session.write(trace_path)) {
+                print("Trace written to " + trace_path);
+            } else {
+                error("Could not write " + trace_path);
+            }
         }
 
-        return 0;
+        logging::flush();
+        return status;
     }
 
     std::string port = "3000";
@@ -129,6 +352,6 @@ int main(int argc, char* argv[])
 
     Pistache::Address addr(Pistache::Ipv4::any(), Pistache::Port(stoi(port)));
 
-    CUSubmitterService::Service service(addr);
+    CUSubmitterService::Service service(addr, compression_min_size, base_cache_size, pinned_bases);
     service.run();
 }
@@ -2,8 +2,14 @@
 
 namespace data {
 
-    std::string Coordinates::stringify() {
-        return "(" + std::to_string(x) + "," + std::to_string(y) + ")";
+    std::string Coordinates::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void Coordinates::Render(TextWriter &writer) const {
+        writer << '(' << x << ',' << y << ')';
     }
 
     void Coordinates::Serialize(Writer& writer) const {
@@ -31,17 +37,19 @@ namespace data {
         return "";
     }
 
-    std::string BGMEvent::stringify() {
+    std::string BGMEvent::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
 
-        std::string s = "| BGM in event at " + coordinates_.stringify();
+    void BGMEvent::Render(TextWriter &writer) const {
+        writer << "| BGM in event at ";
+        coordinates_.Render(writer);
 
         if (!track_name_.empty() && volume_ != 0 && speed_ != 0) {
-            s += " (track: " + track_name_ + ", volume: " + std::to_string(volume_) + "%, speed: " +
-                 std::to_string(speed_) +
-                 "%)";
+            writer << " (track: " << track_name_ << ", volume: " << volume_ << "%, speed: " << speed_ << "%)";
         }
-
-        return s;
     }
 
     void BGMEvent::Serialize(Writer& writer) const {
@@ -62,8 +70,15 @@ namespace data {
         writer.EndObject();
     }
 
-    std::string OpenConnection::stringify() {
-        return status_string(status_) + " Open connection at " + coordinates_.stringify();
+    std::string OpenConnection::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void OpenConnection::Render(TextWriter &writer) const {
+        writer << status_string(status_) << " Open connection at ";
+        coordinates_.Render(writer);
     }
 
     void OpenConnection::Serialize(Writer& writer) const {
@@ -78,8 +93,15 @@ namespace data {
         writer.EndObject();
     }
 
-    std::string ClosedConnection::stringify() {
-        return status_string(status_) + " Closed connection at " + coordinates_.stringify();
+    std::string ClosedConnection::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void ClosedConnection::Render(TextWriter &writer) const {
+        writer << status_string(status_) << " Closed connection at ";
+        coordinates_.Render(writer);
     }
 
     void ClosedConnection::Serialize(Writer& writer) const {
@@ -113,34 +135,59 @@ namespace data {
         return s;
     }
 
-    std::string Map::stringify() {
-        std::string s = status_string(status_) + " MAP[" + id_string(id_) + "] - " + name_;
-
-        if (!notes_.empty()) {
-            for (auto &note: notes_) {
-                s += "\n\t| " + note;
-            }
+    /**
+     * @brief Writes the notes of an entry, one per line
+     */
+    void render_notes(TextWriter &writer, const Notes &notes) {
+        for (const auto &note: notes) {
+            writer << "\n\t| " << note;
         }
+    }
 
-        if (!bgm_events_.empty()) {
-            for (auto &bgm_event: bgm_events_) {
-                s += "\n\t" + bgm_event.stringify();
-            }
-        }
+    Map::Map(const allocator_type &allocator)
+            : notes_(allocator), bgm_events_(allocator), open_connections_(allocator), closed_connections_(allocator) {
+    }
 
-        if (!open_connections_.empty()) {
-            for (auto &open_connection: open_connections_) {
-                s += "\n\t" + open_connection.stringify();
-            }
+    Map::Map(const Map &other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(other.name_),
+              notes_(other.notes_, allocator), bgm_events_(other.bgm_events_, allocator),
+              open_connections_(other.open_connections_, allocator),
+              closed_connections_(other.closed_connections_, allocator), main_music_(other.main_music_) {
+    }
+
+    Map::Map(Map &&other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(other.name_),
+              notes_(std::move(other.notes_), allocator), bgm_events_(std::move(other.bgm_events_), allocator),
+              open_connections_(std::move(other.open_connections_), allocator),
+              closed_connections_(std::move(other.closed_connections_), allocator), main_music_(other.main_music_) {
+    }
+
+    std::string Map::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void Map::Render(TextWriter &writer) const {
+        writer << status_string(status_) << " MAP[";
+        writer.id(id_) << "] - " << name_;
+
+        render_notes(writer, notes_);
+
+        for (const auto &bgm_event: bgm_events_) {
+            writer << "\n\t";
+            bgm_event.Render(writer);
         }
 
-        if (!closed_connections_.empty()) {
-            for (auto &closed_connection: closed_connections_) {
-                s += "\n\t" + closed_connection.stringify();
-            }
+        for (const auto &open_connection: open_connections_) {
+            writer << "\n\t";
+            open_connection.Render(writer);
         }
 
-        return s;
+        for (const auto &closed_connection: closed_connections_) {
+            writer << "\n\t";
+            closed_connection.Render(writer);
+        }
     }
 
     void serializeMusic(Writer& writer, const lcf::rpg::Music& music) {
@@ -231,36 +278,71 @@ namespace data {
         return "";
     }
 
-    std::string Connection::stringify() {
-        std::string s =
-                status_string(status_) + " Connection from MAP[" + id_string(from_map_.id_) + "]." +
-                from_coordinates_.stringify() + " to MAP[" + id_string(to_map_.id_) + "]." +
-                to_coordinates_.stringify() +
-                "(" + connection_type_string(type_) + ")";
+    Connection::Connection(const allocator_type &allocator)
+            : notes_(allocator) {
+    }
 
-        if (!notes_.empty()) {
-            for (auto &note: notes_) {
-                s += "\n\t| " + note;
-            }
+    Connection::Connection(const Connection &other, const allocator_type &allocator)
+            : status_(other.status_), from_map_id_(other.from_map_id_),
+              from_coordinates_(other.from_coordinates_), to_map_id_(other.to_map_id_),
+              to_coordinates_(other.to_coordinates_), type_(other.type_), notes_(other.notes_, allocator) {
+    }
+
+    Connection::Connection(Connection &&other, const allocator_type &allocator)
+            : status_(other.status_), from_map_id_(other.from_map_id_),
+              from_coordinates_(other.from_coordinates_), to_map_id_(other.to_map_id_),
+              to_coordinates_(other.to_coordinates_), type_(other.type_),
+              notes_(std::move(other.notes_), allocator) {
+    }
+
+    std::string Connection::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void Connection::Render(TextWriter &writer) const {
+        writer << status_string(status_) << " Connection from MAP[";
+        writer.id(from_map_id_) << "].";
+        from_coordinates_.Render(writer);
+        writer << " to MAP[";
+        writer.id(to_map_id_) << "].";
+        to_coordinates_.Render(writer);
+        writer << '(' << connection_type_string(type_) << ')';
+
+        render_notes(writer, notes_);
+    }
+
+    /**
+     * @brief Serializes the map of a connection, as a map entry with only its ID and name
+     */
+    void serializeConnectionMap(Writer& writer, unsigned int id, const MapNames& map_names) {
+        Map map{};
+        map.status_ = ADDED;
+        map.id_ = id;
+
+        const auto name = map_names.find(id);
+        if (name != map_names.end()) {
+            map.name_ = name->second;
         }
 
-        return s;
+        map.Serialize(writer);
     }
 
-    void Connection::Serialize(Writer& writer) const {
+    void Connection::Serialize(Writer& writer, const MapNames& map_names) const {
         writer.StartObject();
 
         writer.String("status");
         serializeString(writer, status_string(status_));
 
         writer.String("from_map");
-        from_map_.Serialize(writer);
+        serializeConnectionMap(writer, from_map_id_, map_names);
 
         writer.String("from_coordinates");
         from_coordinates_.Serialize(writer);
 
         writer.String("to_map");
-        to_map_.Serialize(writer);
+        serializeConnectionMap(writer, to_map_id_, map_names);
 
         writer.String("to_coordinates");
         to_coordinates_.Serialize(writer);
@@ -280,16 +362,31 @@ namespace data {
         writer.EndObject();
     }
 
-    std::string CommonEvent::stringify() {
-        std::string s = status_string(status_) + " CE[" + id_string(id_) + "] - " + name_;
+    CommonEvent::CommonEvent(const allocator_type &allocator)
+            : name_(allocator), notes_(allocator) {
+    }
 
-        if (!notes_.empty()) {
-            for (auto &note: notes_) {
-                s += "\n\t| " + note;
-            }
-        }
+    CommonEvent::CommonEvent(const CommonEvent &other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(other.name_, allocator),
+              notes_(other.notes_, allocator) {
+    }
 
-        return s;
+    CommonEvent::CommonEvent(CommonEvent &&other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(std::move(other.name_), allocator),
+              notes_(std::move(other.notes_), allocator) {
+    }
+
+    std::string CommonEvent::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void CommonEvent::Render(TextWriter &writer) const {
+        writer << status_string(status_) << " CE[";
+        writer.id(id_) << "] - " << name_;
+
+        render_notes(writer, notes_);
     }
 
     void CommonEvent::Serialize(Writer& writer) const {
@@ -316,20 +413,35 @@ namespace data {
         writer.EndObject();
     }
 
-    std::string TilesetInfo::stringify() {
-        std::string s = status_string(status_) + " Tileset[" + id_string(id_) + "] - " + name_;
+    TilesetInfo::TilesetInfo(const allocator_type &allocator)
+            : name_(allocator), notes_(allocator) {
+    }
 
-        if (!chipset_name_.empty() && status_ == ADDED) {
-            s += " (" + chipset_name_ + ")";
-        }
+    TilesetInfo::TilesetInfo(const TilesetInfo &other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(other.name_, allocator),
+              chipset_name_(other.chipset_name_), notes_(other.notes_, allocator) {
+    }
 
-        if (!notes_.empty()) {
-            for (auto &note: notes_) {
-                s += "\n\t| " + note;
-            }
+    TilesetInfo::TilesetInfo(TilesetInfo &&other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(std::move(other.name_), allocator),
+              chipset_name_(other.chipset_name_), notes_(std::move(other.notes_), allocator) {
+    }
+
+    std::string TilesetInfo::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void TilesetInfo::Render(TextWriter &writer) const {
+        writer << status_string(status_) << " Tileset[";
+        writer.id(id_) << "] - " << name_;
+
+        if (!chipset_name_.empty() && status_ == ADDED) {
+            writer << " (" << chipset_name_ << ')';
         }
 
-        return s;
+        render_notes(writer, notes_);
     }
 
     void TilesetInfo::Serialize(Writer& writer) const {
@@ -359,16 +471,31 @@ namespace data {
         writer.EndObject();
     }
 
-    std::string Switch::stringify() {
-        std::string s = status_string(status_) + " Switch[" + id_string(id_) + "] - " + name_;
+    Switch::Switch(const allocator_type &allocator)
+            : name_(allocator), notes_(allocator) {
+    }
 
-        if (!notes_.empty()) {
-            for (auto &note: notes_) {
-                s += "\n\t| " + note;
-            }
-        }
+    Switch::Switch(const Switch &other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(other.name_, allocator),
+              notes_(other.notes_, allocator) {
+    }
 
-        return s;
+    Switch::Switch(Switch &&other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(std::move(other.name_), allocator),
+              notes_(std::move(other.notes_), allocator) {
+    }
+
+    std::string Switch::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void Switch::Render(TextWriter &writer) const {
+        writer << status_string(status_) << " Switch[";
+        writer.id(id_) << "] - " << name_;
+
+        render_notes(writer, notes_);
     }
 
     void Switch::Serialize(Writer& writer) const {
@@ -395,16 +522,31 @@ namespace data {
         writer.EndObject();
     }
 
-    std::string Variable::stringify() {
-        std::string s = status_string(status_) + " Variable[" + id_string(id_) + "] - " + name_;
+    Variable::Variable(const allocator_type &allocator)
+            : name_(allocator), notes_(allocator) {
+    }
 
-        if (!notes_.empty()) {
-            for (auto &note: notes_) {
-                s += "\n\t| " + note;
-            }
-        }
+    Variable::Variable(const Variable &other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(other.name_, allocator),
+              notes_(other.notes_, allocator) {
+    }
 
-        return s;
+    Variable::Variable(Variable &&other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(std::move(other.name_), allocator),
+              notes_(std::move(other.notes_), allocator) {
+    }
+
+    std::string Variable::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void Variable::Render(TextWriter &writer) const {
+        writer << status_string(status_) << " Variable[";
+        writer.id(id_) << "] - " << name_;
+
+        render_notes(writer, notes_);
     }
 
     void Variable::Serialize(Writer& writer) const {
@@ -431,20 +573,35 @@ namespace data {
         writer.EndObject();
     }
 
-    std::string Animation::stringify() {
-        std::string s = status_string(status_) + " Animation[" + id_string(id_) + "] - " + name_;
+    Animation::Animation(const allocator_type &allocator)
+            : name_(allocator), notes_(allocator) {
+    }
 
-        if (!animation_name_.empty() && status_ == ADDED) {
-            s += " (file: " + animation_name_ + ")";
-        }
+    Animation::Animation(const Animation &other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(other.name_, allocator),
+              animation_name_(other.animation_name_), notes_(other.notes_, allocator) {
+    }
 
-        if (!notes_.empty()) {
-            for (auto &note: notes_) {
-                s += "\n\t| " + note;
-            }
+    Animation::Animation(Animation &&other, const allocator_type &allocator)
+            : status_(other.status_), id_(other.id_), name_(std::move(other.name_), allocator),
+              animation_name_(other.animation_name_), notes_(std::move(other.notes_), allocator) {
+    }
+
+    std::string Animation::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void Animation::Render(TextWriter &writer) const {
+        writer << status_string(status_) << " Animation[";
+        writer.id(id_) << "] - " << name_;
+
+        if (!animation_name_.empty() && status_ == ADDED) {
+            writer << " (file: " << animation_name_ << ')';
         }
 
-        return s;
+        render_notes(writer, notes_);
     }
 
     void Animation::Serialize(Writer& writer) const {
@@ -474,49 +631,64 @@ namespace data {
         writer.EndObject();
     }
 
-    std::string Asset::stringify() {
-        std::string s = status_string(status_);
+    Asset::Asset(const allocator_type &allocator)
+            : notes_(allocator), contributors_(allocator) {
+    }
+
+    Asset::Asset(const Asset &other, const allocator_type &allocator)
+            : status_(other.status_), category_(other.category_), name_(other.name_), filename_(other.filename_),
+              notes_(other.notes_, allocator), contributors_(other.contributors_, allocator) {
+    }
+
+    Asset::Asset(Asset &&other, const allocator_type &allocator)
+            : status_(other.status_), category_(other.category_), name_(other.name_), filename_(other.filename_),
+              notes_(std::move(other.notes_), allocator), contributors_(std::move(other.contributors_), allocator) {
+    }
+
+    std::string Asset::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
+
+    void Asset::Render(TextWriter &writer) const {
+        writer << status_string(status_) << ' ' << asset_folder(category_) << ' ' << name_;
+
+        if (!contributors_.empty()) {
+            writer << " (by " << contributors_ << ')';
+        }
 
-        switch (category_) {
+        render_notes(writer, notes_);
+    }
+
+    const std::vector<AssetCategory>& asset_categories() {
+        static const std::vector<AssetCategory> categories = {
+                MENU_THEME, CHARSET, CHIPSET, MUSIC, SOUND, PANORAMA, PICTURE, BATTLE_ANIMATION
+        };
+        return categories;
+    }
+
+    std::string asset_folder(AssetCategory category) {
+        switch (category) {
             case MENU_THEME:
-                s += " System ";
-                break;
+                return "System";
             case CHARSET:
-                s += " CharSet ";
-                break;
+                return "CharSet";
             case CHIPSET:
-                s += " ChipSet ";
-                break;
+                return "ChipSet";
             case MUSIC:
-                s += " Music ";
-                break;
+                return "Music";
             case SOUND:
-                s += " Sound ";
-                break;
+                return "Sound";
             case PANORAMA:
-                s += " Panorama ";
-                break;
+                return "Panorama";
             case PICTURE:
-                s += " Picture ";
-                break;
+                return "Picture";
             case BATTLE_ANIMATION:
-                s += " Battle ";
-                break;
-        }
-
-        s += name_;
-
-        if (!contributors_.empty()) {
-            s += " (by " + contributors_ + ")";
+                return "Battle";
         }
 
-        if (!notes_.empty()) {
-            for (auto &note: notes_) {
-                s += "\n\t| " + note;
-            }
-        }
-
-        return s;
+        return "";
     }
 
     void Asset::Serialize(Writer& writer) const {
@@ -548,7 +720,7 @@ namespace data {
         writer.EndObject();
     }
 
-    std::string date_string(tm* date) {
+    std::string date_string(const tm* date) {
         std::string s;
 
         int day = date->tm_mday;
@@ -601,7 +773,7 @@ namespace data {
         return s;
     }
 
-    void serializeDate(Writer& writer, tm* date) {
+    void serializeDate(Writer& writer, const tm* date) {
         writer.StartObject();
 
         writer.String("day");
@@ -616,163 +788,155 @@ namespace data {
         writer.EndObject();
     }
 
-    std::string Changelog::stringify() {
-        const std::string separator = "---------------------------------------------------\n";
-
-        std::string s = "Developer: " + developer_ + "\nDate: " + date_string(date_) + "\n\n";
-
-        if (!summary_.empty()) {
-            s += "// " + summary_ + "\n";
+    /**
+     * @brief Writes a section of the changelog, one entry per line, after a separator if it is not empty
+     */
+    template<typename T>
+    void render_section(TextWriter &writer, const std::pmr::vector<T> &entries, std::string_view separator) {
+        if (!entries.empty()) {
+            writer << separator;
         }
 
-        if (!map_policy_.empty() || !asset_policy_.empty()) {
-            s += separator;
+        for (const auto &entry: entries) {
+            entry.Render(writer);
+            writer << '\n';
         }
+    }
 
-        if (!map_policy_.empty()) {
-            s += "Map policy... " + map_policy_ + "\n";
-        }
+    Changelog::Changelog(const allocator_type &allocator)
+            : developer_(allocator), summary_(allocator), map_policy_(allocator), asset_policy_(allocator),
+              maps_(allocator), connections_(allocator), common_events_(allocator), tilesets_(allocator),
+              switches_(allocator), variables_(allocator), animations_(allocator), menu_themes_(allocator),
+              charsets_(allocator), chipsets_(allocator), musics_(allocator), sounds_(allocator),
+              panoramas_(allocator), pictures_(allocator), animation_files_(allocator), strings_(allocator) {
+    }
 
-        if (!asset_policy_.empty()) {
-            s += "Asset policy... " + asset_policy_ + "\n";
-        }
+    Changelog::Changelog(const Changelog &other, const allocator_type &allocator)
+            : developer_(other.developer_, allocator), date_(other.date_), summary_(other.summary_, allocator),
+              map_policy_(other.map_policy_, allocator), asset_policy_(other.asset_policy_, allocator),
+              maps_(other.maps_, allocator), connections_(other.connections_, allocator),
+              common_events_(other.common_events_, allocator), tilesets_(other.tilesets_, allocator),
+              switches_(other.switches_, allocator), variables_(other.variables_, allocator),
+              animations_(other.animations_, allocator), menu_themes_(other.menu_themes_, allocator),
+              charsets_(other.charsets_, allocator), chipsets_(other.chipsets_, allocator),
+              musics_(other.musics_, allocator), sounds_(other.sounds_, allocator),
+              panoramas_(other.panoramas_, allocator), pictures_(other.pictures_, allocator),
+              animation_files_(other.animation_files_, allocator), strings_(allocator) {
+        internStrings();
+    }
 
-        // Maps
-        if (!maps_.empty()) {
-            s += separator;
-        }
+    Changelog &Changelog::operator=(const Changelog &other) {
+        if (this == &other) {
+            return *this;
+        }
+
+        developer_ = other.developer_;
+        date_ = other.date_;
+        summary_ = other.summary_;
+        map_policy_ = other.map_policy_;
+        asset_policy_ = other.asset_policy_;
+        maps_ = other.maps_;
+        connections_ = other.connections_;
+        common_events_ = other.common_events_;
+        tilesets_ = other.tilesets_;
+        switches_ = other.switches_;
+        variables_ = other.variables_;
+        animations_ = other.animations_;
+        menu_themes_ = other.menu_themes_;
+        charsets_ = other.charsets_;
+        chipsets_ = other.chipsets_;
+        musics_ = other.musics_;
+        sounds_ = other.sounds_;
+        panoramas_ = other.panoramas_;
+        pictures_ = other.pictures_;
+        animation_files_ = other.animation_files_;
+
+        internStrings();
+        return *this;
+    }
 
+    void Changelog::internStrings() {
         for (auto &map: maps_) {
-            s += map.stringify() + "\n";
-        }
-
-        // Connections
-        if (!connections_.empty()) {
-            s += "\n";
-        }
-
-        for (auto &connection: connections_) {
-            s += connection.stringify() + "\n";
-        }
-
-        // Common events
-        if (!common_events_.empty()) {
-            s += separator;
-        }
-
-        for (auto &common_event: common_events_) {
-            s += common_event.stringify() + "\n";
-        }
-
-        // Tilesets
-        if (!tilesets_.empty()) {
-            s += separator;
+            map.name_ = strings_.intern(map.name_);
+            for (auto &bgm_event: map.bgm_events_) {
+                bgm_event.track_name_ = strings_.intern(bgm_event.track_name_);
+            }
         }
 
         for (auto &tileset: tilesets_) {
-            s += tileset.stringify() + "\n";
-        }
-
-        // Switches
-        if (!switches_.empty()) {
-            s += separator;
-        }
-
-        for (auto &sw: switches_) {
-            s += sw.stringify() + "\n";
-        }
-
-        // Variables
-        if (!variables_.empty()) {
-            s += separator;
-        }
-
-        for (auto &var: variables_) {
-            s += var.stringify() + "\n";
-        }
-
-        // Animations
-        if (!animations_.empty()) {
-            s += separator;
+            tileset.chipset_name_ = strings_.intern(tileset.chipset_name_);
         }
 
         for (auto &animation: animations_) {
-            s += animation.stringify() + "\n";
+            animation.animation_name_ = strings_.intern(animation.animation_name_);
         }
 
-        // Menu themes
-        if (!menu_themes_.empty()) {
-            s += separator;
-        }
-
-        for (auto &menu_theme: menu_themes_) {
-            s += menu_theme.stringify() + "\n";
-        }
-
-        // Charsets
-        if (!charsets_.empty()) {
-            s += separator;
-        }
-
-        for (auto &charset: charsets_) {
-            s += charset.stringify() + "\n";
+        for (auto *assets: {&menu_themes_, &charsets_, &chipsets_, &musics_, &sounds_, &panoramas_, &pictures_,
+                            &animation_files_}) {
+            for (auto &asset: *assets) {
+                asset.name_ = strings_.intern(asset.name_);
+                asset.filename_ = strings_.intern(asset.filename_);
+            }
         }
+    }
 
-        // Chipsets
-        if (!chipsets_.empty()) {
-            s += separator;
-        }
+    std::shared_ptr<Changelog> Changelog::withArena() {
+        struct ArenaChangelog {
+            std::pmr::monotonic_buffer_resource arena_;
+            // declared after the arena, so that it is destroyed first
+            Changelog changelog_{&arena_};
+        };
 
-        for (auto &chipset: chipsets_) {
-            s += chipset.stringify() + "\n";
-        }
+        auto owner = std::make_shared<ArenaChangelog>();
+        return {owner, &owner->changelog_};
+    }
 
-        // Musics
-        if (!musics_.empty()) {
-            s += separator;
-        }
+    std::string Changelog::stringify() const {
+        TextWriter writer;
+        Render(writer);
+        return std::move(writer.str());
+    }
 
-        for (auto &music: musics_) {
-            s += music.stringify() + "\n";
-        }
+    void Changelog::Render(TextWriter &writer) const {
+        const std::string_view separator = "---------------------------------------------------\n";
 
-        // Sound effects
-        if (!sounds_.empty()) {
-            s += separator;
-        }
+        writer << "Developer: " << developer_ << "\nDate: " << date_string(&date_) << "\n\n";
 
-        for (auto &sound: sounds_) {
-            s += sound.stringify() + "\n";
+        if (!summary_.empty()) {
+            writer << "// " << summary_ << '\n';
         }
 
-        // Panoramas
-        if (!panoramas_.empty()) {
-            s += separator;
+        if (!map_policy_.empty() || !asset_policy_.empty()) {
+            writer << separator;
         }
 
-        for (auto &panorama: panoramas_) {
-            s += panorama.stringify() + "\n";
+        if (!map_policy_.empty()) {
+            writer << "Map policy... " << map_policy_ << '\n';
         }
 
-        // Pictures
-        if (!pictures_.empty()) {
-            s += separator;
+        if (!asset_policy_.empty()) {
+            writer << "Asset policy... " << asset_policy_ << '\n';
         }
 
-        for (auto &picture: pictures_) {
-            s += picture.stringify() + "\n";
-        }
+        render_section(writer, maps_, separator);
 
-        // Animation files
-        if (!animation_files_.empty()) {
-            s += separator;
-        }
+        // connections follow the maps after a blank line rather than a separator
+        render_section(writer, connections_, "\n");
 
-        for (auto &animation: animation_files_) {
-            s += animation.stringify() + "\n";
-        }
+        render_section(writer, common_events_, separator);
+        render_section(writer, tilesets_, separator);
+        render_section(writer, switches_, separator);
+        render_section(writer, variables_, separator);
+        render_section(writer, animations_, separator);
 
-        return s;
+        render_section(writer, menu_themes_, separator);
+        render_section(writer, charsets_, separator);
+        render_section(writer, chipsets_, separator);
+        render_section(writer, musics_, separator);
+        render_section(writer, sounds_, separator);
+        render_section(writer, panoramas_, separator);
+        render_section(writer, pictures_, separator);
+        render_section(writer, animation_files_, separator);
     }
 
     void Changelog::Serialize(Writer& writer) const {
@@ -782,7 +946,7 @@ namespace data {
         serializeString(writer, developer_);
 
         writer.String("date");
-        serializeDate(writer, date_);
+        serializeDate(writer, &date_);
 
         writer.String("summary");
         serializeString(writer, summary_);
@@ -805,8 +969,15 @@ namespace data {
         writer.String("connections");
         writer.StartArray();
 
+        MapNames map_names;
+        if (!connections_.empty()) {
+            for (const auto &map: maps_) {
+                map_names.emplace(map.id_, map.name_);
+            }
+        }
+
         for (auto &connection: connections_) {
-            connection.Serialize(writer);
+            connection.Serialize(writer, map_names);
         }
 
         writer.EndArray();
@@ -931,8 +1102,13 @@ namespace data {
         writer.EndObject();
     }
 
-    void serializeString(Writer& writer, const std::string& str) {
-        writer.String(str.c_str(), static_cast<rapidjson::SizeType>(str.length()));
+    void serializeString(Writer& writer, std::string_view str) {
+        writer.String(str.data(), static_cast<rapidjson::SizeType>(str.length()));
+    }
+
+    void serializeString(Writer& writer, const InternedString& str) {
+        const auto json = str.json();
+        writer.RawValue(json.data(), json.size(), rapidjson::kStringType);
     }
 
 } // data
\ No newline at end of file
@@ -1,7 +1,12 @@
 #ifndef CU_SUBMITTER_CHANGELOG_H
 #define CU_SUBMITTER_CHANGELOG_H
 
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <ctime>
 #include <lcf/rpg/music.h>
@@ -9,11 +14,20 @@
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 
+#include "string_pool.h"
+#include "text_writer.h"
+
 
 namespace data {
 
     using Writer = rapidjson::Writer<rapidjson::StringBuffer>;
 
+    /**
+     * @brief Notes of a changelog entry. Entries take an allocator so that a whole changelog can live in an arena,
+     * see Changelog::withArena.
+     */
+    using Notes = std::pmr::vector<std::pmr::string>;
+
     /**
      * @brief Data structure used to represent wether an entry was added, removed or modified.
      */
@@ -30,7 +44,9 @@ namespace data {
         int x;
         int y;
 
-        std::string stringify();
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -47,13 +63,15 @@ namespace data {
      * @brief Data structure used to represent a BGM event.
      */
     struct BGMEvent {
-        Coordinates coordinates_;
+        Coordinates coordinates_{};
 
-        std::string track_name_;
-        int volume_;
-        int speed_;
+        InternedString track_name_;
+        int volume_{};
+        int speed_{};
 
-        std::string stringify();
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -74,7 +92,9 @@ namespace data {
         Status status_;
         Coordinates coordinates_;
 
-        std::string stringify();
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -94,7 +114,9 @@ namespace data {
         Status status_;
         Coordinates coordinates_;
 
-        std::string stringify();
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -120,18 +142,34 @@ namespace data {
      * @brief Data structure used to represent a map.
      */
     struct Map {
-        Status status_;
-        unsigned int id_;
-        std::string name_;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
 
-        std::vector<std::string> notes_;
-        std::vector<BGMEvent> bgm_events_;
-        std::vector<OpenConnection> open_connections_;
-        std::vector<ClosedConnection> closed_connections_;
+        Status status_{};
+        unsigned int id_{};
+        InternedString name_;
+
+        Notes notes_;
+        std::pmr::vector<BGMEvent> bgm_events_;
+        std::pmr::vector<OpenConnection> open_connections_;
+        std::pmr::vector<ClosedConnection> closed_connections_;
 
         lcf::rpg::Music main_music_;
 
-        std::string stringify();
+        explicit Map(const allocator_type &allocator = {});
+
+        Map(const Map &other, const allocator_type &allocator = {});
+
+        Map(Map &&other) = default;
+
+        Map(Map &&other, const allocator_type &allocator);
+
+        Map &operator=(const Map &other) = default;
+
+        Map &operator=(Map &&other) = default;
+
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -156,46 +194,117 @@ namespace data {
         UNLOCKED
     };
 
+    /**
+     * @brief Names of maps by ID, used to name the maps of the connections when serializing
+     */
+    using MapNames = std::unordered_map<unsigned int, InternedString>;
+
     /**
      * @brief Data structure used to represent a connection between two maps.
+     * @details Maps are referenced by ID only; their names are looked up when the changelog is serialized.
      */
     struct Connection {
-        Status status_;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
 
-        Map from_map_;
-        Coordinates from_coordinates_;
+        Status status_{};
 
-        Map to_map_;
-        Coordinates to_coordinates_;
+        unsigned int from_map_id_{};
+        Coordinates from_coordinates_{};
 
-        ConnectionType type_;
+        unsigned int to_map_id_{};
+        Coordinates to_coordinates_{};
 
-        std::vector<std::string> notes_;
+        ConnectionType type_{};
 
-        std::string stringify();
+        Notes notes_;
 
-        void Serialize(Writer &writer) const;
+        explicit Connection(const allocator_type &allocator = {});
+
+        Connection(const Connection &other, const allocator_type &allocator = {});
+
+        Connection(Connection &&other) = default;
+
+        Connection(Connection &&other, const allocator_type &allocator);
+
+        Connection &operator=(const Connection &other) = default;
+
+        Connection &operator=(Connection &&other) = default;
+
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
+
+        /**
+         * @param map_names Names of the maps, maps that are not in it are serialized without a name
+         */
+        void Serialize(Writer &writer, const MapNames &map_names = {}) const;
     };
 
     inline bool operator==(const Connection &lhs, const Connection &rhs) {
-        return lhs.from_map_ == rhs.from_map_ && lhs.from_coordinates_ == rhs.from_coordinates_ &&
-               lhs.to_map_ == rhs.to_map_ && lhs.to_coordinates_ == rhs.to_coordinates_ && lhs.type_ == rhs.type_;
+        return lhs.from_map_id_ == rhs.from_map_id_ && lhs.from_coordinates_ == rhs.from_coordinates_ &&
+               lhs.to_map_id_ == rhs.to_map_id_ && lhs.to_coordinates_ == rhs.to_coordinates_ && lhs.type_ == rhs.type_;
     }
 
     inline bool operator!=(const Connection &lhs, const Connection &rhs) {
         return !(lhs == rhs);
     }
 
+    /**
+     * @brief Identifies a warp within its map: two warps with the same key are the same warp.
+     */
+    struct ConnectionKey {
+        Coordinates from_coordinates_;
+        unsigned int to_map_id_;
+        Coordinates to_coordinates_;
+
+        explicit ConnectionKey(const Connection &connection)
+                : from_coordinates_(connection.from_coordinates_), to_map_id_(connection.to_map_id_),
+                  to_coordinates_(connection.to_coordinates_) {
+        }
+    };
+
+    inline bool operator==(const ConnectionKey &lhs, const ConnectionKey &rhs) {
+        return lhs.from_coordinates_ == rhs.from_coordinates_ && lhs.to_map_id_ == rhs.to_map_id_ &&
+               lhs.to_coordinates_ == rhs.to_coordinates_;
+    }
+
+    struct ConnectionKeyHash {
+        size_t operator()(const ConnectionKey &key) const {
+            uint64_t hash = static_cast<uint32_t>(key.from_coordinates_.x);
+            hash = hash * 0x100000001b3 ^ static_cast<uint32_t>(key.from_coordinates_.y);
+            hash = hash * 0x100000001b3 ^ key.to_map_id_;
+            hash = hash * 0x100000001b3 ^ static_cast<uint32_t>(key.to_coordinates_.x);
+            hash = hash * 0x100000001b3 ^ static_cast<uint32_t>(key.to_coordinates_.y);
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+    };
+
     /**
      * @brief Data structure used to represent a common event.
      */
     struct CommonEvent {
-        Status status_;
-        unsigned int id_;
-        std::string name_;
-        std::vector<std::string> notes_;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        Status status_{};
+        unsigned int id_{};
+        std::pmr::string name_;
+        Notes notes_;
 
-        std::string stringify();
+        explicit CommonEvent(const allocator_type &allocator = {});
+
+        CommonEvent(const CommonEvent &other, const allocator_type &allocator = {});
+
+        CommonEvent(CommonEvent &&other) = default;
+
+        CommonEvent(CommonEvent &&other, const allocator_type &allocator);
+
+        CommonEvent &operator=(const CommonEvent &other) = default;
+
+        CommonEvent &operator=(CommonEvent &&other) = default;
+
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -212,13 +321,29 @@ namespace data {
      * @brief Data structure used to represent a tileset entry in the database.
      */
     struct TilesetInfo {
-        Status status_;
-        unsigned int id_;
-        std::string name_;
-        std::string chipset_name_;
-        std::vector<std::string> notes_;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        Status status_{};
+        unsigned int id_{};
+        std::pmr::string name_;
+        InternedString chipset_name_;
+        Notes notes_;
+
+        explicit TilesetInfo(const allocator_type &allocator = {});
+
+        TilesetInfo(const TilesetInfo &other, const allocator_type &allocator = {});
+
+        TilesetInfo(TilesetInfo &&other) = default;
+
+        TilesetInfo(TilesetInfo &&other, const allocator_type &allocator);
+
+        TilesetInfo &operator=(const TilesetInfo &other) = default;
+
+        TilesetInfo &operator=(TilesetInfo &&other) = default;
 
-        std::string stringify();
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -235,12 +360,28 @@ namespace data {
      * @brief Data structure used to represent a switch.
      */
     struct Switch {
-        Status status_;
-        unsigned int id_;
-        std::string name_;
-        std::vector<std::string> notes_;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        Status status_{};
+        unsigned int id_{};
+        std::pmr::string name_;
+        Notes notes_;
+
+        explicit Switch(const allocator_type &allocator = {});
+
+        Switch(const Switch &other, const allocator_type &allocator = {});
+
+        Switch(Switch &&other) = default;
+
+        Switch(Switch &&other, const allocator_type &allocator);
+
+        Switch &operator=(const Switch &other) = default;
 
-        std::string stringify();
+        Switch &operator=(Switch &&other) = default;
+
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -257,12 +398,28 @@ namespace data {
      * @brief Data structure used to represent a variable.
      */
     struct Variable {
-        Status status_;
-        unsigned int id_;
-        std::string name_;
-        std::vector<std::string> notes_;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        Status status_{};
+        unsigned int id_{};
+        std::pmr::string name_;
+        Notes notes_;
+
+        explicit Variable(const allocator_type &allocator = {});
+
+        Variable(const Variable &other, const allocator_type &allocator = {});
+
+        Variable(Variable &&other) = default;
+
+        Variable(Variable &&other, const allocator_type &allocator);
 
-        std::string stringify();
+        Variable &operator=(const Variable &other) = default;
+
+        Variable &operator=(Variable &&other) = default;
+
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -279,13 +436,29 @@ namespace data {
      * @brief Data structure used to represent an animation entry in the database.
      */
     struct Animation {
-        Status status_;
-        unsigned int id_;
-        std::string name_;
-        std::string animation_name_;
-        std::vector<std::string> notes_;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        Status status_{};
+        unsigned int id_{};
+        std::pmr::string name_;
+        InternedString animation_name_;
+        Notes notes_;
+
+        explicit Animation(const allocator_type &allocator = {});
+
+        Animation(const Animation &other, const allocator_type &allocator = {});
+
+        Animation(Animation &&other) = default;
 
-        std::string stringify();
+        Animation(Animation &&other, const allocator_type &allocator);
+
+        Animation &operator=(const Animation &other) = default;
+
+        Animation &operator=(Animation &&other) = default;
+
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -312,20 +485,48 @@ namespace data {
         BATTLE_ANIMATION
     };
 
+    /**
+     * @brief Lists every asset category, in changelog order.
+     */
+    const std::vector<AssetCategory> &asset_categories();
+
+    /**
+     * @brief Name of the game folder containing the assets of a category.
+     * @param category
+     * @return The folder name, relative to the root of the game.
+     */
+    std::string asset_folder(AssetCategory category);
+
     /**
      * @brief Data structure used to represent an asset.
      */
     struct Asset {
-        Status status_;
-        AssetCategory category_;
-        std::string name_;
-        std::string filename_;
-        std::vector<std::string> notes_;
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        Status status_{};
+        AssetCategory category_{};
+        InternedString name_;
+        InternedString filename_;
+        Notes notes_;
 
         // outside contributors only
-        std::string contributors_;
+        std::pmr::string contributors_;
+
+        explicit Asset(const allocator_type &allocator = {});
+
+        Asset(const Asset &other, const allocator_type &allocator = {});
+
+        Asset(Asset &&other) = default;
 
-        std::string stringify();
+        Asset(Asset &&other, const allocator_type &allocator);
+
+        Asset &operator=(const Asset &other) = default;
+
+        Asset &operator=(Asset &&other) = default;
+
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
     };
@@ -343,116 +544,150 @@ namespace data {
      * @param date
      * @return A string representation of the date.
      */
-    std::string date_string(tm *date);
+    std::string date_string(const tm *date);
 
-    void serializeDate(Writer& writer, tm* date);
+    void serializeDate(Writer& writer, const tm* date);
 
     /**
      * @brief Data structure used to generate the changelog.
      */
     struct Changelog {
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
         /**
          * @brief Name of the developer
          */
-        std::string developer_;
+        std::pmr::string developer_;
         /**
          * @brief Date of submit
          */
-        tm *date_{};
+        tm date_{};
 
         /**
          * @brief Summary of the submit
          */
-        std::string summary_;
+        std::pmr::string summary_;
 
         /**
          * @brief Map policy specifications (who is allowed to edit and/or add content to your maps, and in what ways: open connections only, can create a warp but it has to be this specific shape/color, etc.)
          */
-        std::string map_policy_;
+        std::pmr::string map_policy_;
         /**
          * @brief Asset policy specifications (who is allowed to use and/or edit the assets you made)
          */
-        std::string asset_policy_;
+        std::pmr::string asset_policy_;
 
         /**
          * @brief List of maps
          */
-        std::vector<Map> maps_;
+        std::pmr::vector<Map> maps_;
         /**
          * @brief List of connections between worlds (a world can consist of multiple maps. You don't have to write down warps between a map and its subareas)
          */
-        std::vector<Connection> connections_;
+        std::pmr::vector<Connection> connections_;
 
         /**
          * @brief List of common events
          */
-        std::vector<CommonEvent> common_events_;
+        std::pmr::vector<CommonEvent> common_events_;
 
         /**
          * @brief List of tileset entries in the database
          */
-        std::vector<TilesetInfo> tilesets_;
+        std::pmr::vector<TilesetInfo> tilesets_;
 
         /**
          * @brief List of switches
          */
-        std::vector<Switch> switches_;
+        std::pmr::vector<Switch> switches_;
 
         /**
          * @brief List of variables
          */
-        std::vector<Variable> variables_;
+        std::pmr::vector<Variable> variables_;
 
         /**
          * @brief List of animation entries in the database
          */
-        std::vector<Animation> animations_;
+        std::pmr::vector<Animation> animations_;
 
         /**
          * @brief List of menu theme files
          */
-        std::vector<Asset> menu_themes_;
+        std::pmr::vector<Asset> menu_themes_;
 
         /**
          * @brief List of charsets
          */
-        std::vector<Asset> charsets_;
+        std::pmr::vector<Asset> charsets_;
 
         /**
          * @brief List of chipsets
          */
-        std::vector<Asset> chipsets_;
+        std::pmr::vector<Asset> chipsets_;
 
         /**
          * @brief List of music files
          */
-        std::vector<Asset> musics_;
+        std::pmr::vector<Asset> musics_;
 
         /**
          * @brief List of sound effects
          */
-        std::vector<Asset> sounds_;
+        std::pmr::vector<Asset> sounds_;
 
         /**
          * @brief List of panoramas
          */
-        std::vector<Asset> panoramas_;
+        std::pmr::vector<Asset> panoramas_;
 
         /**
          * @brief List of pictures
          */
-        std::vector<Asset> pictures_;
+        std::pmr::vector<Asset> pictures_;
 
         /**
          * @brief List of animation files
          */
-        std::vector<Asset> animation_files_;
+        std::pmr::vector<Asset> animation_files_;
+
+        /**
+         * @brief Map, track, chipset and asset names of the entries. A copied changelog re-interns them in its own pool.
+         */
+        StringPool strings_;
 
-        std::string stringify();
+        std::string stringify() const;
+
+        void Render(TextWriter &writer) const;
 
         void Serialize(Writer &writer) const;
 
-        Changelog() = default;
+        explicit Changelog(const allocator_type &allocator = {});
+
+        Changelog(const Changelog &other, const allocator_type &allocator = {});
+
+        Changelog(Changelog &&other) = default;
+
+        Changelog &operator=(const Changelog &other);
+
+        Changelog &operator=(Changelog &&other) = default;
+
+        /**
+         * @brief Creates a changelog whose entries are allocated in an arena owned with it.
+         * @details Filling the changelog is bump allocation, and dropping the last reference frees the whole
+         * arena at once instead of every string and vector. The changelog is not thread-safe to fill.
+         */
+        static std::shared_ptr<Changelog> withArena();
+
+        allocator_type get_allocator() const {
+            return maps_.get_allocator();
+        }
+
+    private:
+        /**
+         * @brief Re-interns the names of the entries in strings_, after they were copied from another changelog
+         */
+        void internStrings();
     };
 
     inline bool operator==(const Changelog &lhs, const Changelog &rhs) {
@@ -470,7 +705,12 @@ namespace data {
         return !(lhs == rhs);
     }
 
-    void serializeString(Writer& writer, const std::string& str);
+    void serializeString(Writer& writer, std::string_view str);
+
+    /**
+     * @brief Writes the JSON form escaped when the string was interned
+     */
+    void serializeString(Writer& writer, const InternedString& str);
 
 } // data
 
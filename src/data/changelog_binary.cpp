@@ -0,0 +1,508 @@
+#include "changelog_binary.h"
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../utils/error.h"
+
+static_assert(std::endian::native == std::endian::little, "The binary changelog format is little-endian");
+
+namespace data {
+
+    namespace {
+
+        /**
+         * @brief Size of a record of each section, 1 for the string table
+         */
+        constexpr size_t record_sizes[SECTION_COUNT] = {
+                1,
+                sizeof(BinaryString),
+                sizeof(BinaryMap),
+                sizeof(BinaryBGMEvent),
+                sizeof(BinaryMapConnection),
+                sizeof(BinaryMapConnection),
+                sizeof(BinaryConnection),
+                sizeof(BinaryEntry),
+                sizeof(BinaryEntry),
+                sizeof(BinaryEntry),
+                sizeof(BinaryEntry),
+                sizeof(BinaryEntry),
+                sizeof(BinaryAsset)
+        };
+
+        class Encoder {
+        public:
+            std::string encode(const Changelog &changelog) {
+                BinaryHeader header{};
+                std::memcpy(header.magic_, binary_magic, sizeof(binary_magic));
+                header.version_ = binary_version;
+                header.section_count_ = SECTION_COUNT;
+
+                header.developer_ = string(changelog.developer_);
+                header.summary_ = string(changelog.summary_);
+                header.map_policy_ = string(changelog.map_policy_);
+                header.asset_policy_ = string(changelog.asset_policy_);
+
+                header.year_ = changelog.date_.tm_year + 1900;
+                header.month_ = changelog.date_.tm_mon + 1;
+                header.day_ = changelog.date_.tm_mday;
+
+                for (const auto &map: changelog.maps_) {
+                    maps_.push_back(this->map(map));
+                }
+
+                for (const auto &connection: changelog.connections_) {
+                    BinaryConnection record{};
+                    record.status_ = connection.status_;
+                    record.type_ = connection.type_;
+                    record.from_map_id_ = connection.from_map_id_;
+                    record.to_map_id_ = connection.to_map_id_;
+                    record.from_x_ = connection.from_coordinates_.x;
+                    record.from_y_ = connection.from_coordinates_.y;
+                    record.to_x_ = connection.to_coordinates_.x;
+                    record.to_y_ = connection.to_coordinates_.y;
+                    record.notes_ = notes(connection.notes_);
+                    connections_.push_back(record);
+                }
+
+                entries(changelog.common_events_, common_events_);
+                entries(changelog.tilesets_, tilesets_);
+                entries(changelog.switches_, switches_);
+                entries(changelog.variables_, variables_);
+                entries(changelog.animations_, animations_);
+
+                for (const auto *assets: {&changelog.menu_themes_, &changelog.charsets_, &changelog.chipsets_,
+                                          &changelog.musics_, &changelog.sounds_, &changelog.panoramas_,
+                                          &changelog.pictures_, &changelog.animation_files_}) {
+                    for (const auto &asset: *assets) {
+                        BinaryAsset record{};
+                        record.status_ = asset.status_;
+                        record.category_ = asset.category_;
+                        record.name_ = string(asset.name_);
+                        record.filename_ = string(asset.filename_);
+                        record.contributors_ = string(asset.contributors_);
+                        record.notes_ = notes(asset.notes_);
+                        assets_.push_back(record);
+                    }
+                }
+
+                std::string bytes(sizeof(BinaryHeader), '\0');
+                section(bytes, header, SECTION_STRINGS, strings_.data(), strings_.size(), strings_.size());
+                section(bytes, header, SECTION_NOTES, notes_);
+                section(bytes, header, SECTION_MAPS, maps_);
+                section(bytes, header, SECTION_BGM_EVENTS, bgm_events_);
+                section(bytes, header, SECTION_OPEN_CONNECTIONS, open_connections_);
+                section(bytes, header, SECTION_CLOSED_CONNECTIONS, closed_connections_);
+                section(bytes, header, SECTION_CONNECTIONS, connections_);
+                section(bytes, header, SECTION_COMMON_EVENTS, common_events_);
+                section(bytes, header, SECTION_TILESETS, tilesets_);
+                section(bytes, header, SECTION_SWITCHES, switches_);
+                section(bytes, header, SECTION_VARIABLES, variables_);
+                section(bytes, header, SECTION_ANIMATIONS, animations_);
+                section(bytes, header, SECTION_ASSETS, assets_);
+
+                header.size_ = static_cast<uint32_t>(bytes.size());
+                std::memcpy(bytes.data(), &header, sizeof(header));
+
+                return bytes;
+            }
+
+        private:
+            /**
+             * @brief Adds a string to the string table. Repeated strings (notes, contributors...) are stored once.
+             */
+            BinaryString string(std::string_view string) {
+                if (string.empty()) {
+                    return {};
+                }
+
+                const auto found = strings_index_.find(string);
+                if (found != strings_index_.end()) {
+                    return found->second;
+                }
+
+                const BinaryString reference{static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(string.size())};
+                strings_ += string;
+                strings_index_.emplace(string, reference);
+                return reference;
+            }
+
+            BinaryRange notes(const Notes &notes) {
+                const BinaryRange range{static_cast<uint32_t>(notes_.size()), static_cast<uint32_t>(notes.size())};
+                for (const auto &note: notes) {
+                    notes_.push_back(string(note));
+                }
+                return range;
+            }
+
+            BinaryMap map(const Map &map) {
+                BinaryMap record{};
+                record.status_ = map.status_;
+                record.id_ = map.id_;
+                record.name_ = string(map.name_);
+                record.notes_ = notes(map.notes_);
+
+                record.bgm_events_ = {static_cast<uint32_t>(bgm_events_.size()), static_cast<uint32_t>(map.bgm_events_.size())};
+                for (const auto &bgm_event: map.bgm_events_) {
+                    BinaryBGMEvent event{};
+                    event.x_ = bgm_event.coordinates_.x;
+                    event.y_ = bgm_event.coordinates_.y;
+                    event.track_name_ = string(bgm_event.track_name_);
+                    event.volume_ = bgm_event.volume_;
+                    event.speed_ = bgm_event.speed_;
+                    bgm_events_.push_back(event);
+                }
+
+                record.open_connections_ = map_connections(map.open_connections_, open_connections_);
+                record.closed_connections_ = map_connections(map.closed_connections_, closed_connections_);
+
+                record.music_name_ = string(map.main_music_.name);
+                record.music_fadein_ = map.main_music_.fadein;
+                record.music_volume_ = map.main_music_.volume;
+                record.music_tempo_ = map.main_music_.tempo;
+                record.music_balance_ = map.main_music_.balance;
+
+                return record;
+            }
+
+            template<typename T>
+            static BinaryRange map_connections(const std::pmr::vector<T> &connections, std::vector<BinaryMapConnection> &records) {
+                const BinaryRange range{static_cast<uint32_t>(records.size()), static_cast<uint32_t>(connections.size())};
+                for (const auto &connection: connections) {
+                    BinaryMapConnection record{};
+                    record.status_ = connection.status_;
+                    record.x_ = connection.coordinates_.x;
+                    record.y_ = connection.coordinates_.y;
+                    records.push_back(record);
+                }
+                return range;
+            }
+
+            template<typename T>
+            void entries(const std::pmr::vector<T> &entries, std::vector<BinaryEntry> &records) {
+                for (const auto &entry: entries) {
+                    BinaryEntry record{};
+                    record.status_ = entry.status_;
+                    record.id_ = entry.id_;
+                    record.name_ = string(entry.name_);
+                    if constexpr (std::is_same_v<T, TilesetInfo>) {
+                        record.extra_ = string(entry.chipset_name_);
+                    } else if constexpr (std::is_same_v<T, Animation>) {
+                        record.extra_ = string(entry.animation_name_);
+                    }
+                    record.notes_ = notes(entry.notes_);
+                    records.push_back(record);
+                }
+            }
+
+            static void section(std::string &bytes, BinaryHeader &header, BinarySection section, const void *data,
+                                size_t size, size_t count) {
+                bytes.resize((bytes.size() + 3) & ~size_t{3}, '\0');
+                header.sections_[section] = {static_cast<uint32_t>(bytes.size()), static_cast<uint32_t>(count)};
+                bytes.append(static_cast<const char *>(data), size);
+            }
+
+            template<typename T>
+            static void section(std::string &bytes, BinaryHeader &header, BinarySection section, const std::vector<T> &records) {
+                Encoder::section(bytes, header, section, records.data(), records.size() * sizeof(T), records.size());
+            }
+
+            std::string strings_;
+            std::unordered_map<std::string_view, BinaryString> strings_index_;
+
+            std::vector<BinaryString> notes_;
+            std::vector<BinaryMap> maps_;
+            std::vector<BinaryBGMEvent> bgm_events_;
+            std::vector<BinaryMapConnection> open_connections_;
+            std::vector<BinaryMapConnection> closed_connections_;
+            std::vector<BinaryConnection> connections_;
+            std::vector<BinaryEntry> common_events_;
+            std::vector<BinaryEntry> tilesets_;
+            std::vector<BinaryEntry> switches_;
+            std::vector<BinaryEntry> variables_;
+            std::vector<BinaryEntry> animations_;
+            std::vector<BinaryAsset> assets_;
+        };
+
+        // enumerations read from a file are checked, a damaged file must not produce out of range values
+
+        Status decode_status(uint8_t status) {
+            return status <= MODIFIED ? static_cast<Status>(status) : MODIFIED;
+        }
+
+        ConnectionType decode_connection_type(uint8_t type) {
+            return type <= UNLOCKED ? static_cast<ConnectionType>(type) : ONEWAY;
+        }
+
+        Notes decode_notes(const BinaryChangelog &binary, const BinaryRange &range, const Notes::allocator_type &allocator) {
+            Notes notes(allocator);
+            for (const auto &note: binary.records<BinaryString>(SECTION_NOTES, range)) {
+                notes.emplace_back(binary.string(note));
+            }
+            return notes;
+        }
+
+        Map decode_map(const BinaryChangelog &binary, const BinaryMap &record, StringPool &strings,
+                       const Map::allocator_type &allocator) {
+            Map map(allocator);
+            map.status_ = decode_status(record.status_);
+            map.id_ = record.id_;
+            map.name_ = strings.intern(binary.string(record.name_));
+            map.notes_ = decode_notes(binary, record.notes_, allocator);
+
+            for (const auto &event: binary.records<BinaryBGMEvent>(SECTION_BGM_EVENTS, record.bgm_events_)) {
+                map.bgm_events_.push_back({{event.x_, event.y_}, strings.intern(binary.string(event.track_name_)),
+                                           event.volume_, event.speed_});
+            }
+
+            for (const auto &connection: binary.records<BinaryMapConnection>(SECTION_OPEN_CONNECTIONS, record.open_connections_)) {
+                map.open_connections_.push_back({decode_status(connection.status_), {connection.x_, connection.y_}});
+            }
+
+            for (const auto &connection: binary.records<BinaryMapConnection>(SECTION_CLOSED_CONNECTIONS, record.closed_connections_)) {
+                map.closed_connections_.push_back({decode_status(connection.status_), {connection.x_, connection.y_}});
+            }
+
+            map.main_music_.name = binary.string(record.music_name_);
+            map.main_music_.fadein = record.music_fadein_;
+            map.main_music_.volume = record.music_volume_;
+            map.main_music_.tempo = record.music_tempo_;
+            map.main_music_.balance = record.music_balance_;
+
+            return map;
+        }
+
+        template<typename T>
+        void decode_entries(const BinaryChangelog &binary, BinarySection section, StringPool &strings,
+                            std::pmr::vector<T> &entries) {
+            const auto allocator = entries.get_allocator();
+            for (const auto &record: binary.records<BinaryEntry>(section)) {
+                T entry(allocator);
+                entry.status_ = decode_status(record.status_);
+                entry.id_ = record.id_;
+                entry.name_ = binary.string(record.name_);
+                if constexpr (std::is_same_v<T, TilesetInfo>) {
+                    entry.chipset_name_ = strings.intern(binary.string(record.extra_));
+                } else if constexpr (std::is_same_v<T, Animation>) {
+                    entry.animation_name_ = strings.intern(binary.string(record.extra_));
+                }
+                entry.notes_ = decode_notes(binary, record.notes_, allocator);
+                entries.push_back(std::move(entry));
+            }
+        }
+
+    }
+
+    std::string encodeBinary(const Changelog &changelog) {
+        return Encoder().encode(changelog);
+    }
+
+    bool writeBinary(const Changelog &changelog, const fs::path &path) {
+        return writeBinary(encodeBinary(changelog), path);
+    }
+
+    bool writeBinary(std::string_view bytes, const fs::path &path) {
+        // written next to the file then renamed, so that readers never map a partial file
+        fs::path temporary = path;
+        temporary += ".tmp";
+
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            if (!file) {
+                error("Could not write " + std::string(temporary));
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        fs::rename(temporary, path, ec);
+        if (ec) {
+            error("Could not write " + std::string(path) + ": " + ec.message());
+            fs::remove(temporary, ec);
+            return false;
+        }
+
+        return true;
+    }
+
+    std::unique_ptr<BinaryChangelog> BinaryChangelog::open(const fs::path &path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error("Could not open " + std::string(path));
+            return nullptr;
+        }
+
+        struct stat status{};
+        if (fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(BinaryHeader))) {
+            close(fd);
+            error("Not a binary changelog: " + std::string(path));
+            return nullptr;
+        }
+
+        const auto size = static_cast<size_t>(status.st_size);
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (mapping == MAP_FAILED) {
+            error("Could not map " + std::string(path));
+            return nullptr;
+        }
+
+        std::unique_ptr<BinaryChangelog> binary(new BinaryChangelog());
+        binary->mapping_ = mapping;
+        binary->mapping_size_ = size;
+        binary->bytes_ = std::string_view(static_cast<const char *>(mapping), size);
+
+        if (!binary->validate()) {
+            error("Not a binary changelog: " + std::string(path));
+            return nullptr;
+        }
+
+        return binary;
+    }
+
+    std::unique_ptr<BinaryChangelog> BinaryChangelog::view(std::string_view bytes) {
+        if (reinterpret_cast<uintptr_t>(bytes.data()) % alignof(uint32_t) != 0) {
+            return nullptr;
+        }
+
+        std::unique_ptr<BinaryChangelog> binary(new BinaryChangelog());
+        binary->bytes_ = bytes;
+
+        if (!binary->validate()) {
+            return nullptr;
+        }
+
+        return binary;
+    }
+
+    BinaryChangelog::~BinaryChangelog() {
+        if (mapping_) {
+            munmap(mapping_, mapping_size_);
+        }
+    }
+
+    bool BinaryChangelog::validate() {
+        if (bytes_.size() < sizeof(BinaryHeader)) {
+            return false;
+        }
+
+        header_ = reinterpret_cast<const BinaryHeader *>(bytes_.data());
+
+        if (std::memcmp(header_->magic_, binary_magic, sizeof(binary_magic)) != 0 ||
+            header_->version_ != binary_version || header_->section_count_ != SECTION_COUNT ||
+            header_->size_ != bytes_.size()) {
+            return false;
+        }
+
+        for (size_t section = 0; section < SECTION_COUNT; section++) {
+            const auto &entry = header_->sections_[section];
+            if (entry.offset_ % alignof(uint32_t) != 0 || entry.offset_ > bytes_.size() ||
+                uint64_t{entry.count_} * record_sizes[section] > bytes_.size() - entry.offset_) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::string_view BinaryChangelog::string(const BinaryString &string) const {
+        const auto &strings = header_->sections_[SECTION_STRINGS];
+        if (string.offset_ > strings.count_ || string.size_ > strings.count_ - string.offset_) {
+            return {};
+        }
+
+        return bytes_.substr(strings.offset_ + string.offset_, string.size_);
+    }
+
+    std::shared_ptr<Changelog> BinaryChangelog::decode() const {
+        auto changelog = Changelog::withArena();
+        const auto allocator = changelog->get_allocator();
+
+        changelog->developer_ = string(header_->developer_);
+        changelog->summary_ = string(header_->summary_);
+        changelog->map_policy_ = string(header_->map_policy_);
+        changelog->asset_policy_ = string(header_->asset_policy_);
+
+        changelog->date_.tm_year = header_->year_ - 1900;
+        changelog->date_.tm_mon = header_->month_ - 1;
+        changelog->date_.tm_mday = header_->day_;
+
+        const auto maps = records<BinaryMap>(SECTION_MAPS);
+        changelog->maps_.reserve(maps.size());
+        for (const auto &map: maps) {
+            changelog->maps_.push_back(decode_map(*this, map, changelog->strings_, allocator));
+        }
+
+        for (const auto &record: records<BinaryConnection>(SECTION_CONNECTIONS)) {
+            Connection connection(allocator);
+            connection.status_ = decode_status(record.status_);
+            connection.from_map_id_ = record.from_map_id_;
+            connection.from_coordinates_ = {record.from_x_, record.from_y_};
+            connection.to_map_id_ = record.to_map_id_;
+            connection.to_coordinates_ = {record.to_x_, record.to_y_};
+            connection.type_ = decode_connection_type(record.type_);
+            connection.notes_ = decode_notes(*this, record.notes_, allocator);
+            changelog->connections_.push_back(std::move(connection));
+        }
+
+        decode_entries(*this, SECTION_COMMON_EVENTS, changelog->strings_, changelog->common_events_);
+        decode_entries(*this, SECTION_TILESETS, changelog->strings_, changelog->tilesets_);
+        decode_entries(*this, SECTION_SWITCHES, changelog->strings_, changelog->switches_);
+        decode_entries(*this, SECTION_VARIABLES, changelog->strings_, changelog->variables_);
+        decode_entries(*this, SECTION_ANIMATIONS, changelog->strings_, changelog->animations_);
+
+        for (const auto &record: records<BinaryAsset>(SECTION_ASSETS)) {
+            if (record.category_ > BATTLE_ANIMATION) {
+                continue;
+            }
+
+            Asset asset(allocator);
+            asset.status_ = decode_status(record.status_);
+            asset.category_ = static_cast<AssetCategory>(record.category_);
+            asset.name_ = changelog->strings_.intern(string(record.name_));
+            asset.filename_ = changelog->strings_.intern(string(record.filename_));
+            asset.contributors_ = string(record.contributors_);
+            asset.notes_ = decode_notes(*this, record.notes_, allocator);
+
+            switch (asset.category_) {
+                case MENU_THEME:
+                    changelog->menu_themes_.push_back(std::move(asset));
+                    break;
+                case CHARSET:
+                    changelog->charsets_.push_back(std::move(asset));
+                    break;
+                case CHIPSET:
+                    changelog->chipsets_.push_back(std::move(asset));
+                    break;
+                case MUSIC:
+                    changelog->musics_.push_back(std::move(asset));
+                    break;
+                case SOUND:
+                    changelog->sounds_.push_back(std::move(asset));
+                    break;
+                case PANORAMA:
+                    changelog->panoramas_.push_back(std::move(asset));
+                    break;
+                case PICTURE:
+                    changelog->pictures_.push_back(std::move(asset));
+                    break;
+                case BATTLE_ANIMATION:
+                    changelog->animation_files_.push_back(std::move(asset));
+                    break;
+            }
+        }
+
+        return changelog;
+    }
+
+} // data
@@ -0,0 +1,262 @@
+#ifndef CU_SUBMITTER_CHANGELOG_BINARY_H
+#define CU_SUBMITTER_CHANGELOG_BINARY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "changelog.h"
+
+namespace fs = std::filesystem;
+
+namespace data {
+
+    /*
+     * Binary changelog format, version 2. All numbers are little-endian.
+     *
+     * The file starts with a BinaryHeader, followed by the sections it points to. Each section is an array of
+     * fixed-size records, except the string table, which holds the bytes of every string of the changelog once.
+     * Strings are referenced by offset and size in the string table, lists (notes, BGM events...) by a range of
+     * records in their own section. Sections are aligned on 4 bytes, so that records can be read in place from a
+     * mapped file.
+     */
+
+    constexpr char binary_magic[4] = {'C', 'U', 'C', 'L'};
+    /**
+     * @brief Version 2 references the maps of connections by ID instead of storing map records for them
+     */
+    constexpr uint32_t binary_version = 2;
+
+    enum BinarySection : uint32_t {
+        SECTION_STRINGS,
+        SECTION_NOTES,
+        SECTION_MAPS,
+        SECTION_BGM_EVENTS,
+        SECTION_OPEN_CONNECTIONS,
+        SECTION_CLOSED_CONNECTIONS,
+        SECTION_CONNECTIONS,
+        SECTION_COMMON_EVENTS,
+        SECTION_TILESETS,
+        SECTION_SWITCHES,
+        SECTION_VARIABLES,
+        SECTION_ANIMATIONS,
+        SECTION_ASSETS,
+        SECTION_COUNT
+    };
+
+    struct BinaryString {
+        uint32_t offset_;
+        uint32_t size_;
+    };
+
+    struct BinaryRange {
+        uint32_t first_;
+        uint32_t count_;
+    };
+
+    struct BinarySectionEntry {
+        uint32_t offset_;
+        /**
+         * @brief Number of records, or of bytes for the string table
+         */
+        uint32_t count_;
+    };
+
+    struct BinaryHeader {
+        char magic_[4];
+        uint32_t version_;
+        uint32_t size_;
+        uint32_t section_count_;
+
+        BinaryString developer_;
+        BinaryString summary_;
+        BinaryString map_policy_;
+        BinaryString asset_policy_;
+
+        int32_t year_;
+        int32_t month_;
+        int32_t day_;
+
+        BinarySectionEntry sections_[SECTION_COUNT];
+    };
+
+    struct BinaryMap {
+        uint8_t status_;
+        uint8_t padding_[3];
+        uint32_t id_;
+        BinaryString name_;
+
+        BinaryRange notes_;
+        BinaryRange bgm_events_;
+        BinaryRange open_connections_;
+        BinaryRange closed_connections_;
+
+        BinaryString music_name_;
+        int32_t music_fadein_;
+        int32_t music_volume_;
+        int32_t music_tempo_;
+        int32_t music_balance_;
+    };
+
+    struct BinaryBGMEvent {
+        int32_t x_;
+        int32_t y_;
+        BinaryString track_name_;
+        int32_t volume_;
+        int32_t speed_;
+    };
+
+    /**
+     * @brief Open or closed connection of a map
+     */
+    struct BinaryMapConnection {
+        uint8_t status_;
+        uint8_t padding_[3];
+        int32_t x_;
+        int32_t y_;
+    };
+
+    struct BinaryConnection {
+        uint8_t status_;
+        uint8_t type_;
+        uint8_t padding_[2];
+        uint32_t from_map_id_;
+        uint32_t to_map_id_;
+        int32_t from_x_;
+        int32_t from_y_;
+        int32_t to_x_;
+        int32_t to_y_;
+        BinaryRange notes_;
+    };
+
+    /**
+     * @brief Database entry record: common event, tileset, switch, variable or animation
+     * @details extra_ is the chipset name of a tileset or the file name of an animation
+     */
+    struct BinaryEntry {
+        uint8_t status_;
+        uint8_t padding_[3];
+        uint32_t id_;
+        BinaryString name_;
+        BinaryString extra_;
+        BinaryRange notes_;
+    };
+
+    /**
+     * @brief Asset record. The assets of every category are in the same section, in the changelog order.
+     */
+    struct BinaryAsset {
+        uint8_t status_;
+        uint8_t category_;
+        uint8_t padding_[2];
+        BinaryString name_;
+        BinaryString filename_;
+        BinaryString contributors_;
+        BinaryRange notes_;
+    };
+
+    /**
+     * @brief Encodes a changelog in the binary format
+     */
+    std::string encodeBinary(const Changelog &changelog);
+
+    /**
+     * @brief Writes a changelog in the binary format. The file is replaced atomically.
+     * @return false if the file could not be written
+     */
+    bool writeBinary(const Changelog &changelog, const fs::path &path);
+
+    /**
+     * @brief Writes an encoded changelog. The file is replaced atomically.
+     * @return false if the file could not be written
+     */
+    bool writeBinary(std::string_view bytes, const fs::path &path);
+
+    /**
+     * @brief Read-only view of a binary changelog, either in memory or mapped from a file.
+     * @details Strings and records are read in place; decode() builds a data::Changelog when one is needed.
+     */
+    class BinaryChangelog {
+    public:
+        /**
+         * @brief Maps a binary changelog file
+         * @return nullptr if the file cannot be mapped or is not a valid binary changelog
+         */
+        static std::unique_ptr<BinaryChangelog> open(const fs::path &path);
+
+        /**
+         * @brief Views an encoded changelog. The bytes must outlive the view and be aligned on 4 bytes.
+         * @return nullptr if the bytes are not a valid binary changelog
+         */
+        static std::unique_ptr<BinaryChangelog> view(std::string_view bytes);
+
+        ~BinaryChangelog();
+
+        BinaryChangelog(const BinaryChangelog &) = delete;
+
+        BinaryChangelog &operator=(const BinaryChangelog &) = delete;
+
+        const BinaryHeader &header() const {
+            return *header_;
+        }
+
+        /**
+         * @return The whole encoded changelog
+         */
+        std::string_view bytes() const {
+            return bytes_;
+        }
+
+        /**
+         * @return The string, or an empty string if the reference is out of the string table
+         */
+        std::string_view string(const BinaryString &string) const;
+
+        /**
+         * @return Every record of a section
+         */
+        template<typename T>
+        std::span<const T> records(BinarySection section) const {
+            const auto &entry = header_->sections_[section];
+            return {reinterpret_cast<const T *>(bytes_.data() + entry.offset_), entry.count_};
+        }
+
+        /**
+         * @return The records of a range in a section, clamped to the section
+         */
+        template<typename T>
+        std::span<const T> records(BinarySection section, const BinaryRange &range) const {
+            const auto all = records<T>(section);
+            if (range.first_ >= all.size()) {
+                return {};
+            }
+            return all.subspan(range.first_, std::min<size_t>(range.count_, all.size() - range.first_));
+        }
+
+        /**
+         * @brief Builds the changelog
+         */
+        std::shared_ptr<Changelog> decode() const;
+
+    private:
+        BinaryChangelog() = default;
+
+        /**
+         * @brief Checks the header and that every section is inside the bytes
+         */
+        bool validate();
+
+        std::string_view bytes_;
+        const BinaryHeader *header_ = nullptr;
+
+        void *mapping_ = nullptr;
+        size_t mapping_size_ = 0;
+    };
+
+} // data
+
+#endif //CU_SUBMITTER_CHANGELOG_BINARY_H
@@ -0,0 +1,370 @@
+#include "changelog_index.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../utils/utils.h"
+
+namespace data {
+
+    namespace {
+
+        const char hex_digits[] = "0123456789abcdef";
+
+        /**
+         * @brief Appends a number in big endian, so that keys compare like the numbers
+         */
+        void append_key(std::string &key, uint32_t value) {
+            key += static_cast<char>(value >> 24);
+            key += static_cast<char>(value >> 16);
+            key += static_cast<char>(value >> 8);
+            key += static_cast<char>(value);
+        }
+
+        void append_key(std::string &key, int value) {
+            append_key(key, static_cast<uint32_t>(value) ^ 0x80000000u);
+        }
+
+        template<typename T>
+        std::string entry_key(const T &entry) {
+            std::string key;
+            append_key(key, static_cast<uint32_t>(entry.id_));
+            return key;
+        }
+
+        std::string entry_key(const Connection &connection) {
+            std::string key;
+            append_key(key, connection.from_map_id_);
+            append_key(key, connection.from_coordinates_.x);
+            append_key(key, connection.from_coordinates_.y);
+            append_key(key, connection.to_map_id_);
+            append_key(key, connection.to_coordinates_.x);
+            append_key(key, connection.to_coordinates_.y);
+            return key;
+        }
+
+        std::string entry_key(const Asset &asset) {
+            return std::string(asset.filename_.view());
+        }
+
+        template<typename T>
+        void serialize_entry(Writer &writer, const T &entry, const MapNames &) {
+            entry.Serialize(writer);
+        }
+
+        void serialize_entry(Writer &writer, const Connection &connection, const MapNames &map_names) {
+            connection.Serialize(writer, map_names);
+        }
+
+        /**
+         * @brief Calls a function with the entries of a category
+         * @return false if there is no such category
+         */
+        template<typename F>
+        bool visit_category(const Changelog &changelog, std::string_view category, F &&f) {
+            if (category == "maps") {
+                f(changelog.maps_);
+            } else if (category == "connections") {
+                f(changelog.connections_);
+            } else if (category == "common_events") {
+                f(changelog.common_events_);
+            } else if (category == "tilesets") {
+                f(changelog.tilesets_);
+            } else if (category == "switches") {
+                f(changelog.switches_);
+            } else if (category == "variables") {
+                f(changelog.variables_);
+            } else if (category == "animations") {
+                f(changelog.animations_);
+            } else if (category == "menu_themes") {
+                f(changelog.menu_themes_);
+            } else if (category == "charsets") {
+                f(changelog.charsets_);
+            } else if (category == "chipsets") {
+                f(changelog.chipsets_);
+            } else if (category == "musics") {
+                f(changelog.musics_);
+            } else if (category == "sounds") {
+                f(changelog.sounds_);
+            } else if (category == "panoramas") {
+                f(changelog.panoramas_);
+            } else if (category == "pictures") {
+                f(changelog.pictures_);
+            } else if (category == "animation_files") {
+                f(changelog.animation_files_);
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        int hex_value(char c) {
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            }
+            if (c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            }
+            if (c >= 'A' && c <= 'F') {
+                return c - 'A' + 10;
+            }
+            return -1;
+        }
+
+        std::string decode_cursor(std::string_view cursor) {
+            if (cursor.size() % 2 != 0) {
+                throw std::invalid_argument("Invalid cursor");
+            }
+
+            std::string key;
+            key.reserve(cursor.size() / 2);
+            for (size_t i = 0; i < cursor.size(); i += 2) {
+                const int high = hex_value(cursor[i]);
+                const int low = hex_value(cursor[i + 1]);
+                if (high < 0 || low < 0) {
+                    throw std::invalid_argument("Invalid cursor");
+                }
+                key += static_cast<char>(high << 4 | low);
+            }
+            return key;
+        }
+
+    }
+
+    const std::vector<std::string> &changelog_categories() {
+        static const std::vector<std::string> categories = {
+                "maps", "connections", "common_events", "tilesets", "switches", "variables", "animations",
+                "menu_themes", "charsets", "chipsets", "musics", "sounds", "panoramas", "pictures", "animation_files"
+        };
+        return categories;
+    }
+
+    std::optional<Status> parse_status(std::string_view name) {
+        if (name == "added") {
+            return ADDED;
+        }
+        if (name == "removed") {
+            return REMOVED;
+        }
+        if (name == "modified") {
+            return MODIFIED;
+        }
+        return std::nullopt;
+    }
+
+    ChangelogIndex::ChangelogIndex(const Changelog &changelog) : changelog_(changelog) {
+        if (!changelog_.connections_.empty()) {
+            for (const auto &map: changelog_.maps_) {
+                map_names_.emplace(map.id_, map.name_);
+            }
+        }
+
+        rapidjson::StringBuffer sb;
+        Writer writer(sb);
+
+        for (const auto &name: changelog_categories()) {
+            auto &category = categories_[name];
+
+            visit_category(changelog_, name, [&](const auto &entries) {
+                category.entries_.reserve(entries.size());
+                for (uint32_t position = 0; position < entries.size(); ++position) {
+                    sb.Clear();
+                    writer.Reset(sb);
+                    serialize_entry(writer, entries[position], map_names_);
+
+                    category.entries_.push_back({entry_key(entries[position]), entries[position].status_, position,
+                                                 utils::hashBytes(sb.GetString(), sb.GetSize())});
+                }
+            });
+
+            // stable, so that entries with the same key keep the changelog order
+            std::stable_sort(category.entries_.begin(), category.entries_.end(), [](const Entry &lhs, const Entry &rhs) {
+                return lhs.key_ < rhs.key_;
+            });
+
+            for (uint32_t i = 0; i < category.entries_.size(); ++i) {
+                category.by_status_[category.entries_[i].status_].push_back(i);
+            }
+        }
+    }
+
+    const std::vector<ChangelogIndex::Entry> *ChangelogIndex::entries(std::string_view category) const {
+        const auto found = categories_.find(category);
+        return found == categories_.end() ? nullptr : &found->second.entries_;
+    }
+
+    void ChangelogIndex::SerializeSummary(Writer &writer) const {
+        writer.StartObject();
+
+        for (const auto &name: changelog_categories()) {
+            const auto &category = categories_.at(name);
+
+            writer.String(name.c_str(), static_cast<rapidjson::SizeType>(name.size()));
+            writer.StartObject();
+
+            writer.String("total");
+            writer.Uint64(category.entries_.size());
+
+            writer.String("added");
+            writer.Uint64(category.by_status_[ADDED].size());
+
+            writer.String("removed");
+            writer.Uint64(category.by_status_[REMOVED].size());
+
+            writer.String("modified");
+            writer.Uint64(category.by_status_[MODIFIED].size());
+
+            writer.EndObject();
+        }
+
+        writer.EndObject();
+    }
+
+    void ChangelogIndex::SerializePage(Writer &writer, const Query &query) const {
+        const auto found = categories_.find(query.category_);
+        if (found == categories_.end()) {
+            throw std::invalid_argument("Unknown category " + query.category_);
+        }
+
+        const auto &category = found->second;
+        const auto *selection = query.status_ ? &category.by_status_[*query.status_] : nullptr;
+        const size_t total = selection ? selection->size() : category.entries_.size();
+
+        const auto at = [&category, selection](size_t i) -> const Entry & {
+            return selection ? category.entries_[(*selection)[i]] : category.entries_[i];
+        };
+
+        size_t begin = std::min(query.offset_, total);
+        if (query.cursor_) {
+            // the first entry after the cursor
+            const std::string key = decode_cursor(*query.cursor_);
+            size_t low = 0;
+            size_t high = total;
+            while (low < high) {
+                const size_t middle = low + (high - low) / 2;
+                if (at(middle).key_ <= key) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            begin = low;
+        }
+
+        const size_t end = begin + std::min({query.limit_, max_limit, total - begin});
+
+        writer.StartObject();
+
+        writer.String("category");
+        serializeString(writer, query.category_);
+
+        writer.String("total");
+        writer.Uint64(total);
+
+        writer.String("offset");
+        writer.Uint64(begin);
+
+        writer.String("entries");
+        writer.StartArray();
+
+        for (size_t i = begin; i < end; ++i) {
+            SerializeEntry(writer, query.category_, at(i));
+        }
+
+        writer.EndArray();
+
+        writer.String("next_cursor");
+        if (end < total && end > begin) {
+            serializeString(writer, cursor(at(end - 1)));
+        } else {
+            writer.Null();
+        }
+
+        writer.EndObject();
+    }
+
+    void ChangelogIndex::SerializeDelta(Writer &writer, const ChangelogIndex &previous) const {
+        std::vector<const Entry *> added;
+        std::vector<const Entry *> removed;
+        std::vector<const Entry *> changed;
+
+        writer.StartObject();
+
+        for (const auto &name: changelog_categories()) {
+            const auto &entries = categories_.at(name).entries_;
+            const auto &previous_entries = previous.categories_.at(name).entries_;
+
+            added.clear();
+            removed.clear();
+            changed.clear();
+
+            auto current = entries.begin();
+            auto old = previous_entries.begin();
+            while (current != entries.end() || old != previous_entries.end()) {
+                if (old == previous_entries.end() || (current != entries.end() && current->key_ < old->key_)) {
+                    added.push_back(&*current++);
+                } else if (current == entries.end() || old->key_ < current->key_) {
+                    removed.push_back(&*old++);
+                } else {
+                    if (current->hash_ != old->hash_) {
+                        changed.push_back(&*current);
+                    }
+                    ++current;
+                    ++old;
+                }
+            }
+
+            if (added.empty() && removed.empty() && changed.empty()) {
+                continue;
+            }
+
+            writer.String(name.c_str(), static_cast<rapidjson::SizeType>(name.size()));
+            writer.StartObject();
+
+            writer.String("added");
+            writer.StartArray();
+            for (const auto *entry: added) {
+                SerializeEntry(writer, name, *entry);
+            }
+            writer.EndArray();
+
+            writer.String("removed");
+            writer.StartArray();
+            for (const auto *entry: removed) {
+                previous.SerializeEntry(writer, name, *entry);
+            }
+            writer.EndArray();
+
+            writer.String("changed");
+            writer.StartArray();
+            for (const auto *entry: changed) {
+                SerializeEntry(writer, name, *entry);
+            }
+            writer.EndArray();
+
+            writer.EndObject();
+        }
+
+        writer.EndObject();
+    }
+
+    void ChangelogIndex::SerializeEntry(Writer &writer, std::string_view category, const Entry &entry) const {
+        visit_category(changelog_, category, [&](const auto &entries) {
+            if (entry.position_ < entries.size()) {
+                serialize_entry(writer, entries[entry.position_], map_names_);
+            }
+        });
+    }
+
+    std::string ChangelogIndex::cursor(const Entry &entry) {
+        std::string cursor;
+        cursor.reserve(entry.key_.size() * 2);
+        for (const char c: entry.key_) {
+            const auto byte = static_cast<unsigned char>(c);
+            cursor += hex_digits[byte >> 4];
+            cursor += hex_digits[byte & 0xF];
+        }
+        return cursor;
+    }
+
+} // data
@@ -0,0 +1,122 @@
+#ifndef CU_SUBMITTER_CHANGELOG_INDEX_H
+#define CU_SUBMITTER_CHANGELOG_INDEX_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "changelog.h"
+
+namespace data {
+
+    /**
+     * @return The categories of a changelog, named as in its JSON form and in serialization order
+     */
+    const std::vector<std::string> &changelog_categories();
+
+    /**
+     * @brief Parses a status filter, "added", "removed" or "modified"
+     * @return std::nullopt if the name is none of them
+     */
+    std::optional<Status> parse_status(std::string_view name);
+
+    /**
+     * @brief Index over the entries of a changelog, by category, by status and by key.
+     * @details The key identifies an entry within its category: the ID of maps and database entries, the maps and
+     * coordinates of connections, the file name of assets. Keys are binary strings ordered like the values they encode,
+     * and the entries of a category are sorted by key, so that pages have a stable order and a cursor stays valid
+     * whatever the pages requested before.
+     * The changelog must outlive the index and must not be modified.
+     */
+    class ChangelogIndex {
+    public:
+        /**
+         * @brief An entry of a category
+         */
+        struct Entry {
+            std::string key_;
+            Status status_;
+            /**
+             * @brief Position of the entry in the vector of its category
+             */
+            uint32_t position_;
+            /**
+             * @brief Digest of the JSON form of the entry, which differs if any field of the entry does
+             */
+            uint64_t hash_;
+        };
+
+        /**
+         * @brief A slice of the entries of a category
+         */
+        struct Query {
+            std::string category_;
+            std::optional<Status> status_;
+            size_t offset_ = 0;
+            size_t limit_ = 100;
+            /**
+             * @brief next_cursor of the previous page. When set, the page starts after it and offset_ is ignored.
+             */
+            std::optional<std::string> cursor_;
+        };
+
+        static constexpr size_t max_limit = 1000;
+
+        explicit ChangelogIndex(const Changelog &changelog);
+
+        /**
+         * @return The entries of a category sorted by key, or nullptr if there is no such category
+         */
+        const std::vector<Entry> *entries(std::string_view category) const;
+
+        /**
+         * @brief Writes the number of entries of each category as a JSON object, in total and by status
+         */
+        void SerializeSummary(Writer &writer) const;
+
+        /**
+         * @brief Writes the page of a query as a JSON object: the total number of matching entries, the entries of
+         * the page and the cursor of the next page, null on the last one.
+         * @throws std::invalid_argument if the category or the cursor is not valid
+         */
+        void SerializePage(Writer &writer, const Query &query) const;
+
+        /**
+         * @brief Writes what changed since a previous version of the changelog, as a JSON object.
+         * @details The entries of each category are matched by key with a merge of both sorted indices. For every
+         * category that changed, "added" has the entries whose key is new, "removed" the previous entries whose key
+         * is gone, and "changed" the entries whose key is in both but whose content differs.
+         */
+        void SerializeDelta(Writer &writer, const ChangelogIndex &previous) const;
+
+        /**
+         * @brief Writes an entry of a category as it is in the changelog JSON
+         */
+        void SerializeEntry(Writer &writer, std::string_view category, const Entry &entry) const;
+
+        /**
+         * @return The cursor of an entry, the key in hexadecimal so that it can be passed in a URL
+         */
+        static std::string cursor(const Entry &entry);
+
+    private:
+        struct Category {
+            std::vector<Entry> entries_;
+            /**
+             * @brief Indices in entries_ of the entries of each status, in key order
+             */
+            std::array<std::vector<uint32_t>, 3> by_status_;
+        };
+
+        const Changelog &changelog_;
+        std::unordered_map<std::string_view, Category> categories_;
+        MapNames map_names_;
+    };
+
+} // data
+
+#endif //CU_SUBMITTER_CHANGELOG_INDEX_H
@@ -0,0 +1,203 @@
+#include "changelog_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+
+#include "changelog_binary.h"
+#include "../utils/log.h"
+#include "../utils/utils.h"
+
+namespace data {
+
+    namespace {
+
+        const std::string extension = ".cucl";
+
+        /**
+         * @return The timestamp of a file of the kind, or -1 if the file is not one
+         */
+        int64_t file_timestamp(const std::string &filename, const std::string &kind) {
+            const std::string prefix = kind + "_";
+            if (filename.size() <= prefix.size() + extension.size() || filename.compare(0, prefix.size(), prefix) != 0 ||
+                filename.compare(filename.size() - extension.size(), extension.size(), extension) != 0) {
+                return -1;
+            }
+
+            const std::string timestamp = filename.substr(prefix.size(), filename.size() - prefix.size() - extension.size());
+            if (timestamp.size() > 18 || timestamp.find_first_not_of("0123456789") != std::string::npos) {
+                return -1;
+            }
+
+            return std::stoll(timestamp);
+        }
+
+    }
+
+    StoredChangelog::StoredChangelog(std::string id, std::shared_ptr<Changelog> changelog, uint64_t hash)
+            : id_(std::move(id)), changelog_(std::move(changelog)) {
+        char version[17];
+        std::snprintf(version, sizeof(version), "%016llx", static_cast<unsigned long long>(hash));
+        version_ = version;
+    }
+
+    std::shared_ptr<const std::string> StoredChangelog::body(const std::string &key,
+                                                            const std::function<std::string()> &render) const {
+        // rendered under the lock, so that concurrent requests wait for the first one instead of rendering too
+        std::lock_guard lock(mutex_);
+
+        auto &body = bodies_[key];
+        if (!body) {
+            body = std::make_shared<const std::string>(render());
+        }
+        return body;
+    }
+
+    const ChangelogIndex &StoredChangelog::index() const {
+        std::lock_guard lock(mutex_);
+
+        if (!index_) {
+            index_ = std::make_unique<ChangelogIndex>(*changelog_);
+        }
+        return *index_;
+    }
+
+    ChangelogStore::ChangelogStore(fs::path directory) : directory_(std::move(directory)) {
+    }
+
+    std::shared_ptr<const StoredChangelog> ChangelogStore::save(const std::string &kind,
+                                                                const std::shared_ptr<Changelog> &changelog) {
+        if (!changelog) {
+            return nullptr;
+        }
+
+        // the timestamp orders the files, newestFile also relies on it being unique
+        static std::atomic<int64_t> last_timestamp{0};
+        int64_t timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        int64_t previous = last_timestamp.load();
+        do {
+            timestamp = std::max(timestamp, previous + 1);
+        } while (!last_timestamp.compare_exchange_weak(previous, timestamp));
+
+        const std::string id = kind + "_" + std::to_string(timestamp);
+        const std::string bytes = encodeBinary(*changelog);
+
+        auto stored = std::make_shared<const StoredChangelog>(id, changelog, utils::hashBytes(bytes.data(), bytes.size()));
+        {
+            std::lock_guard lock(mutex_);
+            latest_[kind] = stored;
+        }
+
+        std::error_code ec;
+        fs::create_directories(directory_, ec);
+
+        const auto path = directory_ / fs::path(id + extension);
+        if (writeBinary(bytes, path)) {
+            debug("Changelog saved: " + std::string(path));
+        }
+        return stored;
+    }
+
+    std::shared_ptr<const StoredChangelog> ChangelogStore::latest(const std::string &kind) {
+        std::lock_guard lock(mutex_);
+
+        const auto found = latest_.find(kind);
+        if (found != latest_.end()) {
+            return found->second;
+        }
+
+        const auto path = newestFile(kind);
+        if (path.empty()) {
+            return nullptr;
+        }
+
+        auto stored = load(path);
+        if (!stored) {
+            return nullptr;
+        }
+
+        log("Changelog reloaded: " + std::string(path));
+
+        latest_[kind] = stored;
+        return stored;
+    }
+
+    std::shared_ptr<const StoredChangelog> ChangelogStore::find(const std::string &id) {
+        std::lock_guard lock(mutex_);
+
+        for (const auto &[kind, stored]: latest_) {
+            if (stored->id() == id) {
+                return stored;
+            }
+        }
+
+        for (auto it = found_.begin(); it != found_.end(); ++it) {
+            if ((*it)->id() == id) {
+                auto stored = *it;
+                found_.erase(it);
+                found_.push_front(stored);
+                return stored;
+            }
+        }
+
+        // the ID becomes a path, so it must be exactly the name of a changelog file
+        const size_t separator = id.rfind('_');
+        if (separator == std::string::npos || separator == 0 ||
+            id.find_first_not_of("abcdefghijklmnopqrstuvwxyz") < separator ||
+            file_timestamp(id + extension, id.substr(0, separator)) < 0) {
+            return nullptr;
+        }
+
+        const auto path = directory_ / fs::path(id + extension);
+        std::error_code ec;
+        if (!fs::is_regular_file(path, ec)) {
+            return nullptr;
+        }
+
+        auto stored = load(path);
+        if (!stored) {
+            return nullptr;
+        }
+
+        found_.push_front(stored);
+        if (found_.size() > found_cache_size) {
+            found_.pop_back();
+        }
+        return stored;
+    }
+
+    std::shared_ptr<const StoredChangelog> ChangelogStore::load(const fs::path &path) {
+        const auto binary = BinaryChangelog::open(path);
+        if (!binary) {
+            return nullptr;
+        }
+
+        const auto bytes = binary->bytes();
+        return std::make_shared<const StoredChangelog>(path.stem().string(), binary->decode(),
+                                                       utils::hashBytes(bytes.data(), bytes.size()));
+    }
+
+    fs::path ChangelogStore::newestFile(const std::string &kind) const {
+        std::error_code ec;
+        if (!fs::is_directory(directory_, ec)) {
+            return {};
+        }
+
+        fs::path newest;
+        int64_t newest_timestamp = -1;
+
+        for (const auto &entry: fs::directory_iterator(directory_, ec)) {
+            const int64_t timestamp = file_timestamp(entry.path().filename().string(), kind);
+            if (timestamp > newest_timestamp) {
+                newest_timestamp = timestamp;
+                newest = entry.path();
+            }
+        }
+
+        return newest;
+    }
+
+} // data
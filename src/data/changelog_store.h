@@ -0,0 +1,128 @@
+#ifndef CU_SUBMITTER_CHANGELOG_STORE_H
+#define CU_SUBMITTER_CHANGELOG_STORE_H
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "changelog.h"
+#include "changelog_index.h"
+
+namespace fs = std::filesystem;
+
+namespace data {
+
+    /**
+     * @brief A changelog of the store, versioned by a hash of its binary encoding.
+     * @details A stored changelog never changes, so the bodies it is sent as are rendered once and kept with it.
+     */
+    class StoredChangelog {
+    public:
+        /**
+         * @param id Name of the file of the changelog, without its extension
+         */
+        StoredChangelog(std::string id, std::shared_ptr<Changelog> changelog, uint64_t hash);
+
+        const std::string &id() const {
+            return id_;
+        }
+
+        const std::shared_ptr<Changelog> &changelog() const {
+            return changelog_;
+        }
+
+        /**
+         * @return The content hash in hexadecimal. It is the same after a restart, the file being hashed on reload.
+         */
+        const std::string &version() const {
+            return version_;
+        }
+
+        /**
+         * @brief Returns a body of the changelog, rendering it the first time it is asked for
+         * @param key Identifies the body, e.g. its format and encoding
+         * @param render Called at most once per key
+         */
+        std::shared_ptr<const std::string> body(const std::string &key, const std::function<std::string()> &render) const;
+
+        /**
+         * @return The index of the entries, built the first time it is asked for
+         */
+        const ChangelogIndex &index() const;
+
+    private:
+        std::string id_;
+        std::shared_ptr<Changelog> changelog_;
+        std::string version_;
+
+        mutable std::mutex mutex_;
+        mutable std::map<std::string, std::shared_ptr<const std::string>> bodies_;
+        mutable std::unique_ptr<ChangelogIndex> index_;
+    };
+
+    /**
+     * @brief Persists generated changelogs in the binary format, one file per changelog.
+     * @details Files are named <kind>_<milliseconds since epoch>.cucl, kind being "transfer" or "submit", and the
+     * file name without its extension is the ID of the changelog.
+     * The latest changelog of each kind is kept in memory, and reloaded from the newest file after a restart. The
+     * last few changelogs found by ID are kept too.
+     */
+    class ChangelogStore {
+    public:
+        explicit ChangelogStore(fs::path directory);
+
+        /**
+         * @brief Writes a changelog and makes it the latest of its kind
+         * @return The stored changelog, nullptr if there is none. It is kept as the latest even if the file could not
+         * be written.
+         */
+        std::shared_ptr<const StoredChangelog> save(const std::string &kind, const std::shared_ptr<Changelog> &changelog);
+
+        /**
+         * @return The latest changelog of a kind, or nullptr if none was ever saved
+         */
+        std::shared_ptr<const StoredChangelog> latest(const std::string &kind);
+
+        /**
+         * @return The changelog with an ID, loaded from its file if it is not in memory, or nullptr if there is none
+         */
+        std::shared_ptr<const StoredChangelog> find(const std::string &id);
+
+        const fs::path &directory() const {
+            return directory_;
+        }
+
+    private:
+        /**
+         * @return The newest file of a kind, or an empty path
+         */
+        fs::path newestFile(const std::string &kind) const;
+
+        /**
+         * @brief Maps and decodes a changelog file
+         * @return nullptr if the file is not a valid binary changelog
+         */
+        static std::shared_ptr<const StoredChangelog> load(const fs::path &path);
+
+        /**
+         * @brief Number of changelogs found by ID that are kept in memory, besides the latest ones
+         */
+        static constexpr size_t found_cache_size = 8;
+
+        fs::path directory_;
+
+        std::mutex mutex_;
+        std::unordered_map<std::string, std::shared_ptr<const StoredChangelog>> latest_;
+        // most recently found first
+        std::deque<std::shared_ptr<const StoredChangelog>> found_;
+    };
+
+} // data
+
+#endif //CU_SUBMITTER_CHANGELOG_STORE_H
@@ -0,0 +1,132 @@
+#include "string_pool.h"
+
+#include <cstring>
+#include <new>
+#include <unordered_map>
+
+namespace data {
+
+    namespace {
+
+        const char hex_digits[] = "0123456789ABCDEF";
+
+        /**
+         * @return The escape of a character, 0 if it is written as is. 'u' is a \u00XX escape.
+         * @details Same table as rapidjson::Writer, so that pre-escaped strings match the ones it writes
+         */
+        char escape(unsigned char c) {
+            switch (c) {
+                case '\b':
+                    return 'b';
+                case '\t':
+                    return 't';
+                case '\n':
+                    return 'n';
+                case '\f':
+                    return 'f';
+                case '\r':
+                    return 'r';
+                case '"':
+                    return '"';
+                case '\\':
+                    return '\\';
+                default:
+                    return c < 0x20 ? 'u' : 0;
+            }
+        }
+
+        size_t json_size(std::string_view string) {
+            size_t size = string.size() + 2;
+            for (const char c: string) {
+                const char escaped = escape(static_cast<unsigned char>(c));
+                if (escaped) {
+                    size += escaped == 'u' ? 5 : 1;
+                }
+            }
+            return size;
+        }
+
+        char *write_json(std::string_view string, char *out) {
+            *out++ = '"';
+            for (const char c: string) {
+                const auto byte = static_cast<unsigned char>(c);
+                const char escaped = escape(byte);
+                if (!escaped) {
+                    *out++ = c;
+                    continue;
+                }
+
+                *out++ = '\\';
+                *out++ = escaped;
+                if (escaped == 'u') {
+                    *out++ = '0';
+                    *out++ = '0';
+                    *out++ = hex_digits[byte >> 4];
+                    *out++ = hex_digits[byte & 0xF];
+                }
+            }
+            *out++ = '"';
+            return out;
+        }
+
+    }
+
+    struct StringPool::Storage {
+        explicit Storage(std::pmr::memory_resource *upstream) : memory_(upstream) {
+        }
+
+        std::pmr::monotonic_buffer_resource memory_;
+        // declared after the memory it is allocated in, so that it is destroyed first
+        std::pmr::unordered_map<std::string_view, const InternedString::Entry *> index_{&memory_};
+    };
+
+    StringPool::StringPool(const allocator_type &allocator) : upstream_(allocator.resource()) {
+    }
+
+    StringPool::~StringPool() = default;
+
+    StringPool::StringPool(StringPool &&other) noexcept = default;
+
+    StringPool &StringPool::operator=(StringPool &&other) noexcept = default;
+
+    InternedString StringPool::intern(std::string_view string) {
+        if (string.empty()) {
+            return {};
+        }
+
+        if (!storage_) {
+            storage_ = std::make_unique<Storage>(upstream_);
+        } else {
+            const auto found = storage_->index_.find(string);
+            if (found != storage_->index_.end()) {
+                return InternedString(found->second);
+            }
+        }
+
+        // the text and its JSON form are stored next to each other
+        const size_t size = json_size(string);
+        auto *bytes = static_cast<char *>(storage_->memory_.allocate(string.size() + size, 1));
+        std::memcpy(bytes, string.data(), string.size());
+        write_json(string, bytes + string.size());
+
+        void *memory = storage_->memory_.allocate(sizeof(InternedString::Entry), alignof(InternedString::Entry));
+        const auto *entry = new(memory) InternedString::Entry{std::string_view(bytes, string.size()),
+                                                              std::string_view(bytes + string.size(), size),
+                                                              storage_.get()};
+
+        storage_->index_.emplace(entry->text_, entry);
+        return InternedString(entry);
+    }
+
+    InternedString StringPool::intern(const InternedString &string) {
+        if (string.empty() || string.entry_->pool_ == storage_.get()) {
+            return string;
+        }
+        return intern(string.view());
+    }
+
+    size_t StringPool::size() const {
+        return storage_ ? storage_->index_.size() : 0;
+    }
+
+} // data
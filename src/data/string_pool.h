@@ -0,0 +1,126 @@
+#ifndef CU_SUBMITTER_STRING_POOL_H
+#define CU_SUBMITTER_STRING_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+
+namespace data {
+
+    /**
+     * @brief Handle to a string interned in a StringPool.
+     * @details Converts to std::string_view. Two handles of the same pool are equal only if they point to the same
+     * entry, so comparing them is a pointer comparison. The handle also gives the JSON form of the string, quoted and
+     * escaped once when it was interned. The default handle is the empty string.
+     */
+    class InternedString {
+    public:
+        InternedString() = default;
+
+        std::string_view view() const {
+            return entry_ ? entry_->text_ : std::string_view();
+        }
+
+        operator std::string_view() const {
+            return view();
+        }
+
+        /**
+         * @return The string quoted and escaped as rapidjson writes it
+         */
+        std::string_view json() const {
+            return entry_ ? entry_->json_ : std::string_view("\"\"");
+        }
+
+        bool empty() const {
+            return !entry_;
+        }
+
+        size_t size() const {
+            return view().size();
+        }
+
+        friend bool operator==(const InternedString &lhs, const InternedString &rhs) {
+            if (lhs.entry_ == rhs.entry_) {
+                return true;
+            }
+            if (!lhs.entry_ || !rhs.entry_ || lhs.entry_->pool_ == rhs.entry_->pool_) {
+                return false;
+            }
+            // handles of different pools, e.g. a changelog and its decoded copy
+            return lhs.entry_->text_ == rhs.entry_->text_;
+        }
+
+        friend bool operator!=(const InternedString &lhs, const InternedString &rhs) {
+            return !(lhs == rhs);
+        }
+
+    private:
+        friend class StringPool;
+
+        struct Entry {
+            std::string_view text_;
+            std::string_view json_;
+            /**
+             * @brief Identity of the pool, stable when the pool is moved
+             */
+            const void *pool_;
+        };
+
+        explicit InternedString(const Entry *entry) : entry_(entry) {
+        }
+
+        const Entry *entry_ = nullptr;
+    };
+
+    /**
+     * @brief Stores each distinct string once, for the names that recur across a changelog (tracks, chipsets,
+     * assets, maps).
+     * @details Strings are bump-allocated from the upstream resource and live as long as the pool. Moving the pool
+     * keeps its handles valid. Interning is not thread-safe, reading handles is.
+     */
+    class StringPool {
+    public:
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        explicit StringPool(const allocator_type &allocator = {});
+
+        ~StringPool();
+
+        StringPool(const StringPool &) = delete;
+
+        StringPool &operator=(const StringPool &) = delete;
+
+        StringPool(StringPool &&other) noexcept;
+
+        StringPool &operator=(StringPool &&other) noexcept;
+
+        /**
+         * @return The handle of the string, interned if it was not already
+         */
+        InternedString intern(std::string_view string);
+
+        /**
+         * @return The handle of this pool for a handle of any pool
+         */
+        InternedString intern(const InternedString &string);
+
+        /**
+         * @return Number of distinct strings
+         */
+        size_t size() const;
+
+    private:
+        struct Storage;
+
+        std::pmr::memory_resource *upstream_;
+        /**
+         * @brief Created on the first string, so that an unused pool does not allocate
+         */
+        std::unique_ptr<Storage> storage_;
+    };
+
+} // data
+
+#endif //CU_SUBMITTER_STRING_POOL_H
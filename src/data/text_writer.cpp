@@ -0,0 +1,66 @@
+#include "text_writer.h"
+
+#include <charconv>
+
+namespace data {
+
+    TextWriter::TextWriter() {
+        buffer_.reserve(block_size);
+    }
+
+    TextWriter::TextWriter(std::ostream &stream) : stream_(&stream) {
+        buffer_.reserve(block_size);
+    }
+
+    TextWriter::~TextWriter() {
+        flush();
+    }
+
+    TextWriter &TextWriter::operator<<(std::string_view text) {
+        buffer_.append(text);
+        written();
+        return *this;
+    }
+
+    TextWriter &TextWriter::operator<<(char c) {
+        buffer_.push_back(c);
+        written();
+        return *this;
+    }
+
+    TextWriter &TextWriter::operator<<(int number) {
+        char digits[16];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        return *this << std::string_view(digits, static_cast<size_t>(result.ptr - digits));
+    }
+
+    TextWriter &TextWriter::operator<<(unsigned int number) {
+        char digits[16];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        return *this << std::string_view(digits, static_cast<size_t>(result.ptr - digits));
+    }
+
+    TextWriter &TextWriter::id(unsigned int id) {
+        if (id < 1000) {
+            buffer_.append(id < 10 ? 3 : id < 100 ? 2 : 1, '0');
+        }
+
+        return *this << id;
+    }
+
+    void TextWriter::flush() {
+        if (!stream_ || buffer_.empty()) {
+            return;
+        }
+
+        stream_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+    void TextWriter::written() {
+        if (stream_ && buffer_.size() >= block_size) {
+            flush();
+        }
+    }
+
+} // data
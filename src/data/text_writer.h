@@ -0,0 +1,72 @@
+#ifndef CU_SUBMITTER_TEXT_WRITER_H
+#define CU_SUBMITTER_TEXT_WRITER_H
+
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace data {
+
+    /**
+     * @brief Output of the text changelog renderer.
+     * @details Appends to a single growable buffer. When writing to a stream, the buffer is handed to the
+     * stream every block_size bytes, so that rendering never holds the whole changelog in memory.
+     */
+    class TextWriter {
+    public:
+        static constexpr size_t block_size = 64 * 1024;
+
+        /**
+         * @brief Renders into memory, see str()
+         */
+        TextWriter();
+
+        /**
+         * @brief Renders into a stream. The stream must outlive the writer.
+         */
+        explicit TextWriter(std::ostream &stream);
+
+        /**
+         * @brief Flushes the buffer to the stream, if there is one
+         */
+        ~TextWriter();
+
+        TextWriter(const TextWriter &) = delete;
+
+        TextWriter &operator=(const TextWriter &) = delete;
+
+        TextWriter &operator<<(std::string_view text);
+
+        TextWriter &operator<<(char c);
+
+        TextWriter &operator<<(int number);
+
+        TextWriter &operator<<(unsigned int number);
+
+        /**
+         * @brief Writes a number as at least 4 digits, padded with zeros (see id_string)
+         */
+        TextWriter &id(unsigned int id);
+
+        /**
+         * @brief Hands the buffered text to the stream. Does nothing when rendering into memory.
+         */
+        void flush();
+
+        /**
+         * @return The rendered text, when rendering into memory
+         */
+        std::string &str() {
+            return buffer_;
+        }
+
+    private:
+        void written();
+
+        std::string buffer_;
+        std::ostream *stream_ = nullptr;
+    };
+
+} // data
+
+#endif //CU_SUBMITTER_TEXT_WRITER_H
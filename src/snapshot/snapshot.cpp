@@ -0,0 +1,252 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "../chgen/base_build.h"
+#include "../utils/error.h"
+#include "../utils/log.h"
+#include "../utils/metrics.h"
+#include "../utils/trace.h"
+#include "../utils/utils.h"
+
+namespace fs = std::filesystem;
+
+namespace snapshot {
+
+    namespace {
+
+        struct SnapshotFile {
+            fs::path from_;
+            fs::path to_;
+            uint64_t size_;
+        };
+
+        /**
+         * @brief Copies of the files handled by one thread
+         */
+        struct CloneCounts {
+            size_t reflinked_ = 0;
+            size_t hardlinked_ = 0;
+            size_t copied_ = 0;
+        };
+
+        std::string hex(uint64_t value) {
+            std::ostringstream out;
+            out << std::hex << std::setw(16) << std::setfill('0') << value;
+            return out.str();
+        }
+
+        /**
+         * @brief Removes what a failed snapshot created, leaving the folder as it was found
+         */
+        void remove_snapshot(const fs::path &snapshot_path, bool created) {
+            std::error_code ec;
+            if (created) {
+                fs::remove_all(snapshot_path, ec);
+                return;
+            }
+
+            for (const auto &entry: fs::directory_iterator(snapshot_path, ec)) {
+                fs::remove_all(entry.path(), ec);
+            }
+        }
+
+    }
+
+    void SnapshotResult::Serialize(data::Writer &writer) const {
+        writer.StartObject();
+
+        writer.String("snapshot_path");
+        data::serializeString(writer, path_);
+
+        writer.String("fingerprint");
+        data::serializeString(writer, hex(fingerprint_));
+
+        writer.String("files");
+        writer.Uint64(files_);
+
+        writer.String("bytes");
+        writer.Uint64(bytes_);
+
+        writer.String("reflinked");
+        writer.Uint64(reflinked_);
+
+        writer.String("hardlinked");
+        writer.Uint64(hardlinked_);
+
+        writer.String("copied");
+        writer.Uint64(copied_);
+
+        writer.EndObject();
+    }
+
+    std::optional<SnapshotResult> SnapshotBuilder::snapshot(const std::string &devbuild_path,
+                                                            const std::string &snapshot_path, bool hardlinks,
+                                                            size_t threads) {
+        if (devbuild_path.empty()) {
+            error("Devbuild path not defined");
+            return std::nullopt;
+        }
+        if (snapshot_path.empty()) {
+            error("Snapshot path not defined");
+            return std::nullopt;
+        }
+
+        const fs::path source = devbuild_path;
+        const fs::path destination = snapshot_path;
+
+        std::error_code ec;
+        if (!fs::is_directory(source, ec)) {
+            error("Missing folder: " + devbuild_path);
+            return std::nullopt;
+        }
+
+        bool created = false;
+        if (fs::exists(destination, ec)) {
+            if (!fs::is_directory(destination, ec) || !fs::is_empty(destination, ec)) {
+                error("The snapshot folder " + snapshot_path + " already exists and is not empty");
+                return std::nullopt;
+            }
+        } else {
+            created = fs::create_directories(destination, ec);
+            if (ec) {
+                error("Could not create " + snapshot_path + ": " + ec.message());
+                return std::nullopt;
+            }
+        }
+
+        log("Creating a snapshot of " + devbuild_path + " in " + snapshot_path + "...");
+
+        metrics::ScopedTimer snapshot_timer("snapshot", "total");
+
+        SnapshotResult result;
+        result.path_ = snapshot_path;
+
+        // the folders are created while listing, so that the files can be copied in any order
+        std::vector<SnapshotFile> files;
+        try {
+            metrics::ScopedTimer list_timer("snapshot", "list");
+
+            for (auto it = fs::recursive_directory_iterator(source); it != fs::recursive_directory_iterator(); ++it) {
+                const auto &entry = *it;
+                const fs::path relative = entry.path().lexically_relative(source);
+                const fs::path to = destination / relative;
+
+                if (it.depth() == 0 && relative == chgen::snapshot_manifest) {
+                    // the devbuild is itself a snapshot, its manifest is written again below
+                    continue;
+                }
+
+                if (entry.is_symlink()) {
+                    fs::copy_symlink(entry.path(), to);
+                    it.disable_recursion_pending();
+                } else if (entry.is_directory()) {
+                    fs::create_directory(to, entry.path());
+                } else if (entry.is_regular_file()) {
+                    files.push_back({entry.path(), to, entry.file_size()});
+                } else {
+                    debug("Skipping " + std::string(entry.path()) + ", which is not a file");
+                }
+            }
+        } catch (const fs::filesystem_error &e) {
+            error("Could not list " + devbuild_path + ": " + e.what());
+            remove_snapshot(destination, created);
+            return std::nullopt;
+        }
+
+        metrics::ScopedTimer clone_timer("snapshot", "clone");
+
+        // clones only write metadata, the threads mostly wait for the filesystem
+        auto *session = trace::Session::current();
+        std::atomic<size_t> next = 0;
+        std::atomic<bool> failed = false;
+        std::mutex error_mutex;
+        std::string error_message;
+
+        const size_t thread_count = std::max<size_t>(1, std::min(threads, files.size()));
+        std::vector<std::future<CloneCounts>> results;
+        for (size_t i = 0; i < thread_count; i++) {
+            results.push_back(std::async(std::launch::async, [&, session]() {
+                trace::Activate activate(session);
+
+                CloneCounts counts;
+                for (size_t index = next++; index < files.size() && !failed; index = next++) {
+                    const auto &file = files[index];
+                    try {
+                        switch (utils::cloneFile(file.from_, file.to_, hardlinks)) {
+                            case utils::CloneMethod::REFLINK:
+                                counts.reflinked_++;
+                                break;
+                            case utils::CloneMethod::HARDLINK:
+                                counts.hardlinked_++;
+                                break;
+                            case utils::CloneMethod::COPY:
+                                counts.copied_++;
+                                break;
+                        }
+                    } catch (const fs::filesystem_error &e) {
+                        std::lock_guard lock(error_mutex);
+                        if (!failed.exchange(true)) {
+                            error_message = e.what();
+                        }
+                    }
+                }
+                return counts;
+            }));
+        }
+
+        for (auto &thread_result: results) {
+            const auto counts = thread_result.get();
+            result.reflinked_ += counts.reflinked_;
+            result.hardlinked_ += counts.hardlinked_;
+            result.copied_ += counts.copied_;
+        }
+
+        clone_timer.stop();
+
+        if (failed) {
+            error("Could not create the snapshot: " + error_message);
+            remove_snapshot(destination, created);
+            return std::nullopt;
+        }
+
+        result.files_ = files.size();
+        for (const auto &file: files) {
+            result.bytes_ += file.size_;
+        }
+
+        metrics::ScopedTimer fingerprint_timer("snapshot", "fingerprint");
+
+        // listed like a base build, so that loading the snapshot as a base finds the same fingerprint
+        result.fingerprint_ = chgen::build_fingerprint(chgen::list_build(snapshot_path));
+
+        std::ofstream manifest(destination / fs::path(chgen::snapshot_manifest));
+        manifest << "source " << devbuild_path << "\n";
+        manifest << "fingerprint " << hex(result.fingerprint_) << "\n";
+        manifest << "created " << std::time(nullptr) << "\n";
+        manifest.close();
+        if (!manifest) {
+            error("Could not write the snapshot manifest in " + snapshot_path);
+            remove_snapshot(destination, created);
+            return std::nullopt;
+        }
+
+        fingerprint_timer.stop();
+
+        log("Snapshot created: " + std::to_string(result.files_) + " files, " + std::to_string(result.reflinked_) +
+            " cloned, " + std::to_string(result.hardlinked_) + " hard linked, " + std::to_string(result.copied_) +
+            " copied");
+
+        return result;
+    }
+
+} // snapshot
@@ -0,0 +1,57 @@
+#ifndef CU_SUBMITTER_SNAPSHOT_H
+#define CU_SUBMITTER_SNAPSHOT_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "../data/changelog.h"
+
+namespace snapshot {
+
+    /**
+     * @brief A snapshot that was created, and how its files were copied
+     */
+    struct SnapshotResult {
+        std::string path_;
+        /**
+         * @brief The fingerprint of the snapshot, recorded in its manifest
+         */
+        uint64_t fingerprint_ = 0;
+
+        size_t files_ = 0;
+        uint64_t bytes_ = 0;
+
+        size_t reflinked_ = 0;
+        size_t hardlinked_ = 0;
+        size_t copied_ = 0;
+
+        void Serialize(data::Writer &writer) const;
+    };
+
+    class SnapshotBuilder {
+    public:
+        /**
+         * @brief Makes an unmodified copy of a devbuild to scan later changes against.
+         * @details Files are cloned where the filesystem supports it, which only copies their metadata: a snapshot
+         * of a large devbuild takes seconds on btrfs or xfs. Otherwise they are hard linked if allowed, or copied.
+         * Last write times are kept, so that the scans against the snapshot skip the files that were not modified
+         * since without reading them.
+         * The fingerprint of the snapshot is recorded in its manifest; a base build loaded from the snapshot checks
+         * that none of its files changed since.
+         * @param devbuild_path The devbuild to copy
+         * @param snapshot_path The snapshot folder, which must not exist or be empty
+         * @param hardlinks Hard links files that cannot be cloned. The snapshot then shares these files with the
+         * devbuild: saving over a file of the devbuild in place also modifies the snapshot.
+         * @param threads Number of files copied at the same time
+         * @return std::nullopt if the snapshot could not be created
+         */
+        static std::optional<SnapshotResult> snapshot(const std::string &devbuild_path, const std::string &snapshot_path,
+                                                      bool hardlinks = false,
+                                                      size_t threads = std::thread::hardware_concurrency());
+    };
+
+} // snapshot
+
+#endif //CU_SUBMITTER_SNAPSHOT_H
@@ -0,0 +1,286 @@
+#include "inbox.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <future>
+#include <optional>
+
+#include "submit.h"
+#include "../utils/error.h"
+#include "../utils/log.h"
+#include "../utils/metrics.h"
+#include "../utils/trace.h"
+#include "../utils/zip.h"
+
+namespace fs = std::filesystem;
+
+namespace submit {
+
+    namespace {
+
+        template<typename Entries>
+        void add_ids(InboxSubmission &submission, const std::string &category, const Entries &entries) {
+            if (entries.empty()) {
+                return;
+            }
+
+            auto &keys = submission.touched_[category];
+            for (const auto &entry: entries) {
+                keys.push_back(data::id_string(entry.id_));
+            }
+        }
+
+        void add_assets(InboxSubmission &submission, const std::pmr::vector<data::Asset> &assets) {
+            if (assets.empty()) {
+                return;
+            }
+
+            auto &keys = submission.touched_["assets"];
+            for (const auto &asset: assets) {
+                keys.push_back(data::asset_folder(asset.category_) + "/" + std::string(asset.filename_.view()));
+            }
+        }
+
+        /**
+         * @brief Reads what a submission archive changes
+         * @return std::nullopt if the archive cannot be read
+         */
+        std::optional<InboxSubmission> read_submission(const fs::path &archive_path) {
+            trace::Span span("inbox", archive_path.filename().string());
+
+            const auto archive = utils::ZipArchive::open(archive_path);
+            if (!archive) {
+                return std::nullopt;
+            }
+
+            std::string root;
+            const auto changelog = read_submission_changelog(*archive, root);
+            if (!changelog) {
+                return std::nullopt;
+            }
+
+            InboxSubmission submission;
+            submission.archive_path_ = archive_path.string();
+            submission.developer_ = std::string(changelog->developer_);
+            submission.date_ = data::date_string(&changelog->date_);
+
+            add_ids(submission, "maps", changelog->maps_);
+            add_ids(submission, "common_events", changelog->common_events_);
+            add_ids(submission, "tilesets", changelog->tilesets_);
+            add_ids(submission, "switches", changelog->switches_);
+            add_ids(submission, "variables", changelog->variables_);
+            add_ids(submission, "animations", changelog->animations_);
+
+            add_assets(submission, changelog->menu_themes_);
+            add_assets(submission, changelog->charsets_);
+            add_assets(submission, changelog->chipsets_);
+            add_assets(submission, changelog->musics_);
+            add_assets(submission, changelog->sounds_);
+            add_assets(submission, changelog->panoramas_);
+            add_assets(submission, changelog->pictures_);
+            add_assets(submission, changelog->animation_files_);
+
+            for (auto &[category, keys]: submission.touched_) {
+                std::sort(keys.begin(), keys.end());
+                keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            }
+
+            return submission;
+        }
+
+        bool is_archive(const fs::path &path) {
+            std::string extension = path.extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+            return extension == ".zip";
+        }
+
+    }
+
+    void InboxIndex::Render(data::TextWriter &writer) const {
+        writer << "Inbox " << inbox_path_ << ": " << static_cast<unsigned int>(submissions_.size()) << " submissions, "
+               << static_cast<unsigned int>(unreadable_.size()) << " unreadable, "
+               << static_cast<unsigned int>(overlaps_.size()) << " entries changed by several submissions\n";
+
+        for (const auto &submission: submissions_) {
+            writer << '\n' << submission.archive_path_ << " (" << submission.developer_ << ", " << submission.date_
+                   << ")\n";
+            for (const auto &[category, keys]: submission.touched_) {
+                writer << "    " << category << ':';
+                for (const auto &key: keys) {
+                    writer << ' ' << key;
+                }
+                writer << '\n';
+            }
+        }
+
+        for (const auto &archive_path: unreadable_) {
+            writer << '\n' << archive_path << ": unreadable\n";
+        }
+
+        if (!overlaps_.empty()) {
+            writer << "\nOverlaps\n";
+        }
+        for (const auto &overlap: overlaps_) {
+            writer << overlap.category_ << ' ' << overlap.key_ << ':';
+            for (const size_t submission: overlap.submissions_) {
+                writer << ' ' << fs::path(submissions_[submission].archive_path_).filename().string();
+            }
+            writer << '\n';
+        }
+    }
+
+    void InboxIndex::Serialize(data::Writer &writer) const {
+        writer.StartObject();
+
+        writer.String("inbox_path");
+        data::serializeString(writer, inbox_path_);
+
+        writer.String("submissions");
+        writer.StartArray();
+        for (const auto &submission: submissions_) {
+            writer.StartObject();
+
+            writer.String("archive_path");
+            data::serializeString(writer, submission.archive_path_);
+
+            writer.String("developer");
+            data::serializeString(writer, submission.developer_);
+
+            writer.String("date");
+            data::serializeString(writer, submission.date_);
+
+            for (const auto &[category, keys]: submission.touched_) {
+                writer.String(category.c_str(), static_cast<rapidjson::SizeType>(category.size()));
+                writer.StartArray();
+                for (const auto &key: keys) {
+                    data::serializeString(writer, key);
+                }
+                writer.EndArray();
+            }
+
+            writer.EndObject();
+        }
+        writer.EndArray();
+
+        writer.String("unreadable");
+        writer.StartArray();
+        for (const auto &archive_path: unreadable_) {
+            data::serializeString(writer, archive_path);
+        }
+        writer.EndArray();
+
+        writer.String("overlaps");
+        writer.StartArray();
+        for (const auto &overlap: overlaps_) {
+            writer.StartObject();
+
+            writer.String("category");
+            data::serializeString(writer, overlap.category_);
+
+            writer.String("key");
+            data::serializeString(writer, overlap.key_);
+
+            writer.String("archive_paths");
+            writer.StartArray();
+            for (const size_t submission: overlap.submissions_) {
+                data::serializeString(writer, submissions_[submission].archive_path_);
+            }
+            writer.EndArray();
+
+            writer.EndObject();
+        }
+        writer.EndArray();
+
+        writer.EndObject();
+    }
+
+    std::shared_ptr<InboxIndex> InboxIndexer::index(const std::string &inbox_path, size_t threads) {
+        if (inbox_path.empty()) {
+            error("Inbox path not defined");
+            return nullptr;
+        }
+
+        metrics::ScopedTimer total_timer("inbox", "total");
+
+        std::vector<fs::path> archive_paths;
+        try {
+            for (const auto &entry: fs::directory_iterator(inbox_path)) {
+                if (entry.is_regular_file() && is_archive(entry.path())) {
+                    archive_paths.push_back(entry.path());
+                }
+            }
+        } catch (const fs::filesystem_error &e) {
+            error("Could not list " + inbox_path + ": " + e.what());
+            return nullptr;
+        }
+
+        std::sort(archive_paths.begin(), archive_paths.end());
+
+        log("Indexing " + std::to_string(archive_paths.size()) + " submissions in " + inbox_path + "...");
+
+        metrics::ScopedTimer read_timer("inbox", "read_archives");
+
+        // each archive costs a few small reads, the threads mostly wait for the disk
+        std::vector<std::optional<InboxSubmission>> submissions(archive_paths.size());
+        auto *session = trace::Session::current();
+        std::atomic<size_t> next = 0;
+
+        const size_t thread_count = std::max<size_t>(1, std::min(threads, archive_paths.size()));
+        std::vector<std::future<void>> results;
+        for (size_t i = 0; i < thread_count; i++) {
+            results.push_back(std::async(std::launch::async, [&, session]() {
+                trace::Activate activate(session);
+
+                for (size_t index = next++; index < archive_paths.size(); index = next++) {
+                    submissions[index] = read_submission(archive_paths[index]);
+                }
+            }));
+        }
+        for (auto &result: results) {
+            result.get();
+        }
+
+        read_timer.stop();
+
+        auto index = std::make_shared<InboxIndex>();
+        index->inbox_path_ = inbox_path;
+
+        for (size_t i = 0; i < archive_paths.size(); i++) {
+            if (submissions[i]) {
+                index->submissions_.push_back(std::move(*submissions[i]));
+            } else {
+                index->unreadable_.push_back(archive_paths[i].string());
+            }
+        }
+
+        metrics::ScopedTimer overlaps_timer("inbox", "overlaps");
+
+        std::map<std::pair<std::string, std::string>, std::vector<size_t>> touched_by;
+        for (size_t i = 0; i < index->submissions_.size(); i++) {
+            for (const auto &[category, keys]: index->submissions_[i].touched_) {
+                for (const auto &key: keys) {
+                    touched_by[{category, key}].push_back(i);
+                }
+            }
+        }
+
+        for (auto &[entry, submission_positions]: touched_by) {
+            if (submission_positions.size() > 1) {
+                index->overlaps_.push_back({entry.first, entry.second, std::move(submission_positions)});
+            }
+        }
+
+        overlaps_timer.stop();
+
+        log("Inbox indexed: " + std::to_string(index->submissions_.size()) + " submissions, " +
+            std::to_string(index->unreadable_.size()) + " unreadable, " + std::to_string(index->overlaps_.size()) +
+            " entries changed by several submissions");
+
+        return index;
+    }
+
+} // submit
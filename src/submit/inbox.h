@@ -0,0 +1,87 @@
+#ifndef CU_SUBMITTER_INBOX_H
+#define CU_SUBMITTER_INBOX_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../data/changelog.h"
+#include "../data/text_writer.h"
+
+namespace submit {
+
+    /**
+     * @brief What a pending submission archive changes
+     */
+    struct InboxSubmission {
+        std::string archive_path_;
+        std::string developer_;
+        std::string date_;
+
+        /**
+         * @brief The changed entries of each category, named as in the changelog JSON: the IDs of maps and database
+         * entries, the folder and file name of assets ("assets")
+         */
+        std::map<std::string, std::vector<std::string>> touched_;
+    };
+
+    /**
+     * @brief An entry changed by several submissions
+     */
+    struct InboxOverlap {
+        std::string category_;
+        std::string key_;
+        /**
+         * @brief Positions of the submissions in InboxIndex::submissions_
+         */
+        std::vector<size_t> submissions_;
+    };
+
+    /**
+     * @brief The entries changed by every submission archive of a folder, and the ones changed by several of them
+     */
+    struct InboxIndex {
+        std::string inbox_path_;
+
+        /**
+         * @brief The readable submissions, by archive name
+         */
+        std::vector<InboxSubmission> submissions_;
+
+        /**
+         * @brief Archives that are not ZIP archives or have no binary changelog
+         */
+        std::vector<std::string> unreadable_;
+
+        /**
+         * @brief Every entry changed by more than one submission, by category and key
+         */
+        std::vector<InboxOverlap> overlaps_;
+
+        /**
+         * @brief Writes what each submission changes, then every overlap
+         */
+        void Render(data::TextWriter &writer) const;
+
+        void Serialize(data::Writer &writer) const;
+    };
+
+    class InboxIndexer {
+    public:
+        /**
+         * @brief Indexes every submission archive (*.zip) of a folder.
+         * @details Only the central directory and the binary changelog of each archive are read, archives being read
+         * in parallel: nothing is extracted or scanned.
+         * @param inbox_path The folder of the archives. Sub-folders are not searched.
+         * @param threads Number of archives read at the same time
+         * @return nullptr if the folder cannot be listed
+         */
+        static std::shared_ptr<InboxIndex> index(const std::string &inbox_path,
+                                                 size_t threads = std::thread::hardware_concurrency());
+    };
+
+} // submit
+
+#endif //CU_SUBMITTER_INBOX_H
@@ -1,7 +1,131 @@
 #include "submit.h"
 
+#include <algorithm>
+#include <limits>
+
+#include "../chgen/map_index.h"
+#include "../data/changelog_binary.h"
+#include "../utils/dirscan.h"
+#include "../utils/metrics.h"
+#include "../utils/trace.h"
+#include "../utils/utils.h"
+
 namespace submit {
 
+    namespace {
+
+        /**
+         * @return True if an asset file name of a changelog names a file of its asset folder, and nothing outside it
+         */
+        bool is_plain_filename(std::string_view filename) {
+            if (filename.empty() || filename == "." || filename.find("..") != std::string_view::npos) {
+                return false;
+            }
+
+            // separators of both systems, and Windows drive letters
+            return filename.find_first_of("/\\:") == std::string_view::npos && !fs::path(filename).is_absolute();
+        }
+
+        /**
+         * @return The first asset of a category whose file name is not a plain file name, nullptr if there is none
+         */
+        const data::Asset *find_unsafe_asset(const std::pmr::vector<data::Asset> &assets) {
+            for (const auto &asset: assets) {
+                if (!is_plain_filename(asset.filename_.view())) {
+                    return &asset;
+                }
+            }
+
+            return nullptr;
+        }
+
+        /**
+         * @return True if every entry of a category has an ID from 1 to max_id
+         */
+        template<typename Entries>
+        bool valid_ids(const Entries &entries, int max_id) {
+            return std::all_of(entries.begin(), entries.end(), [max_id](const auto &entry) {
+                return entry.id_ >= 1 && entry.id_ <= static_cast<unsigned int>(max_id);
+            });
+        }
+
+    }
+
+    const utils::ZipEntry *submission_changelog_entry(const utils::ZipArchive &archive) {
+        const utils::ZipEntry *found = nullptr;
+        size_t found_depth = 0;
+
+        for (const auto &entry: archive.entries()) {
+            const auto name = fs::path(entry.name_);
+            if (name.filename() != submission_changelog) {
+                continue;
+            }
+
+            // the shallowest one, in case the submission itself contains an archived submission
+            const size_t depth = std::count(entry.name_.begin(), entry.name_.end(), '/');
+            if (depth <= 1 && (!found || depth < found_depth)) {
+                found = &entry;
+                found_depth = depth;
+            }
+        }
+
+        return found;
+    }
+
+    std::shared_ptr<data::Changelog> read_submission_changelog(const utils::ZipArchive &archive, std::string &root) {
+        const auto *entry = submission_changelog_entry(archive);
+        if (!entry) {
+            error("No " + std::string(submission_changelog) + " in " + archive.path().string() +
+                  ". The submission was made by an older version, extract it to scan it");
+            return nullptr;
+        }
+
+        root = entry->name_.substr(0, entry->name_.size() - submission_changelog.size());
+
+        std::string bytes;
+        try {
+            bytes = archive.read(*entry);
+        } catch (const std::exception &e) {
+            // whatever the archive holds, e.g. a changelog too large for memory, it is only unreadable
+            error(e.what());
+            return nullptr;
+        }
+
+        const auto binary = data::BinaryChangelog::view(bytes);
+        if (!binary) {
+            error("Invalid changelog in " + archive.path().string());
+            return nullptr;
+        }
+
+        auto changelog = binary->decode();
+
+        // the file names are the contributor's: one like ../../RPG_RT.ldb would be written outside its asset folder
+        for (const auto *assets: {&changelog->menu_themes_, &changelog->charsets_, &changelog->chipsets_,
+                                  &changelog->musics_, &changelog->sounds_, &changelog->panoramas_,
+                                  &changelog->pictures_, &changelog->animation_files_}) {
+            if (const auto *asset = find_unsafe_asset(*assets)) {
+                error("Invalid asset file name \"" + std::string(asset->filename_.view()) + "\" in the changelog of " +
+                      archive.path().string());
+                return nullptr;
+            }
+        }
+
+        // the IDs index the database tables; they are checked against the archived database when it is transferred
+        constexpr int max_entry_id = std::numeric_limits<int>::max();
+        const bool ids_valid = valid_ids(changelog->maps_, chgen::MapIndex::max_map_id) &&
+                               valid_ids(changelog->common_events_, max_entry_id) &&
+                               valid_ids(changelog->tilesets_, max_entry_id) &&
+                               valid_ids(changelog->switches_, max_entry_id) &&
+                               valid_ids(changelog->variables_, max_entry_id) &&
+                               valid_ids(changelog->animations_, max_entry_id);
+        if (!ids_valid) {
+            error("Invalid map or database entry ID in the changelog of " + archive.path().string());
+            return nullptr;
+        }
+
+        return changelog;
+    }
+
     std::shared_ptr<data::Changelog> SubmissionBuilder::submissionChangelog_;
 
     std::string SubmissionBuilder::base_path_;
@@ -28,48 +152,58 @@ namespace submit {
         return submissionChangelog_;
     }
 
+    std::shared_ptr<data::Changelog> SubmissionBuilder::getSubmissionChangelog(const chgen::BaseBuild& base, const std::string &modified_path) {
+        if (modified_path.empty()) {
+            error("Origin path not defined");
+            return nullptr;
+        }
+
+        base_path_ = base.path();
+        modified_path_ = modified_path;
+
+        log("Scanning differences...");
+
+        submissionChangelog_ = chgen::ChangelogGenerator::scan(base, modified_path_);
+
+        return submissionChangelog_;
+    }
+
     std::shared_ptr<data::Changelog> SubmissionBuilder::getSubmissionChangelog() {
         return submissionChangelog_;
     }
 
     void SubmissionBuilder::submitAssets(const data::AssetCategory& category) {
-        std::string folder;
-        std::vector<data::Asset> assets;
+        const std::string folder = data::asset_folder(category);
+        const std::pmr::vector<data::Asset> *assets = nullptr;
         switch (category) {
             case data::AssetCategory::MENU_THEME:
-                folder = "System";
-                assets = submissionChangelog_->menu_themes_;
+                assets = &submissionChangelog_->menu_themes_;
                 break;
             case data::AssetCategory::CHARSET:
-                folder = "CharSet";
-                assets = submissionChangelog_->charsets_;
+                assets = &submissionChangelog_->charsets_;
                 break;
             case data::AssetCategory::CHIPSET:
-                folder = "ChipSet";
-                assets = submissionChangelog_->chipsets_;
+                assets = &submissionChangelog_->chipsets_;
                 break;
             case data::AssetCategory::MUSIC:
-                folder = "Music";
-                assets = submissionChangelog_->musics_;
+                assets = &submissionChangelog_->musics_;
                 break;
             case data::AssetCategory::SOUND:
-                folder = "Sound";
-                assets = submissionChangelog_->sounds_;
+                assets = &submissionChangelog_->sounds_;
                 break;
             case data::AssetCategory::PANORAMA:
-                folder = "Panorama";
-                assets = submissionChangelog_->panoramas_;
+                assets = &submissionChangelog_->panoramas_;
                 break;
             case data::AssetCategory::PICTURE:
-                folder = "Picture";
-                assets = submissionChangelog_->pictures_;
+                assets = &submissionChangelog_->pictures_;
                 break;
             case data::AssetCategory::BATTLE_ANIMATION:
-                folder = "Battle";
-                assets = submissionChangelog_->animation_files_;
+                assets = &submissionChangelog_->animation_files_;
                 break;
         }
 
+        trace::Span span("assets", folder);
+
         const auto base_asset_folder = std::string(modified_path_ / fs::path(folder));
         const auto destination_asset_folder = std::string(gameRoot() / fs::path(folder));
 
@@ -78,46 +212,51 @@ namespace submit {
             return;
         }
 
-        for (const auto& asset: assets) {
-            const auto origin_asset = base_asset_folder / fs::path(asset.filename_);
+        for (const auto& asset: *assets) {
+            const auto origin_asset = base_asset_folder / fs::path(asset.filename_.view());
 
             switch(asset.status_) {
             case data::Status::REMOVED:
                 break;
             case data::Status::MODIFIED:
-                log("Moving " + std::string(origin_asset) + " into " + destination_asset_folder);
+                debug("Moving " + std::string(origin_asset) + " into " + destination_asset_folder);
 
-                fs::copy(origin_asset, destination_asset_folder);
+                utils::copyFile(origin_asset, destination_asset_folder);
                 break;
             case data::Status::ADDED:
-                log("Moving " + std::string(origin_asset) + " into " + destination_asset_folder);
+                debug("Moving " + std::string(origin_asset) + " into " + destination_asset_folder);
 
-                fs::copy(origin_asset, destination_asset_folder);
+                utils::copyFile(origin_asset, destination_asset_folder);
                 break;
             }
         }
     }
 
     void SubmissionBuilder::submitMaps() {
-        auto blank_map = lcf::rpg::Map();
+        const auto modified_listing = utils::listDirectory(modified_path_);
+        const chgen::MapIndex modified_index(&modified_listing, nullptr);
 
         for (const auto& map: submissionChangelog_->maps_) {
-            const auto origin_map = base_path_ / fs::path("Map" + data::id_string(map.id_) + ".lmu");
+            const auto *modified_entry = modified_index.find(map.id_);
 
             switch(map.status_) {
             case data::Status::REMOVED:
                 break;
             case data::Status::MODIFIED:
-                log("Moving " + std::string(origin_map) + " into " + std::string(gameRoot()));
+            case data::Status::ADDED: {
+                if (!modified_entry || !modified_entry->file_) {
+                    error("Missing file: " + std::string(modified_path_ / fs::path(chgen::MapIndex::filename(map.id_))));
+                    break;
+                }
 
-                fs::copy(origin_map, gameRoot());
-                break;
-            case data::Status::ADDED:
-                log("Moving " + std::string(origin_map) + " into " +  std::string(gameRoot()));
+                const auto origin_map = modified_path_ / fs::path(modified_entry->file_->name_);
+
+                debug("Moving " + std::string(origin_map) + " into " + std::string(gameRoot()));
 
-                fs::copy(origin_map, gameRoot());
+                utils::copyFile(origin_map, gameRoot());
                 break;
             }
+            }
         }
     }
 
@@ -128,15 +267,23 @@ namespace submit {
         }
 
         try {
+            metrics::ScopedTimer total_timer("submit", "total");
+
             archive_path_ = archive_path;
             const fs::path game_root = gameRoot();
 
             fs::create_directories(game_root);
 
-            fs::copy(modified_path_ / fs::path("RPG_RT.lbd"), game_root);
-            fs::copy(modified_path_ / fs::path("RPG_RT.lmt"), game_root);
+            metrics::ScopedTimer database_timer("submit", "database");
+            utils::copyFile(modified_path_ / fs::path("RPG_RT.ldb"), game_root);
+            utils::copyFile(modified_path_ / fs::path("RPG_RT.lmt"), game_root);
+            database_timer.stop();
 
+            metrics::ScopedTimer maps_timer("submit", "maps");
             submitMaps();
+            maps_timer.stop();
+
+            metrics::ScopedTimer assets_timer("submit", "assets");
 
             submitAssets(data::AssetCategory::MENU_THEME);
             submitAssets(data::AssetCategory::CHARSET);
@@ -147,7 +294,11 @@ namespace submit {
             submitAssets(data::AssetCategory::PICTURE);
             submitAssets(data::AssetCategory::BATTLE_ANIMATION);
 
+            assets_timer.stop();
+
+            metrics::ScopedTimer export_timer("submit", "export_changelog");
             exportChangelog();
+            export_timer.stop();
 
             log("File " + archive_path + " ready for compression");
 
@@ -162,7 +313,7 @@ namespace submit {
             return;
         }
 
-        const std::string date = data::date_string(submissionChangelog_->date_);
+        const std::string date = data::date_string(&submissionChangelog_->date_);
         const std::string date_formatted = date.substr(0, 2) + date.substr(3, 3) + date.substr(7, date.length());
 
         const std::string dev_name = "NoDevName"; //TODO: replace NoDevName by actual dev name
@@ -184,6 +335,10 @@ namespace submit {
         const fs::path export_path = archive_path_;
 
         chgen::ChangelogGenerator::generate(submissionChangelog_, export_path);
+
+        if (!data::writeBinary(*submissionChangelog_, export_path / fs::path(submission_changelog))) {
+            error("Could not write " + std::string(export_path / fs::path(submission_changelog)));
+        }
     }
 
     /*void SubmissionBuilder::compress() {
@@ -2,15 +2,40 @@
 #define CU_SUBMITTER_SUBMIT_H
 
 #include <filesystem>
+#include <string_view>
 
 #include "../chgen/chgen.h"
 #include "../utils/error.h"
 #include "../utils/log.h"
+#include "../utils/zip.h"
 
 namespace fs = std::filesystem;
 
 namespace submit {
 
+    /**
+     * @brief Name of the binary changelog written at the root of every submission, next to the text one, so that
+     * the submission can be applied or indexed without scanning it
+     */
+    constexpr std::string_view submission_changelog = "changelog.cucl";
+
+    /**
+     * @brief Finds the binary changelog of a submission archive. The archive may hold the submission folder or only
+     * its content, so the changelog is searched for at its root and in its top folders.
+     * @return nullptr if the archive has no binary changelog
+     */
+    const utils::ZipEntry *submission_changelog_entry(const utils::ZipArchive &archive);
+
+    /**
+     * @brief Reads the binary changelog of a submission archive, without extracting anything else
+     * @param archive
+     * @param root Set to the folder of the changelog in the archive, "" or ending with '/'; the game files are in its
+     * data folder
+     * @return nullptr if the archive has no binary changelog, it cannot be decoded, or one of its asset file names is
+     * not a plain file name (separators, "..", absolute paths)
+     */
+    std::shared_ptr<data::Changelog> read_submission_changelog(const utils::ZipArchive &archive, std::string &root);
+
     class SubmissionBuilder {
     public:
         /**
@@ -21,6 +46,14 @@ namespace submit {
          */
         static std::shared_ptr<data::Changelog> getSubmissionChangelog(const std::string& base_path, const std::string &modified_path);
 
+        /**
+         * Scans changes against an already loaded base build. Needs to be called before a submission
+         * @param base Unmodified copy of the devbuild from the version you were working on
+         * @param modified_path The copy you modified
+         * @returns Your modifications in the format of a changelog
+         */
+        static std::shared_ptr<data::Changelog> getSubmissionChangelog(const chgen::BaseBuild& base, const std::string &modified_path);
+
         /**
          * Returns the last scanned submission changelog
          * @returns The last scanned submission changelog
@@ -39,7 +72,7 @@ namespace submit {
         static void submit();
 
         /**
-         * Exports the last scanned transfer changelog to a text file inside archive_path_
+         * Exports the last scanned submission changelog to a text file and to a binary file inside archive_path_
          */
         static void exportChangelog();
 
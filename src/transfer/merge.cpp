@@ -0,0 +1,433 @@
+#include "merge.h"
+
+#include <filesystem>
+#include <unordered_map>
+#include <lcf/ldb/reader.h>
+#include <lcf/lmt/reader.h>
+
+#include "../chgen/chgen.h"
+#include "../chgen/map_index.h"
+#include "../utils/dirscan.h"
+#include "../utils/error.h"
+#include "../utils/log.h"
+#include "../utils/metrics.h"
+#include "../utils/utils.h"
+
+namespace fs = std::filesystem;
+
+namespace transfer {
+
+    namespace {
+
+        const char *status_name(data::Status status) {
+            switch (status) {
+                case data::Status::ADDED:
+                    return "added";
+                case data::Status::REMOVED:
+                    return "removed";
+                case data::Status::MODIFIED:
+                    return "modified";
+            }
+            return "";
+        }
+
+        const char *merge_status_name(MergeStatus status) {
+            switch (status) {
+                case MergeStatus::CLEAN:
+                    return "clean";
+                case MergeStatus::ALREADY_APPLIED:
+                    return "already_applied";
+                case MergeStatus::CONFLICT:
+                    return "conflict";
+            }
+            return "";
+        }
+
+        /**
+         * @brief The origin or the destination side of a merge, whose map tree and database are only read if an
+         * entry changed on both sides needs them
+         */
+        class MergeBuild {
+        public:
+            explicit MergeBuild(std::string path) : path_(std::move(path)) {
+            }
+
+            MergeBuild(const MergeBuild &) = delete;
+
+            MergeBuild &operator=(const MergeBuild &) = delete;
+
+            const std::string &path() const {
+                return path_;
+            }
+
+            /**
+             * @return nullptr if the database cannot be read
+             */
+            const lcf::rpg::Database *database() {
+                if (!database_loaded_) {
+                    database_loaded_ = true;
+
+                    const std::string ldb_path = path_ / fs::path("RPG_RT.ldb");
+                    database_ = lcf::LDB_Reader::Load(ldb_path);
+                    if (!database_) {
+                        error("Could not read " + ldb_path);
+                    }
+                }
+                return database_.get();
+            }
+
+            /**
+             * @return nullptr if the map tree cannot be read
+             */
+            const chgen::MapIndex *mapIndex() {
+                if (!map_tree_loaded_) {
+                    map_tree_loaded_ = true;
+
+                    const std::string lmt_path = path_ / fs::path("RPG_RT.lmt");
+                    map_tree_ = lcf::LMT_Reader::Load(lmt_path);
+                    if (!map_tree_) {
+                        error("Could not read " + lmt_path);
+                        return nullptr;
+                    }
+
+                    listing_ = utils::listDirectory(path_);
+                    map_index_ = chgen::MapIndex(&listing_, map_tree_.get());
+                }
+                return map_tree_ ? &map_index_ : nullptr;
+            }
+
+        private:
+            std::string path_;
+
+            bool database_loaded_ = false;
+            std::unique_ptr<lcf::rpg::Database> database_;
+
+            bool map_tree_loaded_ = false;
+            std::unique_ptr<lcf::rpg::TreeMap> map_tree_;
+            utils::DirectoryListing listing_;
+            chgen::MapIndex map_index_;
+        };
+
+        /**
+         * @brief Compares a map of the destination with the base, without the scan.
+         * @details The scan leaves out the maps whose map tree entry did not change, so a map whose events only were
+         * edited in the destination has no entry in the destination changelog.
+         * @return How the destination changed the map, std::nullopt if it is the same as in the base
+         */
+        std::optional<data::Status> destination_map_change(const chgen::BaseBuild &base, MergeBuild &destination,
+                                                           int map_id) {
+            const auto *destination_index = destination.mapIndex();
+            if (!destination_index) {
+                // unknown, so that the change of the origin is not written over it
+                return data::Status::MODIFIED;
+            }
+
+            const auto *base_entry = base.mapIndex().find(map_id);
+            const auto *destination_entry = destination_index->find(map_id);
+            const bool base_file = base_entry && base_entry->file_;
+            const bool destination_file = destination_entry && destination_entry->file_;
+
+            if (base_file != destination_file) {
+                return destination_file ? data::Status::ADDED : data::Status::REMOVED;
+            }
+
+            const auto *base_info = base.mapIndex().info(map_id);
+            const auto *destination_info = destination_index->info(map_id);
+            if ((base_info == nullptr) != (destination_info == nullptr) ||
+                (base_info && !(*base_info == *destination_info))) {
+                return data::Status::MODIFIED;
+            }
+
+            if (!base_file) {
+                return std::nullopt;
+            }
+
+            if (base_entry->file_->size_ != destination_entry->file_->size_ ||
+                !utils::compareFiles(base.path() / fs::path(base_entry->file_->name_),
+                                     destination.path() / fs::path(destination_entry->file_->name_))) {
+                return data::Status::MODIFIED;
+            }
+
+            return std::nullopt;
+        }
+
+        std::string entry_key(const data::Asset &asset) {
+            return std::string(asset.filename_.view());
+        }
+
+        template<typename Entry>
+        std::string entry_key(const Entry &entry) {
+            return data::id_string(entry.id_);
+        }
+
+        /**
+         * @brief Tells whether the entries of a database table with an ID are the same in both builds
+         */
+        template<typename T>
+        bool same_entry(const std::vector<T> &origin, const std::vector<T> &destination, unsigned int id) {
+            return id >= 1 && id <= origin.size() && id <= destination.size() && origin[id - 1] == destination[id - 1];
+        }
+
+        /**
+         * @brief Classifies the changes of the origin in a category, and removes the ones already applied
+         * @param changes The entries of the category in the copy of the origin changelog
+         * @param same Tells whether an entry added or modified on both sides ended up the same
+         * @param destination_change How the destination changed an entry missing from its changelog, std::nullopt if
+         * the changelog is trusted
+         */
+        template<typename Entry, typename Same, typename DestinationChange>
+        void merge_category(MergeReport &report, const std::string &category, std::pmr::vector<Entry> &changes,
+                            const std::pmr::vector<Entry> &destination_changes, const Same &same,
+                            const DestinationChange &destination_change) {
+            std::unordered_map<std::string, const Entry *> destination;
+            for (const auto &entry: destination_changes) {
+                destination.emplace(entry_key(entry), &entry);
+            }
+
+            std::erase_if(changes, [&](const Entry &entry) {
+                MergeEntry merge_entry{category, entry_key(entry), entry.status_, std::nullopt, MergeStatus::CLEAN};
+
+                const auto found = destination.find(merge_entry.key_);
+                merge_entry.destination_status_ = found != destination.end()
+                                                  ? std::optional<data::Status>(found->second->status_)
+                                                  : destination_change(entry);
+
+                if (merge_entry.destination_status_) {
+                    const auto destination_status = *merge_entry.destination_status_;
+
+                    if (entry.status_ == data::Status::REMOVED || destination_status == data::Status::REMOVED) {
+                        merge_entry.status_ = entry.status_ == destination_status ? MergeStatus::ALREADY_APPLIED
+                                                                                  : MergeStatus::CONFLICT;
+                    } else {
+                        merge_entry.status_ = same(entry) ? MergeStatus::ALREADY_APPLIED : MergeStatus::CONFLICT;
+                    }
+                }
+
+                report.entries_.push_back(std::move(merge_entry));
+                return report.entries_.back().status_ == MergeStatus::ALREADY_APPLIED;
+            });
+        }
+
+        template<typename Entry, typename Same>
+        void merge_category(MergeReport &report, const std::string &category, std::pmr::vector<Entry> &changes,
+                            const std::pmr::vector<Entry> &destination_changes, const Same &same) {
+            merge_category(report, category, changes, destination_changes, same, [](const Entry &) {
+                return std::optional<data::Status>();
+            });
+        }
+
+    }
+
+    size_t MergeReport::count(MergeStatus status) const {
+        size_t count = 0;
+        for (const auto &entry: entries_) {
+            if (entry.status_ == status) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    void MergeReport::Render(data::TextWriter &writer) const {
+        writer << "Merge into " << destination_path_ << ": "
+               << static_cast<unsigned int>(count(MergeStatus::CLEAN)) << " clean, "
+               << static_cast<unsigned int>(count(MergeStatus::ALREADY_APPLIED)) << " already applied, "
+               << static_cast<unsigned int>(count(MergeStatus::CONFLICT)) << " conflicting\n";
+
+        for (const auto &entry: entries_) {
+            if (entry.status_ == MergeStatus::CLEAN) {
+                continue;
+            }
+
+            writer << (entry.status_ == MergeStatus::CONFLICT ? "CONFLICT " : "already applied ")
+                   << entry.category_ << ' ' << entry.key_ << " (" << status_name(entry.origin_status_)
+                   << " in origin, " << status_name(*entry.destination_status_) << " in destination)\n";
+        }
+    }
+
+    void MergeReport::Serialize(data::Writer &writer) const {
+        writer.StartObject();
+
+        writer.String("destination_path");
+        data::serializeString(writer, destination_path_);
+
+        writer.String("clean");
+        writer.Uint64(count(MergeStatus::CLEAN));
+
+        writer.String("already_applied");
+        writer.Uint64(count(MergeStatus::ALREADY_APPLIED));
+
+        writer.String("conflicts");
+        writer.Uint64(count(MergeStatus::CONFLICT));
+
+        writer.String("entries");
+        writer.StartArray();
+        for (const auto &entry: entries_) {
+            writer.StartObject();
+
+            writer.String("category");
+            data::serializeString(writer, entry.category_);
+
+            writer.String("key");
+            data::serializeString(writer, entry.key_);
+
+            writer.String("origin_status");
+            writer.String(status_name(entry.origin_status_));
+
+            writer.String("destination_status");
+            if (entry.destination_status_) {
+                writer.String(status_name(*entry.destination_status_));
+            } else {
+                writer.Null();
+            }
+
+            writer.String("merge");
+            writer.String(merge_status_name(entry.status_));
+
+            writer.EndObject();
+        }
+        writer.EndArray();
+
+        writer.EndObject();
+    }
+
+    std::shared_ptr<MergeReport> ThreeWayMerge::merge(const chgen::BaseBuild &base, const std::string &origin_path,
+                                                      const std::string &destination_path) {
+        const auto reports = merge(base, origin_path, std::vector<std::string>{destination_path});
+        return reports.empty() ? nullptr : reports.front();
+    }
+
+    std::vector<std::shared_ptr<MergeReport>>
+    ThreeWayMerge::merge(const chgen::BaseBuild &base, const std::string &origin_path,
+                         const std::vector<std::string> &destination_paths) {
+        metrics::ScopedTimer scan_timer("merge", "scan");
+
+        // every diff in parallel, sharing the parsed base and the base maps any of them parses
+        std::vector<std::string> paths = {origin_path};
+        paths.insert(paths.end(), destination_paths.begin(), destination_paths.end());
+
+        const auto changelogs = chgen::ChangelogGenerator::scanBatch(base, paths, paths.size());
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (!changelogs[i]) {
+                error("Could not scan " + paths[i]);
+                return {};
+            }
+        }
+
+        scan_timer.stop();
+
+        metrics::ScopedTimer compare_timer("merge", "compare");
+
+        // read once for the comparisons with every destination
+        MergeBuild origin(origin_path);
+
+        std::vector<std::shared_ptr<MergeReport>> reports;
+        for (size_t i = 0; i < destination_paths.size(); i++) {
+            const auto &destination_path = destination_paths[i];
+
+            auto report = std::make_shared<MergeReport>();
+            report->destination_path_ = destination_path;
+            report->origin_changelog_ = changelogs[0];
+            report->destination_changelog_ = changelogs[i + 1];
+            report->changes_ = std::make_shared<data::Changelog>(*changelogs[0]);
+
+            auto &changes = *report->changes_;
+            const auto &destination_changes = *changelogs[i + 1];
+
+            MergeBuild destination(destination_path);
+
+            merge_category(*report, "maps", changes.maps_, destination_changes.maps_, [&](const data::Map &map) {
+                const auto *origin_index = origin.mapIndex();
+                const auto *destination_index = destination.mapIndex();
+                if (!origin_index || !destination_index) {
+                    return false;
+                }
+
+                const auto *origin_info = origin_index->info(static_cast<int>(map.id_));
+                const auto *destination_info = destination_index->info(static_cast<int>(map.id_));
+                if (!origin_info || !destination_info || !(*origin_info == *destination_info)) {
+                    return false;
+                }
+
+                const auto *origin_entry = origin_index->find(static_cast<int>(map.id_));
+                const auto *destination_entry = destination_index->find(static_cast<int>(map.id_));
+                if (!origin_entry || !origin_entry->file_ || !destination_entry || !destination_entry->file_) {
+                    return false;
+                }
+
+                return utils::compareFiles(origin.path() / fs::path(origin_entry->file_->name_),
+                                           destination.path() / fs::path(destination_entry->file_->name_));
+            }, [&](const data::Map &map) {
+                // whatever the destination scan left out, a map the destination changed is never written over
+                return destination_map_change(base, destination, static_cast<int>(map.id_));
+            });
+
+            // the database is only read if an entry changed on both sides
+            const auto same_in_database = [&](const auto &table, unsigned int id) {
+                const auto *origin_database = origin.database();
+                const auto *destination_database = destination.database();
+                return origin_database && destination_database &&
+                       same_entry(table(*origin_database), table(*destination_database), id);
+            };
+
+            merge_category(*report, "common_events", changes.common_events_, destination_changes.common_events_,
+                           [&](const data::CommonEvent &entry) {
+                               return same_in_database([](const lcf::rpg::Database &database) -> const auto & {
+                                   return database.commonevents;
+                               }, entry.id_);
+                           });
+
+            merge_category(*report, "tilesets", changes.tilesets_, destination_changes.tilesets_,
+                           [&](const data::TilesetInfo &entry) {
+                               return same_in_database([](const lcf::rpg::Database &database) -> const auto & {
+                                   return database.chipsets;
+                               }, entry.id_);
+                           });
+
+            merge_category(*report, "switches", changes.switches_, destination_changes.switches_,
+                           [&](const data::Switch &entry) {
+                               return same_in_database([](const lcf::rpg::Database &database) -> const auto & {
+                                   return database.switches;
+                               }, entry.id_);
+                           });
+
+            merge_category(*report, "variables", changes.variables_, destination_changes.variables_,
+                           [&](const data::Variable &entry) {
+                               return same_in_database([](const lcf::rpg::Database &database) -> const auto & {
+                                   return database.variables;
+                               }, entry.id_);
+                           });
+
+            merge_category(*report, "animations", changes.animations_, destination_changes.animations_,
+                           [&](const data::Animation &entry) {
+                               return same_in_database([](const lcf::rpg::Database &database) -> const auto & {
+                                   return database.animations;
+                               }, entry.id_);
+                           });
+
+            const auto same_file = [&](const data::Asset &asset) {
+                const fs::path file = data::asset_folder(asset.category_) / fs::path(asset.filename_.view());
+                return utils::compareFiles(origin.path() / file, destination.path() / file);
+            };
+
+            merge_category(*report, "menu_themes", changes.menu_themes_, destination_changes.menu_themes_, same_file);
+            merge_category(*report, "charsets", changes.charsets_, destination_changes.charsets_, same_file);
+            merge_category(*report, "chipsets", changes.chipsets_, destination_changes.chipsets_, same_file);
+            merge_category(*report, "musics", changes.musics_, destination_changes.musics_, same_file);
+            merge_category(*report, "sounds", changes.sounds_, destination_changes.sounds_, same_file);
+            merge_category(*report, "panoramas", changes.panoramas_, destination_changes.panoramas_, same_file);
+            merge_category(*report, "pictures", changes.pictures_, destination_changes.pictures_, same_file);
+            merge_category(*report, "animation_files", changes.animation_files_, destination_changes.animation_files_,
+                           same_file);
+
+            log("Merge into " + destination_path + ": " + std::to_string(report->count(MergeStatus::CLEAN)) + " clean, " +
+                std::to_string(report->count(MergeStatus::ALREADY_APPLIED)) + " already applied, " +
+                std::to_string(report->count(MergeStatus::CONFLICT)) + " conflicting");
+
+            reports.push_back(std::move(report));
+        }
+
+        return reports;
+    }
+
+} // transfer
@@ -0,0 +1,118 @@
+#ifndef CU_SUBMITTER_MERGE_H
+#define CU_SUBMITTER_MERGE_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../chgen/base_build.h"
+#include "../data/changelog.h"
+
+namespace transfer {
+
+    /**
+     * @brief How a change of the origin build relates to the destination build
+     * @details CLEAN: the destination did not change the entry since the base, the change can be written.
+     * ALREADY_APPLIED: the destination made the same change, there is nothing to write.
+     * CONFLICT: the destination changed the entry differently, writing the change would lose its work.
+     */
+    enum class MergeStatus {
+        CLEAN,
+        ALREADY_APPLIED,
+        CONFLICT
+    };
+
+    /**
+     * @brief An entry changed by the origin build
+     */
+    struct MergeEntry {
+        /**
+         * @brief The category of the entry, named as in the changelog JSON
+         */
+        std::string category_;
+        /**
+         * @brief The ID of maps and database entries, the file name of assets
+         */
+        std::string key_;
+        data::Status origin_status_;
+        /**
+         * @brief How the destination changed the entry, std::nullopt if it did not
+         */
+        std::optional<data::Status> destination_status_;
+        MergeStatus status_;
+    };
+
+    /**
+     * @brief Result of a three-way merge between a base build, the origin build changed from it and the destination
+     * build the changes are transferred to
+     */
+    struct MergeReport {
+        std::string destination_path_;
+
+        /**
+         * @brief Every entry changed by the origin, in changelog order
+         */
+        std::vector<MergeEntry> entries_;
+
+        /**
+         * @brief The changes of the origin that are still to be written: the origin changelog without the entries
+         * already applied to the destination
+         */
+        std::shared_ptr<data::Changelog> changes_;
+
+        /**
+         * @brief Every change of the origin since the base, the same for the reports of every destination
+         */
+        std::shared_ptr<data::Changelog> origin_changelog_;
+
+        /**
+         * @brief The changes of the destination since the base
+         */
+        std::shared_ptr<data::Changelog> destination_changelog_;
+
+        size_t count(MergeStatus status) const;
+
+        bool hasConflicts() const {
+            return count(MergeStatus::CONFLICT) > 0;
+        }
+
+        /**
+         * @brief Writes the number of entries of each status and every entry that is not clean
+         */
+        void Render(data::TextWriter &writer) const;
+
+        /**
+         * @brief Writes the number of entries of each status and every entry as a JSON object
+         */
+        void Serialize(data::Writer &writer) const;
+    };
+
+    class ThreeWayMerge {
+    public:
+        /**
+         * @brief Scans the changes of the origin and of the destination against the same base, and classifies every
+         * change of the origin.
+         * @details Both builds are scanned in parallel against the loaded base, so that its map tree, database and
+         * maps are parsed once for both diffs. Entries changed on both sides are compared between the origin and the
+         * destination: database entries field by field, maps and assets byte by byte. The scan leaves out the maps
+         * whose map tree entry did not change, so every map changed by the origin is also compared between the base
+         * and the destination directly. Nothing is written.
+         * @return nullptr if one of the builds could not be scanned
+         */
+        static std::shared_ptr<MergeReport> merge(const chgen::BaseBuild &base, const std::string &origin_path,
+                                                  const std::string &destination_path);
+
+        /**
+         * @brief Merges the origin with several destinations at once
+         * @details The origin is scanned once, in parallel with every destination, and its entries are read once
+         * for the comparisons with every destination.
+         * @return One report per destination, in the same order; empty if one of the builds could not be scanned
+         */
+        static std::vector<std::shared_ptr<MergeReport>> merge(const chgen::BaseBuild &base, const std::string &origin_path,
+                                                               const std::vector<std::string> &destination_paths);
+    };
+
+} // transfer
+
+#endif //CU_SUBMITTER_MERGE_H
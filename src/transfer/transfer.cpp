@@ -1,18 +1,121 @@
 #include "transfer.h"
 
+#include <algorithm>
+#include <future>
+#include <set>
+#include <sstream>
+
+#include "../submit/submit.h"
+#include "../utils/dirscan.h"
+#include "../utils/metrics.h"
+#include "../utils/trace.h"
+#include "../utils/utils.h"
+
 namespace transfer {
 
+    namespace {
+
+        /**
+         * @brief Loads the map tree or the database of the origin, from its folder or from the submission archive
+         * @return nullptr if the file is missing or cannot be read
+         */
+        template<typename Reader>
+        auto load_origin_file(const std::string &origin_path, const utils::ZipArchive *archive,
+                              const std::string &archive_root, const std::string &filename) {
+            if (!archive) {
+                return Reader::Load(std::string(origin_path / fs::path(filename)));
+            }
+
+            const std::string name = archive_root + "data/" + filename;
+            const auto *entry = archive->find(name);
+            if (!entry) {
+                error("Missing file: " + origin_path + ":" + name);
+                return decltype(Reader::Load(std::string()))();
+            }
+
+            try {
+                std::istringstream stream(archive->read(*entry));
+                return Reader::Load(stream);
+            } catch (const std::runtime_error &e) {
+                error(e.what());
+                return decltype(Reader::Load(std::string()))();
+            }
+        }
+
+        /**
+         * @brief Checks that every entry of a category exists in the origin database, so that its IDs can index it
+         * @param category Name of the category, for the error message
+         */
+        template<typename Entries, typename Table>
+        bool in_origin_table(const Entries &entries, const Table &table, const std::string &category) {
+            for (const auto &entry: entries) {
+                if (entry.id_ < 1 || static_cast<size_t>(entry.id_) > table.size()) {
+                    error(category + ": " + data::id_string(entry.id_) + " is not in the origin database, which has " +
+                          std::to_string(table.size()) + " entries");
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * @return The assets of a category of a changelog
+         */
+        const std::pmr::vector<data::Asset> &category_assets(const data::Changelog &changelog,
+                                                             data::AssetCategory category) {
+            switch (category) {
+                case data::AssetCategory::MENU_THEME:
+                    return changelog.menu_themes_;
+                case data::AssetCategory::CHARSET:
+                    return changelog.charsets_;
+                case data::AssetCategory::CHIPSET:
+                    return changelog.chipsets_;
+                case data::AssetCategory::MUSIC:
+                    return changelog.musics_;
+                case data::AssetCategory::SOUND:
+                    return changelog.sounds_;
+                case data::AssetCategory::PANORAMA:
+                    return changelog.panoramas_;
+                case data::AssetCategory::PICTURE:
+                    return changelog.pictures_;
+                case data::AssetCategory::BATTLE_ANIMATION:
+                    break;
+            }
+
+            return changelog.animation_files_;
+        }
+
+        /**
+         * @brief Returns the entry of a destination database table, appending blank entries first if the table is
+         * shorter than the ID, like an entry added to the origin after raising its maximum
+         */
+        template<typename Entry>
+        Entry &destination_entry(std::vector<Entry> &table, int id, Entry blank) {
+            while (table.size() < static_cast<size_t>(id)) {
+                blank.ID = static_cast<int>(table.size()) + 1;
+                table.push_back(blank);
+            }
+
+            return table[id - 1];
+        }
+
+    }
+
     std::shared_ptr<data::Changelog> DevbuildTransferer::transferChangelog_;
+    std::vector<std::shared_ptr<MergeReport>> DevbuildTransferer::mergeReports_;
 
-    std::unique_ptr<lcf::rpg::Database> DevbuildTransferer::origin_db_;
-    std::unique_ptr<lcf::rpg::Database> DevbuildTransferer::destination_db_;
+    std::unique_ptr<utils::ZipArchive> DevbuildTransferer::origin_archive_;
+    std::string DevbuildTransferer::origin_archive_root_;
 
+    std::unique_ptr<lcf::rpg::Database> DevbuildTransferer::origin_db_;
     std::unique_ptr<lcf::rpg::TreeMap> DevbuildTransferer::origin_maptree_;
-    std::unique_ptr<lcf::rpg::TreeMap> DevbuildTransferer::destination_maptree_;
+    chgen::MapIndex DevbuildTransferer::origin_map_index_;
+
+    std::vector<DevbuildTransferer::Destination> DevbuildTransferer::destinations_;
 
     std::string DevbuildTransferer::base_path_;
     std::string DevbuildTransferer::origin_path_;
-    std::string DevbuildTransferer::destination_path_;
 
     std::shared_ptr<data::Changelog> DevbuildTransferer::getTransferChangelog(const std::string& base_path, const std::string &modified_path) {
         if (base_path.empty()) {
@@ -30,115 +133,260 @@ namespace transfer {
         log("Scanning differences...");
 
         transferChangelog_ = chgen::ChangelogGenerator::scan(base_path_, origin_path_);
-        
+        mergeReports_.clear();
+        origin_archive_.reset();
+
         return transferChangelog_;
     }
 
+    std::shared_ptr<data::Changelog> DevbuildTransferer::getTransferChangelog(const chgen::BaseBuild& base, const std::string &modified_path) {
+        if (modified_path.empty()) {
+            error("Origin path not defined");
+            return nullptr;
+        }
+
+        base_path_ = base.path();
+        origin_path_ = modified_path;
+
+        log("Scanning differences...");
+
+        transferChangelog_ = chgen::ChangelogGenerator::scan(base, origin_path_);
+        mergeReports_.clear();
+        origin_archive_.reset();
+
+        return transferChangelog_;
+    }
+
+    std::shared_ptr<data::Changelog> DevbuildTransferer::getArchiveChangelog(const std::string& archive_path) {
+        if (archive_path.empty()) {
+            error("Archive path not defined");
+            return nullptr;
+        }
+
+        metrics::ScopedTimer read_timer("transfer", "read_archive");
+
+        transferChangelog_ = nullptr;
+        mergeReports_.clear();
+
+        origin_archive_ = utils::ZipArchive::open(archive_path);
+        if (!origin_archive_) {
+            return nullptr;
+        }
+
+        transferChangelog_ = submit::read_submission_changelog(*origin_archive_, origin_archive_root_);
+        if (!transferChangelog_) {
+            origin_archive_.reset();
+            return nullptr;
+        }
+
+        // the submission replaces both the unmodified and the modified copies
+        base_path_ = archive_path;
+        origin_path_ = archive_path;
+
+        return transferChangelog_;
+    }
+
+    std::shared_ptr<MergeReport> DevbuildTransferer::getMergeReport(const chgen::BaseBuild& base, const std::string &origin_path,
+                                                                    const std::string &destination_path) {
+        const auto reports = getMergeReports(base, origin_path, {destination_path});
+        return reports.empty() ? nullptr : reports.front();
+    }
+
+    std::vector<std::shared_ptr<MergeReport>> DevbuildTransferer::getMergeReports(const chgen::BaseBuild& base, const std::string &origin_path,
+                                                                                  const std::vector<std::string> &destination_paths) {
+        if (origin_path.empty()) {
+            error("Origin path not defined");
+            return {};
+        }
+        if (destination_paths.empty() || std::find(destination_paths.begin(), destination_paths.end(), "") != destination_paths.end()) {
+            error("Destination path not defined");
+            return {};
+        }
+
+        base_path_ = base.path();
+        origin_path_ = origin_path;
+
+        log("Scanning differences...");
+
+        mergeReports_ = ThreeWayMerge::merge(base, origin_path_, destination_paths);
+        origin_archive_.reset();
+
+        if (mergeReports_.empty()) {
+            transferChangelog_ = nullptr;
+        } else if (mergeReports_.size() == 1) {
+            transferChangelog_ = mergeReports_.front()->changes_;
+        } else {
+            // the devbuilds may have applied different entries; writing one again to a devbuild that has it changes nothing
+            transferChangelog_ = mergeReports_.front()->origin_changelog_;
+        }
+
+        return mergeReports_;
+    }
+
+    std::shared_ptr<MergeReport> DevbuildTransferer::getMergeReport() {
+        return mergeReports_.empty() ? nullptr : mergeReports_.front();
+    }
+
+    const std::vector<std::shared_ptr<MergeReport>>& DevbuildTransferer::getMergeReports() {
+        return mergeReports_;
+    }
+
     std::shared_ptr<data::Changelog> DevbuildTransferer::getTransferChangelog() {
         return transferChangelog_;
     }
 
-    void DevbuildTransferer::transferAssets(const data::AssetCategory& category) {
-        std::string folder;
-        std::vector<data::Asset> assets;
-        switch (category) {
-            case data::AssetCategory::MENU_THEME:
-                folder = "System";
-                assets = transferChangelog_->menu_themes_;
-                break;
-            case data::AssetCategory::CHARSET:
-                folder = "CharSet";
-                assets = transferChangelog_->charsets_;
-                break;
-            case data::AssetCategory::CHIPSET:
-                folder = "ChipSet";
-                assets = transferChangelog_->chipsets_;
-                break;
-            case data::AssetCategory::MUSIC:
-                folder = "Music";
-                assets = transferChangelog_->musics_;
-                break;
-            case data::AssetCategory::SOUND:
-                folder = "Sound";
-                assets = transferChangelog_->sounds_;
-                break;
-            case data::AssetCategory::PANORAMA:
-                folder = "Panorama";
-                assets = transferChangelog_->panoramas_;
-                break;
-            case data::AssetCategory::PICTURE:
-                folder = "Picture";
-                assets = transferChangelog_->pictures_;
-                break;
-            case data::AssetCategory::BATTLE_ANIMATION:
-                folder = "Battle";
-                assets = transferChangelog_->animation_files_;
-                break;
+    bool DevbuildTransferer::forEachDestination(const std::function<bool(Destination&)>& function) {
+        auto *session = trace::Session::current();
+
+        std::vector<std::future<bool>> results;
+        for (auto &destination: destinations_) {
+            results.push_back(std::async(std::launch::async, [&function, &destination, session]() {
+                trace::Activate activate(session);
+                return function(destination);
+            }));
         }
 
+        bool succeeded = true;
+        for (auto &result: results) {
+            succeeded = result.get() && succeeded;
+        }
+        return succeeded;
+    }
+
+    void DevbuildTransferer::transferAssets(const data::AssetCategory& category) {
+        const std::string folder = data::asset_folder(category);
+        const auto *assets = &category_assets(*transferChangelog_, category);
+
+        trace::Span span("assets", folder);
+
         const auto origin_asset_folder = std::string(origin_path_ / fs::path(folder));
-        const auto destination_asset_folder = std::string(destination_path_ / fs::path(folder));
 
-        if (!fs::exists(destination_asset_folder)) {
-            error("Missing file: " + destination_asset_folder);
+        std::vector<fs::path> destination_asset_folders;
+        for (const auto &destination: destinations_) {
+            const auto destination_asset_folder = destination.path_ / fs::path(folder);
+
+            if (!fs::exists(destination_asset_folder)) {
+                error("Missing file: " + std::string(destination_asset_folder));
+                continue;
+            }
+            destination_asset_folders.push_back(destination_asset_folder);
+        }
+
+        if (destination_asset_folders.empty()) {
             return;
         }
 
-        for (const auto& asset: assets) {
-            const auto origin_asset = origin_asset_folder / fs::path(asset.filename_);
-            const auto destination_asset = destination_asset_folder / fs::path(asset.filename_);
+        std::vector<fs::path> destination_assets(destination_asset_folders.size());
+
+        for (const auto& asset: *assets) {
+            const auto origin_asset = origin_asset_folder / fs::path(asset.filename_.view());
+            for (size_t i = 0; i < destination_asset_folders.size(); i++) {
+                destination_assets[i] = destination_asset_folders[i] / fs::path(asset.filename_.view());
+            }
 
             switch(asset.status_) {
             case data::Status::REMOVED:
-                log("Removing " + std::string(destination_asset));
+                for (const auto &destination_asset: destination_assets) {
+                    debug("Removing " + std::string(destination_asset));
 
-                fs::remove(destination_asset);
+                    fs::remove(destination_asset);
+                }
                 break;
             case data::Status::MODIFIED:
-                log("Updating " + std::string(destination_asset));
-
-                fs::copy(origin_asset, destination_asset, fs::copy_options::overwrite_existing);
-                break;
             case data::Status::ADDED:
-                log("Adding " + std::string(destination_asset));
+                if (origin_archive_) {
+                    const std::string name = origin_archive_root_ + "data/" + folder + "/" + std::string(asset.filename_.view());
+                    const auto *entry = origin_archive_->find(name);
+                    if (!entry) {
+                        error("Missing file: " + origin_path_ + ":" + name);
+                        break;
+                    }
+
+                    debug((asset.status_ == data::Status::ADDED ? "Adding " : "Updating ") + name + " to " +
+                          std::to_string(destination_assets.size()) + " destinations");
+
+                    // inflated once, written to every destination
+                    origin_archive_->extract(*entry, destination_assets);
+                    break;
+                }
 
-                fs::copy(origin_asset, destination_asset, fs::copy_options::overwrite_existing);
+                debug((asset.status_ == data::Status::ADDED ? "Adding " : "Updating ") + std::string(origin_asset) +
+                      " to " + std::to_string(destination_assets.size()) + " destinations");
+
+                // read once, written to every destination
+                utils::copyFileToMany(origin_asset, destination_assets);
                 break;
             }
         }
+
+        if (!assets->empty()) {
+            log(folder + ": " + std::to_string(assets->size()) + " files transferred");
+        }
     }
 
     void DevbuildTransferer::transferMaps() {
         auto blank_map = lcf::rpg::Map();
 
+        std::vector<fs::path> destination_maps(destinations_.size());
+
         for (const auto& map: transferChangelog_->maps_) {
-            const auto origin_map = origin_path_ / fs::path("Map" + data::id_string(map.id_) + ".lmu");
-            const auto destination_map = destination_path_ / fs::path("Map" + data::id_string(map.id_) + ".lmu");
+            for (size_t i = 0; i < destinations_.size(); i++) {
+                destination_maps[i] = destinations_[i].path_ / fs::path(chgen::MapIndex::filename(map.id_));
+            }
 
             switch(map.status_) {
             case data::Status::REMOVED:
-                log("Removing " + std::string(destination_map));
+                for (const auto &destination_map: destination_maps) {
+                    debug("Removing " + std::string(destination_map));
 
-                //Reset to blank map
-                if (!lcf::LMU_Reader::Save(lcf::ToStringView(std::string(destination_map)), blank_map, lcf::EngineVersion::e2k3)) {
-                    error("Could not reset " + std::string(destination_map));
+                    //Reset to blank map
+                    if (!lcf::LMU_Reader::Save(lcf::ToStringView(std::string(destination_map)), blank_map, lcf::EngineVersion::e2k3)) {
+                        error("Could not reset " + std::string(destination_map));
+                    }
                 }
                 break;
             case data::Status::MODIFIED:
-                log("Updating " + std::string(destination_map));
+            case data::Status::ADDED: {
+                if (origin_archive_) {
+                    const std::string name = origin_archive_root_ + "data/" + chgen::MapIndex::filename(map.id_);
+                    const auto *entry = origin_archive_->find(name);
+                    if (!entry) {
+                        error("Missing file: " + origin_path_ + ":" + name);
+                        break;
+                    }
+
+                    debug((map.status_ == data::Status::ADDED ? "Adding " : "Updating ") + name + " to " +
+                          std::to_string(destination_maps.size()) + " destinations");
+
+                    origin_archive_->extract(*entry, destination_maps);
+                    break;
+                }
 
-                fs::copy(origin_map, destination_map, fs::copy_options::overwrite_existing);
-                break;
-            case data::Status::ADDED:
-                log("Adding " + std::string(destination_map));
+                const auto *origin_entry = origin_map_index_.find(map.id_);
+                if (!origin_entry || !origin_entry->file_) {
+                    error("Missing file: " + std::string(origin_path_ / fs::path(chgen::MapIndex::filename(map.id_))));
+                    break;
+                }
+
+                const auto origin_map = origin_path_ / fs::path(origin_entry->file_->name_);
 
-                fs::copy(origin_map, destination_map, fs::copy_options::overwrite_existing);
+                debug((map.status_ == data::Status::ADDED ? "Adding " : "Updating ") + std::string(origin_map) +
+                      " to " + std::to_string(destination_maps.size()) + " destinations");
+
+                utils::copyFileToMany(origin_map, destination_maps);
                 break;
             }
+            }
+        }
+
+        if (!transferChangelog_->maps_.empty()) {
+            log("Maps: " + std::to_string(transferChangelog_->maps_.size()) + " files transferred");
         }
     }
 
     void DevbuildTransferer::transferCE() {
+        trace::Span span("database", "common events");
+
         auto blank_ce = lcf::rpg::CommonEvent();
         blank_ce.trigger = lcf::rpg::CommonEvent::Trigger::Trigger_call;
 
@@ -156,23 +404,31 @@ namespace transfer {
 
                 //Reset to blank ce
                 blank_ce.ID = ce.id_;
-                destination_db_->commonevents[ce.id_ - 1] = blank_ce;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->commonevents, ce.id_, blank_ce) = blank_ce;
+                }
                 break;
             case data::Status::MODIFIED:
                 log("Updating Common Event " + data::id_string(ce.id_));
 
-                destination_db_->commonevents[ce.id_ - 1] = origin_ce;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->commonevents, ce.id_, blank_ce) = origin_ce;
+                }
                 break;
             case data::Status::ADDED:
                 log("Adding Common Event " + data::id_string(ce.id_));
 
-                destination_db_->commonevents[ce.id_ - 1] = origin_ce;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->commonevents, ce.id_, blank_ce) = origin_ce;
+                }
                 break;
             }
         }
     }
 
     void DevbuildTransferer::transferTilesets() {
+        trace::Span span("database", "tilesets");
+
         auto blank_tileset = lcf::rpg::Chipset();
 
         for (const auto& tileset: transferChangelog_->tilesets_) {
@@ -189,23 +445,31 @@ namespace transfer {
 
                 //Reset to blank tileset entry
                 blank_tileset.ID = tileset.id_;
-                destination_db_->chipsets[tileset.id_ - 1] = blank_tileset;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->chipsets, tileset.id_, blank_tileset) = blank_tileset;
+                }
                 break;
             case data::Status::MODIFIED:
                 log("Updating Tileset " + data::id_string(tileset.id_));
 
-                destination_db_->chipsets[tileset.id_ - 1] = origin_tileset;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->chipsets, tileset.id_, blank_tileset) = origin_tileset;
+                }
                 break;
             case data::Status::ADDED:
                 log("Adding Tileset " + data::id_string(tileset.id_));
 
-                destination_db_->chipsets[tileset.id_ - 1] = origin_tileset;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->chipsets, tileset.id_, blank_tileset) = origin_tileset;
+                }
                 break;
             }
         }
     }
 
     void DevbuildTransferer::transferSwitches() {
+        trace::Span span("database", "switches");
+
         auto blank_switch = lcf::rpg::Switch();
 
         for (const auto& switch_: transferChangelog_->switches_) {
@@ -222,23 +486,31 @@ namespace transfer {
 
                 //Reset to blank switch
                 blank_switch.ID = switch_.id_;
-                destination_db_->switches[switch_.id_ - 1] = blank_switch;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->switches, switch_.id_, blank_switch) = blank_switch;
+                }
                 break;
             case data::Status::MODIFIED:
                 log("Updating Switch " + data::id_string(switch_.id_));
 
-                destination_db_->switches[switch_.id_ - 1] = origin_switch;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->switches, switch_.id_, blank_switch) = origin_switch;
+                }
                 break;
             case data::Status::ADDED:
                 log("Adding Switch " + data::id_string(switch_.id_));
 
-                destination_db_->switches[switch_.id_ - 1] = origin_switch;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->switches, switch_.id_, blank_switch) = origin_switch;
+                }
                 break;
             }
         }
     }
 
     void DevbuildTransferer::transferVariables() {
+        trace::Span span("database", "variables");
+
         auto blank_variable = lcf::rpg::Variable();
 
         for (const auto& variable: transferChangelog_->variables_) {
@@ -255,26 +527,41 @@ namespace transfer {
 
                 //Reset to blank variable
                 blank_variable.ID = variable.id_;
-                destination_db_->variables[variable.id_ - 1] = blank_variable;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->variables, variable.id_, blank_variable) = blank_variable;
+                }
                 break;
             case data::Status::MODIFIED:
                 log("Updating Variable " + data::id_string(variable.id_));
 
-                destination_db_->variables[variable.id_ - 1] = origin_variable;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->variables, variable.id_, blank_variable) = origin_variable;
+                }
                 break;
             case data::Status::ADDED:
                 log("Adding Variable " + data::id_string(variable.id_));
 
-                destination_db_->variables[variable.id_ - 1] = origin_variable;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->variables, variable.id_, blank_variable) = origin_variable;
+                }
                 break;
             }
         }
     }
 
     void DevbuildTransferer::transferAnimations() {
+        trace::Span span("database", "animations");
+
         auto blank_animation = lcf::rpg::Animation();
         auto blank_anim_frame = lcf::rpg::AnimationFrame();
 
+        // a new animation has 20 blank frames, the frames vector starts empty
+        blank_animation.frames.resize(20);
+        for (int i = 0; i < 20; i++) {
+            blank_anim_frame.ID = i + 1;
+            blank_animation.frames[i] = blank_anim_frame;
+        }
+
         for (const auto& animation: transferChangelog_->animations_) {
             const auto origin_animation = origin_db_->animations[animation.id_ - 1];
 
@@ -289,38 +576,57 @@ namespace transfer {
 
                 //Reset to blank animation entry
                 blank_animation.ID = animation.id_;
-                for (int i = 0; i < 20; i++) {
-                    blank_anim_frame.ID = i + 1;
-                    blank_animation.frames[i] = blank_anim_frame;
-                }
 
-                destination_db_->animations[animation.id_ - 1] = blank_animation;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->animations, animation.id_, blank_animation) = blank_animation;
+                }
                 break;
             case data::Status::MODIFIED:
                 log("Updating Animation " + data::id_string(animation.id_));
 
-                destination_db_->animations[animation.id_ - 1] = origin_animation;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->animations, animation.id_, blank_animation) = origin_animation;
+                }
                 break;
             case data::Status::ADDED:
                 log("Adding Animation " + data::id_string(animation.id_));
 
-                destination_db_->animations[animation.id_ - 1] = origin_animation;
+                for (auto &destination: destinations_) {
+                    destination_entry(destination.database_->animations, animation.id_, blank_animation) = origin_animation;
+                }
                 break;
             }
         }
     }
 
-    void DevbuildTransferer::transferMapTree() {
+    void DevbuildTransferer::transferMapTree(Destination& destination) {
         auto blank_mapInfo = lcf::rpg::MapInfo();
 
         for (const auto& map: transferChangelog_->maps_) {
-            const auto origin_mapInfo = origin_maptree_->maps[map.id_];
+            const auto *origin_mapInfo = origin_map_index_.info(map.id_);
 
-            if (origin_mapInfo.ID != map.id_) {
-                error("Maps: IDs are not properly ordered: " + data::id_string(origin_mapInfo.ID) + " != " + data::id_string(map.id_));
+            if (!origin_mapInfo && map.status_ != data::Status::REMOVED) {
+                error("Maps: no map tree entry for " + data::id_string(map.id_) + " in the origin map tree");
                 continue;
             }
 
+            // The destination map tree may not have this ID yet, or not at index == ID
+            const auto *destination_entry = destination.map_index_.find(map.id_);
+            int position = destination_entry ? destination_entry->info_position_ : -1;
+
+            if (position < 0) {
+                if (map.status_ == data::Status::REMOVED) {
+                    continue;
+                }
+
+                blank_mapInfo.ID = map.id_;
+                destination.maptree_->maps.push_back(blank_mapInfo);
+                destination.maptree_->tree_order.push_back(map.id_);
+
+                position = static_cast<int>(destination.maptree_->maps.size()) - 1;
+                destination.map_index_.setInfoPosition(map.id_, position);
+            }
+
             switch(map.status_) {
             case data::Status::REMOVED:
                 log("Removing Map entry " + data::id_string(map.id_));
@@ -328,43 +634,143 @@ namespace transfer {
                 //Reset to blank animation entry
                 blank_mapInfo.ID = map.id_;
 
-                destination_maptree_->maps[map.id_] = blank_mapInfo;
+                destination.maptree_->maps[position] = blank_mapInfo;
                 break;
             case data::Status::MODIFIED:
                 log("Updating Map entry " + data::id_string(map.id_));
 
-                destination_maptree_->maps[map.id_] = origin_mapInfo;
+                destination.maptree_->maps[position] = *origin_mapInfo;
                 break;
             case data::Status::ADDED:
                 log("Adding Map entry " + data::id_string(map.id_));
 
-                destination_maptree_->maps[map.id_] = origin_mapInfo;
+                destination.maptree_->maps[position] = *origin_mapInfo;
                 break;
             }
         }
     }
 
-    void DevbuildTransferer::transfer(const std::string& to)
+    bool DevbuildTransferer::transfer(const std::string& to)
+    {
+        return transfer(std::vector<std::string>{to});
+    }
+
+    bool DevbuildTransferer::transfer(const std::vector<std::string>& destinations)
     {
         if (base_path_.empty()) {
             error("Base devbuild path not defined");
-            return;
+            return false;
         }
         if (origin_path_.empty()) {
             error("Origin path not defined");
-            return;
+            return false;
         }
-        if (to.empty()) {
+        if (destinations.empty() || std::find(destinations.begin(), destinations.end(), "") != destinations.end()) {
             error("Destination path not defined");
-            return;
+            return false;
         }
 
         if (!transferChangelog_) {
             error("Transfer changelog not defined. You need to scan your modifications before calling transfer.");
-            return;
+            return false;
+        }
+
+        if (!mergeReports_.empty()) {
+            const auto same_destinations = mergeReports_.size() == destinations.size() &&
+                    std::equal(destinations.begin(), destinations.end(), mergeReports_.begin(),
+                               [](const std::string &destination, const std::shared_ptr<MergeReport> &report) {
+                                   return fs::weakly_canonical(destination) == fs::weakly_canonical(report->destination_path_);
+                               });
+            if (!same_destinations) {
+                error("The modifications were not merged with these destinations");
+                return false;
+            }
+
+            for (const auto &report: mergeReports_) {
+                if (report->hasConflicts()) {
+                    error("Transfer cancelled: " + std::to_string(report->count(MergeStatus::CONFLICT)) +
+                          " entries were also changed in " + report->destination_path_ + ". Nothing was written.");
+                    return false;
+                }
+            }
+        }
+
+        destinations_.clear();
+        destinations_.resize(destinations.size());
+        for (size_t i = 0; i < destinations.size(); i++) {
+            destinations_[i].path_ = destinations[i];
+        }
+
+        metrics::ScopedTimer total_timer("transfer", "total");
+
+        // Everything is read before anything is written, so that a devbuild that cannot be read leaves every one untouched.
+        // The maps and assets of an archive are read twice: once to check them, once as they are extracted.
+        metrics::ScopedTimer map_tree_timer("transfer", "load_map_tree");
+
+        origin_maptree_ = load_origin_file<lcf::LMT_Reader>(origin_path_, origin_archive_.get(), origin_archive_root_, "RPG_RT.lmt");
+
+        if (!origin_maptree_) {
+            error("Could not read " + std::string(origin_path_ / fs::path("RPG_RT.lmt")));
+            return false;
+        }
+
+        // Built once, used by both the map file and map tree transfers. The map files of an archive are found by name.
+        const auto origin_listing = origin_archive_ ? utils::DirectoryListing() : utils::listDirectory(origin_path_);
+        origin_map_index_ = chgen::MapIndex(origin_archive_ ? nullptr : &origin_listing, origin_maptree_.get());
+
+        map_tree_timer.stop();
+
+        metrics::ScopedTimer database_timer("transfer", "load_database");
+
+        origin_db_ = load_origin_file<lcf::LDB_Reader>(origin_path_, origin_archive_.get(), origin_archive_root_, "RPG_RT.ldb");
+
+        if (!origin_db_) {
+            error("Could not read " + std::string(origin_path_ / fs::path("RPG_RT.ldb")));
+            return false;
         }
 
-        destination_path_ = to;
+        // the changelog of an archive comes from the contributor, its IDs may not match the archived database
+        const bool ids_valid = in_origin_table(transferChangelog_->common_events_, origin_db_->commonevents, "Common Events") &&
+                               in_origin_table(transferChangelog_->tilesets_, origin_db_->chipsets, "Tilesets") &&
+                               in_origin_table(transferChangelog_->switches_, origin_db_->switches, "Switches") &&
+                               in_origin_table(transferChangelog_->variables_, origin_db_->variables, "Variables") &&
+                               in_origin_table(transferChangelog_->animations_, origin_db_->animations, "Animations");
+        if (!ids_valid) {
+            error("Transfer cancelled: the changelog does not match the origin database. Nothing was written.");
+            return false;
+        }
+
+        const bool loaded = forEachDestination([](Destination &destination) {
+            destination.maptree_ = lcf::LMT_Reader::Load(std::string(destination.path_ / fs::path("RPG_RT.lmt")));
+            if (!destination.maptree_) {
+                error("Could not read " + std::string(destination.path_ / fs::path("RPG_RT.lmt")));
+                return false;
+            }
+            destination.map_index_ = chgen::MapIndex(nullptr, destination.maptree_.get());
+
+            destination.database_ = lcf::LDB_Reader::Load(std::string(destination.path_ / fs::path("RPG_RT.ldb")));
+            if (!destination.database_) {
+                error("Could not read " + std::string(destination.path_ / fs::path("RPG_RT.ldb")));
+                return false;
+            }
+            return true;
+        });
+
+        if (!loaded) {
+            return false;
+        }
+
+        database_timer.stop();
+
+        if (origin_archive_) {
+            metrics::ScopedTimer verify_timer("transfer", "verify_archive");
+            if (!verifyArchive()) {
+                error("Transfer cancelled: the archive " + origin_path_ + " is corrupted. Nothing was written.");
+                return false;
+            }
+        }
+
+        metrics::ScopedTimer assets_timer("transfer", "assets");
 
         transferAssets(data::AssetCategory::MENU_THEME);
         transferAssets(data::AssetCategory::CHARSET);
@@ -375,19 +781,13 @@ namespace transfer {
         transferAssets(data::AssetCategory::PICTURE);
         transferAssets(data::AssetCategory::BATTLE_ANIMATION);
 
-        transferMaps();
+        assets_timer.stop();
 
-        origin_db_ = lcf::LDB_Reader::Load(std::string(origin_path_ / fs::path("RPG_RT.ldb")));
-        destination_db_ = lcf::LDB_Reader::Load(std::string(destination_path_ / fs::path("RPG_RT.ldb")));
+        metrics::ScopedTimer maps_timer("transfer", "maps");
+        transferMaps();
+        maps_timer.stop();
 
-        if (!origin_db_) {
-            error("Could not read " + std::string(origin_path_ / fs::path("RPG_RT.ldb")));
-            return;
-        }
-        if (!destination_db_) {
-            error("Could not read " + std::string(destination_path_ / fs::path("RPG_RT.ldb")));
-            return;
-        }
+        metrics::ScopedTimer diff_timer("transfer", "database");
 
         transferCE();
         transferTilesets();
@@ -395,26 +795,72 @@ namespace transfer {
         transferVariables();
         transferAnimations();
 
-        // Write destination_db_ in database file
-        lcf::LDB_Reader::PrepareSave(*destination_db_);
+        diff_timer.stop();
 
-        if (!lcf::LDB_Reader::Save(lcf::ToStringView(std::string(destination_path_ / fs::path("RPG_RT.ldb"))), *destination_db_)) {
-            error("Could not write destination database");
-        }
+        // Write every destination's database and map tree
+        metrics::ScopedTimer save_timer("transfer", "save_database");
+
+        return forEachDestination([](Destination &destination) {
+            bool saved = true;
 
-        // map tree
-        origin_maptree_ = lcf::LMT_Reader::Load(std::string(origin_path_ / fs::path("RPG_RT.lmt")));
-        destination_maptree_ = lcf::LMT_Reader::Load(std::string(destination_path_ / fs::path("RPG_RT.lmt")));
+            lcf::LDB_Reader::PrepareSave(*destination.database_);
+
+            if (!lcf::LDB_Reader::Save(lcf::ToStringView(std::string(destination.path_ / fs::path("RPG_RT.ldb"))), *destination.database_)) {
+                error("Could not write destination database of " + destination.path_);
+                saved = false;
+            }
+
+            transferMapTree(destination);
+
+            if (!lcf::LMT_Reader::Save(lcf::ToStringView(std::string(destination.path_ / fs::path("RPG_RT.lmt"))), *destination.maptree_, lcf::EngineVersion::e2k3)) {
+                error("Could not write destination map tree of " + destination.path_);
+                saved = false;
+            }
+
+            return saved;
+        });
+    }
 
-        transferMapTree();
+    bool DevbuildTransferer::verifyArchive() {
+        trace::Span span("archive", "verify");
 
-        if (!lcf::LMT_Reader::Save(lcf::ToStringView(std::string(destination_path_ / fs::path("RPG_RT.lmt"))), *destination_maptree_, lcf::EngineVersion::e2k3)) {
-            error("Could not write destination map tree");
+        std::vector<const utils::ZipEntry *> entries;
+        const auto add_entry = [&entries](const std::string &name) {
+            // missing entries are reported when they are transferred
+            if (const auto *entry = origin_archive_->find(origin_archive_root_ + "data/" + name)) {
+                entries.push_back(entry);
+            }
+        };
+
+        for (const auto category: data::asset_categories()) {
+            const std::string folder = data::asset_folder(category);
+            for (const auto &asset: category_assets(*transferChangelog_, category)) {
+                if (asset.status_ != data::Status::REMOVED) {
+                    add_entry(folder + "/" + std::string(asset.filename_.view()));
+                }
+            }
+        }
+
+        for (const auto &map: transferChangelog_->maps_) {
+            if (map.status_ != data::Status::REMOVED) {
+                add_entry(chgen::MapIndex::filename(map.id_));
+            }
         }
+
+        try {
+            for (const auto *entry: entries) {
+                origin_archive_->read(*entry, [](const char *, size_t) {});
+            }
+        } catch (const std::exception &e) {
+            error(e.what());
+            return false;
+        }
+
+        return true;
     }
 
     void DevbuildTransferer::exportChangelog() {
-        if (destination_path_.empty()) {
+        if (destinations_.empty()) {
             error("Destination path not defined");
             return;
         }
@@ -423,9 +869,15 @@ namespace transfer {
             return;
         }
 
-        const fs::path export_path = destination_path_;
+        // once per folder, devbuilds are usually side by side
+        std::set<fs::path> export_paths;
+        for (const auto &destination: destinations_) {
+            export_paths.insert(fs::path(destination.path_).parent_path());
+        }
 
-        chgen::ChangelogGenerator::generate(transferChangelog_, export_path.parent_path());
+        for (const auto &export_path: export_paths) {
+            chgen::ChangelogGenerator::generate(transferChangelog_, export_path);
+        }
     }
 
 } // transfer
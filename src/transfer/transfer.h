@@ -2,10 +2,14 @@
 #define CU_SUBMITTER_TRANSFER_H
 
 #include <filesystem>
+#include <functional>
 
 #include "../chgen/chgen.h"
+#include "../chgen/map_index.h"
+#include "merge.h"
 #include "../utils/error.h"
 #include "../utils/log.h"
+#include "../utils/zip.h"
 
 namespace fs = std::filesystem;
 
@@ -20,7 +24,61 @@ namespace transfer {
          * @returns Your modifications in the format of a changelog
          */
         static std::shared_ptr<data::Changelog> getTransferChangelog(const std::string& base_path_, const std::string &origin_path);
+
+        /**
+         * Scans changes against an already loaded base build. Needs to be called before a transfer
+         * @param base Unmodified copy of the devbuild from the version you were working on
+         * @param modified_path The copy you modified
+         * @returns Your modifications in the format of a changelog
+         */
+        static std::shared_ptr<data::Changelog> getTransferChangelog(const chgen::BaseBuild& base, const std::string &origin_path);
         
+        /**
+         * Reads the changelog embedded in a submission archive. Needs to be called before transferring the submission:
+         * the transfer then reads the changed files where they are stored in the archive, without extracting it
+         * @param archive_path A ZIP archive of a submission folder
+         * @returns The modifications of the submission, nullptr if the archive has no readable changelog
+         */
+        static std::shared_ptr<data::Changelog> getArchiveChangelog(const std::string& archive_path);
+
+        /**
+         * Merges your modifications with the ones of the newest devbuild since your unmodified copy. Needs to be
+         * called before a transfer that must not override the newest devbuild's own changes.
+         * The transfer changelog becomes your modifications not yet in the newest devbuild, and the transfer is
+         * refused while there are conflicts.
+         * @param base Unmodified copy of the devbuild from the version you were working on
+         * @param origin_path The copy you modified
+         * @param destination_path Unmodified copy of the newest devbuild
+         * @returns The merge report, nullptr if one of the builds could not be scanned
+         */
+        static std::shared_ptr<MergeReport> getMergeReport(const chgen::BaseBuild& base, const std::string &origin_path,
+                                                           const std::string &destination_path);
+
+        /**
+         * Merges your modifications with the ones of several devbuilds at once, scanning your copy once. Needs to
+         * be called before a transfer to all of them.
+         * The transfer changelog becomes all your modifications: the ones already in a devbuild are written again,
+         * unchanged. The transfer is refused while any devbuild has conflicts.
+         * @param base Unmodified copy of the devbuild from the version you were working on
+         * @param origin_path The copy you modified
+         * @param destination_paths Unmodified copies of the devbuilds
+         * @returns One merge report per devbuild, empty if one of the builds could not be scanned
+         */
+        static std::vector<std::shared_ptr<MergeReport>> getMergeReports(const chgen::BaseBuild& base, const std::string &origin_path,
+                                                                         const std::vector<std::string> &destination_paths);
+
+        /**
+         * Returns the last merge report
+         * @returns The merge report of the first destination, nullptr if the last scan was not a merge
+         */
+        static std::shared_ptr<MergeReport> getMergeReport();
+
+        /**
+         * Returns the last merge reports
+         * @returns One merge report per destination, empty if the last scan was not a merge
+         */
+        static const std::vector<std::shared_ptr<MergeReport>>& getMergeReports();
+
         /**
          * Returns the last scanned transfer changelog
          * @returns The last scanned transfer's changelog
@@ -28,17 +86,42 @@ namespace transfer {
         static std::shared_ptr<data::Changelog> getTransferChangelog();
 
         /**
-         * Moves or override your changes into the newest devbuild. getTransferChangelog must be called beforehand
-         * @param to Unmodified copy of the newest devbuild
+         * Moves or override your changes into the newest devbuild. getTransferChangelog or getMergeReport must be called beforehand
+         * @param to Unmodified copy of the newest devbuild. After getMergeReport, the destination it was merged with
+         * @returns false if the transfer could not be made. Nothing is written if the merge has conflicts or was made with another destination
          */
-        static void transfer(const std::string& to);
+        static bool transfer(const std::string& to);
 
         /**
-         * Exports the last scanned transfer changelog to a text file inside destination_path_
+         * Moves or override your changes into several devbuilds at once. Every changed file of your copy is read once
+         * and written to every devbuild, and your copy's database is read once.
+         * @param destinations Unmodified copies of the devbuilds. After getMergeReports, the destinations they were merged with, in the same order
+         * @returns false if the transfer could not be made. Nothing is written if a merge has conflicts or a devbuild cannot be read
+         */
+        static bool transfer(const std::vector<std::string>& destinations);
+
+        /**
+         * Exports the last scanned transfer changelog to a text file next to every destination
          */
         static void exportChangelog();
 
     private:
+        /**
+         * A devbuild changes are transferred to
+         */
+        struct Destination {
+            std::string path_;
+            std::unique_ptr<lcf::rpg::Database> database_;
+            std::unique_ptr<lcf::rpg::TreeMap> maptree_;
+            chgen::MapIndex map_index_;
+        };
+
+        /**
+         * Runs a function for every destination, in parallel
+         * @returns false if the function failed for one of them
+         */
+        static bool forEachDestination(const std::function<bool(Destination&)>& function);
+
         /**
          * Transfers assets
          * @param category The category of the assets. Must correspond with the category of the assets in the assets vector
@@ -69,21 +152,36 @@ namespace transfer {
          */
         static void transferAnimations();
         /**
-         * Transfer map tree data
+         * Transfer map tree data into a destination's map tree
         */
-        static void transferMapTree();
+        static void transferMapTree(Destination& destination);
+        /**
+         * Reads every map and asset the changelog takes from origin_archive_ and checks its CRC-32, so that a
+         * corrupted archive is refused before any destination is written
+         * @return false if an entry cannot be read
+         */
+        static bool verifyArchive();
 
         static std::shared_ptr<data::Changelog> transferChangelog_;
+        static std::vector<std::shared_ptr<MergeReport>> mergeReports_;
 
-        static std::unique_ptr<lcf::rpg::Database> origin_db_;
-        static std::unique_ptr<lcf::rpg::Database> destination_db_;
+        /**
+         * The submission archive the changes are read from, after getArchiveChangelog
+         */
+        static std::unique_ptr<utils::ZipArchive> origin_archive_;
+        /**
+         * Folder of the submission in origin_archive_, "" or ending with '/'
+         */
+        static std::string origin_archive_root_;
 
+        static std::unique_ptr<lcf::rpg::Database> origin_db_;
         static std::unique_ptr<lcf::rpg::TreeMap> origin_maptree_;
-        static std::unique_ptr<lcf::rpg::TreeMap> destination_maptree_;
+        static chgen::MapIndex origin_map_index_;
+
+        static std::vector<Destination> destinations_;
 
         static std::string base_path_;
         static std::string origin_path_;
-        static std::string destination_path_;
     };
 
 } // transfer
@@ -0,0 +1,323 @@
+#include "compression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+#ifdef CU_SUBMITTER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace compression {
+
+    namespace {
+
+        /**
+         * @brief Size of the compressed blocks handed to the sink
+         */
+        constexpr size_t block_size = 64 * 1024;
+
+        /**
+         * @brief windowBits of zlib for a gzip header and trailer
+         */
+        constexpr int gzip_window_bits = 15 + 16;
+
+        constexpr int zstd_level = 3;
+
+        std::string_view trim(std::string_view text) {
+            while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+                text.remove_prefix(1);
+            }
+            while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+                text.remove_suffix(1);
+            }
+            return text;
+        }
+
+        bool equals_ignore_case(std::string_view lhs, std::string_view rhs) {
+            return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+            });
+        }
+
+        /**
+         * @return The q-value of an Accept-Encoding entry parameters, 1 if there is none
+         */
+        double q_value(std::string_view parameters) {
+            while (!parameters.empty()) {
+                const size_t end = parameters.find(';');
+                const auto parameter = trim(parameters.substr(0, end));
+                parameters = end == std::string_view::npos ? std::string_view() : parameters.substr(end + 1);
+
+                if (parameter.size() > 2 && (parameter[0] == 'q' || parameter[0] == 'Q') && parameter[1] == '=') {
+                    double q = 0;
+                    const auto value = parameter.substr(2);
+                    const auto result = std::from_chars(value.data(), value.data() + value.size(), q);
+                    return result.ec == std::errc() ? std::clamp(q, 0.0, 1.0) : 0;
+                }
+            }
+            return 1;
+        }
+
+    }
+
+    const char *encodingName(Encoding encoding) {
+        switch (encoding) {
+            case IDENTITY:
+                return "identity";
+            case GZIP:
+                return "gzip";
+            case ZSTD:
+                return "zstd";
+        }
+
+        return "identity";
+    }
+
+    bool available(Encoding encoding) {
+#ifdef CU_SUBMITTER_HAVE_ZSTD
+        (void) encoding;
+        return true;
+#else
+        return encoding != ZSTD;
+#endif
+    }
+
+    Encoding negotiate(std::string_view accept_encoding) {
+        // -1: not listed
+        double gzip_q = -1;
+        double zstd_q = -1;
+        double any_q = -1;
+
+        while (!accept_encoding.empty()) {
+            const size_t end = accept_encoding.find(',');
+            const auto entry = accept_encoding.substr(0, end);
+            accept_encoding = end == std::string_view::npos ? std::string_view() : accept_encoding.substr(end + 1);
+
+            const size_t parameters = entry.find(';');
+            const auto name = trim(entry.substr(0, parameters));
+            const double q = parameters == std::string_view::npos ? 1 : q_value(entry.substr(parameters + 1));
+
+            if (equals_ignore_case(name, "gzip") || equals_ignore_case(name, "x-gzip")) {
+                gzip_q = q;
+            } else if (equals_ignore_case(name, "zstd")) {
+                zstd_q = q;
+            } else if (name == "*") {
+                any_q = q;
+            }
+        }
+
+        if (gzip_q < 0) {
+            gzip_q = std::max(any_q, 0.0);
+        }
+        if (zstd_q < 0 || !available(ZSTD)) {
+            zstd_q = available(ZSTD) ? std::max(any_q, 0.0) : 0;
+        }
+
+        if (zstd_q > 0 && zstd_q >= gzip_q) {
+            return ZSTD;
+        }
+        if (gzip_q > 0) {
+            return GZIP;
+        }
+        return IDENTITY;
+    }
+
+    struct Compressor::State {
+        Encoding encoding_;
+        Sink sink_;
+        std::vector<char> block_ = std::vector<char>(block_size);
+        bool finished_ = false;
+
+        z_stream zlib_{};
+#ifdef CU_SUBMITTER_HAVE_ZSTD
+        ZSTD_CCtx *zstd_ = nullptr;
+#endif
+
+        /**
+         * @brief Compresses input, or ends the stream if finish is set, emptying the block into the sink each time
+         * it is full
+         */
+        void process(std::string_view input, bool finish) {
+            if (encoding_ == GZIP) {
+                zlib_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+                zlib_.avail_in = static_cast<uInt>(input.size());
+
+                int status;
+                do {
+                    zlib_.next_out = reinterpret_cast<Bytef *>(block_.data());
+                    zlib_.avail_out = static_cast<uInt>(block_.size());
+
+                    status = ::deflate(&zlib_, finish ? Z_FINISH : Z_NO_FLUSH);
+                    if (status == Z_STREAM_ERROR) {
+                        throw std::runtime_error("gzip compression failed");
+                    }
+
+                    emit(block_.size() - zlib_.avail_out);
+                } while (zlib_.avail_out == 0 || (finish && status != Z_STREAM_END));
+                return;
+            }
+
+#ifdef CU_SUBMITTER_HAVE_ZSTD
+            ZSTD_inBuffer in{input.data(), input.size(), 0};
+            size_t remaining;
+            do {
+                ZSTD_outBuffer out{block_.data(), block_.size(), 0};
+                remaining = ZSTD_compressStream2(zstd_, &out, &in, finish ? ZSTD_e_end : ZSTD_e_continue);
+                if (ZSTD_isError(remaining)) {
+                    throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(remaining));
+                }
+
+                emit(out.pos);
+            } while (finish ? remaining != 0 : in.pos < in.size);
+#endif
+        }
+
+        void emit(size_t size) {
+            if (size != 0) {
+                sink_(block_.data(), size);
+            }
+        }
+    };
+
+    Compressor::Compressor(Encoding encoding, Sink sink) : state_(std::make_unique<State>()) {
+        if (!available(encoding)) {
+            encoding = IDENTITY;
+        }
+
+        state_->encoding_ = encoding;
+        state_->sink_ = std::move(sink);
+
+        if (encoding == GZIP) {
+            if (deflateInit2(&state_->zlib_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzip_window_bits, 8,
+                             Z_DEFAULT_STRATEGY) != Z_OK) {
+                throw std::runtime_error("Could not initialize gzip compression");
+            }
+        }
+
+#ifdef CU_SUBMITTER_HAVE_ZSTD
+        if (encoding == ZSTD) {
+            state_->zstd_ = ZSTD_createCCtx();
+            if (!state_->zstd_) {
+                throw std::runtime_error("Could not initialize zstd compression");
+            }
+            ZSTD_CCtx_setParameter(state_->zstd_, ZSTD_c_compressionLevel, zstd_level);
+        }
+#endif
+    }
+
+    Compressor::~Compressor() {
+        if (state_->encoding_ == GZIP) {
+            deflateEnd(&state_->zlib_);
+        }
+
+#ifdef CU_SUBMITTER_HAVE_ZSTD
+        ZSTD_freeCCtx(state_->zstd_);
+#endif
+    }
+
+    void Compressor::write(std::string_view data) {
+        if (state_->finished_ || data.empty()) {
+            return;
+        }
+
+        if (state_->encoding_ == IDENTITY) {
+            state_->sink_(data.data(), data.size());
+            return;
+        }
+
+        state_->process(data, false);
+    }
+
+    void Compressor::finish() {
+        if (state_->finished_) {
+            return;
+        }
+        state_->finished_ = true;
+
+        if (state_->encoding_ != IDENTITY) {
+            state_->process({}, true);
+        }
+    }
+
+    std::string compress(std::string_view data, Encoding encoding) {
+        std::string compressed;
+        Compressor compressor(encoding, [&compressed](const char *block, size_t size) {
+            compressed.append(block, size);
+        });
+
+        compressor.write(data);
+        compressor.finish();
+        return compressed;
+    }
+
+    std::string decompress(std::string_view data, Encoding encoding) {
+        std::string decompressed;
+        std::vector<char> block(block_size);
+
+        if (encoding == GZIP) {
+            z_stream zlib{};
+            if (inflateInit2(&zlib, gzip_window_bits) != Z_OK) {
+                throw std::runtime_error("Could not initialize gzip decompression");
+            }
+
+            zlib.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+            zlib.avail_in = static_cast<uInt>(data.size());
+
+            int status;
+            do {
+                zlib.next_out = reinterpret_cast<Bytef *>(block.data());
+                zlib.avail_out = static_cast<uInt>(block.size());
+
+                status = inflate(&zlib, Z_NO_FLUSH);
+                if (status != Z_OK && status != Z_STREAM_END) {
+                    inflateEnd(&zlib);
+                    throw std::runtime_error("Invalid gzip data");
+                }
+
+                decompressed.append(block.data(), block.size() - zlib.avail_out);
+            } while (status != Z_STREAM_END);
+
+            inflateEnd(&zlib);
+            return decompressed;
+        }
+
+#ifdef CU_SUBMITTER_HAVE_ZSTD
+        if (encoding == ZSTD) {
+            ZSTD_DCtx *context = ZSTD_createDCtx();
+            ZSTD_inBuffer in{data.data(), data.size(), 0};
+            size_t status = 0;
+            bool block_full;
+
+            do {
+                ZSTD_outBuffer out{block.data(), block.size(), 0};
+                status = ZSTD_decompressStream(context, &out, &in);
+                if (ZSTD_isError(status)) {
+                    ZSTD_freeDCtx(context);
+                    throw std::runtime_error(std::string("Invalid zstd data: ") + ZSTD_getErrorName(status));
+                }
+
+                decompressed.append(block.data(), out.pos);
+                // a full block may leave decompressed bytes in the context
+                block_full = out.pos == out.size;
+            } while (in.pos < in.size || block_full);
+
+            ZSTD_freeDCtx(context);
+            if (status != 0) {
+                throw std::runtime_error("Truncated zstd data");
+            }
+            return decompressed;
+        }
+#endif
+
+        if (encoding != IDENTITY) {
+            throw std::runtime_error(std::string("Unsupported encoding ") + encodingName(encoding));
+        }
+
+        return std::string(data);
+    }
+
+} // compression
@@ -0,0 +1,90 @@
+#ifndef CU_SUBMITTER_COMPRESSION_H
+#define CU_SUBMITTER_COMPRESSION_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace compression {
+
+    /**
+     * @brief Content encodings of HTTP responses
+     */
+    enum Encoding {
+        IDENTITY,
+        GZIP,
+        ZSTD
+    };
+
+    /**
+     * @brief Bodies smaller than this are not worth compressing
+     */
+    constexpr size_t default_min_size = 1024;
+
+    /**
+     * @return The name of the encoding in the Content-Encoding header
+     */
+    const char *encodingName(Encoding encoding);
+
+    /**
+     * @return Whether the encoding was built in. zstd is only available if libzstd was found at configure time.
+     */
+    bool available(Encoding encoding);
+
+    /**
+     * @brief Chooses the encoding of a response from the Accept-Encoding header of the request
+     * @details q-values are honored and "*" stands for any encoding. zstd is preferred to gzip when both are
+     * accepted with the same q-value.
+     * @return IDENTITY if no available encoding is accepted
+     */
+    Encoding negotiate(std::string_view accept_encoding);
+
+    /**
+     * @brief Compresses a stream, handing the compressed bytes to a sink block by block.
+     * @details The sink is called whenever an output block is full and when the stream is finished, so that a
+     * response can be sent in chunks while it is compressed.
+     */
+    class Compressor {
+    public:
+        using Sink = std::function<void(const char *data, size_t size)>;
+
+        /**
+         * @param encoding GZIP or ZSTD. With IDENTITY, the data is passed through.
+         */
+        Compressor(Encoding encoding, Sink sink);
+
+        ~Compressor();
+
+        Compressor(const Compressor &) = delete;
+
+        Compressor &operator=(const Compressor &) = delete;
+
+        void write(std::string_view data);
+
+        /**
+         * @brief Ends the stream. Nothing can be written afterwards.
+         */
+        void finish();
+
+    private:
+        struct State;
+
+        std::unique_ptr<State> state_;
+    };
+
+    /**
+     * @brief Compresses a whole buffer
+     */
+    std::string compress(std::string_view data, Encoding encoding);
+
+    /**
+     * @brief Decompresses a whole buffer
+     * @throws std::runtime_error if the data is not valid
+     */
+    std::string decompress(std::string_view data, Encoding encoding);
+
+} // compression
+
+#endif //CU_SUBMITTER_COMPRESSION_H
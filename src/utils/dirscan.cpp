@@ -0,0 +1,110 @@
+#include "dirscan.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <future>
+#include <sys/stat.h>
+
+#include "error.h"
+#include "trace.h"
+
+namespace utils {
+
+    const FileEntry *DirectoryListing::find(std::string_view name) const {
+        const auto it = std::lower_bound(begin(entries_), end(entries_), name,
+                                         [](const FileEntry &entry, std::string_view n) {
+                                             return entry.name_ < n;
+                                         });
+
+        if (it == end(entries_) || it->name_ != name) {
+            return nullptr;
+        }
+
+        return &*it;
+    }
+
+    const DirectoryListing &BuildListing::folder(std::string_view name) const {
+        static const DirectoryListing empty;
+
+        const auto it = folders_.find(name);
+        return it != folders_.end() ? it->second : empty;
+    }
+
+    DirectoryListing listDirectory(const std::string &path) {
+        trace::Span span("list", path);
+
+        DirectoryListing listing;
+
+        DIR *dir = opendir(path.c_str());
+        if (dir == nullptr) {
+            if (errno == ENOENT) {
+                error("The specified path does not exist: " + path);
+            } else if (errno == ENOTDIR) {
+                error("The specified path is not a directory: " + path);
+            } else {
+                error("Could not open " + path + ": " + std::strerror(errno));
+            }
+            return listing;
+        }
+
+        listing.exists_ = true;
+        const int dir_fd = dirfd(dir);
+
+        while (const dirent *entry = readdir(dir)) {
+            if (std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+
+            struct stat entry_stat{};
+            if (fstatat(dir_fd, entry->d_name, &entry_stat, 0) != 0) {
+                error("Could not stat " + path + "/" + entry->d_name + ": " + std::strerror(errno));
+                continue;
+            }
+
+            FileEntry file;
+            file.name_ = entry->d_name;
+            file.size_ = static_cast<uint64_t>(entry_stat.st_size);
+            file.mtime_ = static_cast<int64_t>(entry_stat.st_mtim.tv_sec) * 1000000000 + entry_stat.st_mtim.tv_nsec;
+            file.inode_ = static_cast<uint64_t>(entry_stat.st_ino);
+            file.is_directory_ = S_ISDIR(entry_stat.st_mode);
+
+            listing.entries_.push_back(std::move(file));
+        }
+
+        closedir(dir);
+
+        std::sort(begin(listing.entries_), end(listing.entries_), [](const FileEntry &a, const FileEntry &b) {
+            return a.name_ < b.name_;
+        });
+
+        return listing;
+    }
+
+    BuildListing listBuild(const std::string &path, const std::vector<std::string> &folders) {
+        // on network file systems every stat is a round trip, so the folders are listed concurrently
+        std::vector<std::future<DirectoryListing>> pending;
+        pending.reserve(folders.size());
+
+        auto *session = trace::Session::current();
+
+        for (const auto &folder: folders) {
+            pending.push_back(std::async(std::launch::async, [session, folder_path = path + "/" + folder] {
+                trace::Activate activate(session);
+                return listDirectory(folder_path);
+            }));
+        }
+
+        BuildListing listing;
+        listing.root_ = listDirectory(path);
+
+        for (size_t i = 0; i < folders.size(); i++) {
+            listing.folders_[folders[i]] = pending[i].get();
+        }
+
+        return listing;
+    }
+
+} // utils
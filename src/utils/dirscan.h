@@ -0,0 +1,73 @@
+#ifndef CU_SUBMITTER_DIRSCAN_H
+#define CU_SUBMITTER_DIRSCAN_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utils {
+
+    /**
+     * @brief A directory entry and the stat data the diff stages need.
+     */
+    struct FileEntry {
+        std::string name_;
+        uint64_t size_ = 0;
+        /**
+         * @brief Last write time in nanoseconds since the epoch
+         */
+        int64_t mtime_ = 0;
+        uint64_t inode_ = 0;
+        bool is_directory_ = false;
+    };
+
+    /**
+     * @brief Content of a directory, sorted by name.
+     */
+    struct DirectoryListing {
+        std::vector<FileEntry> entries_;
+        /**
+         * @brief False if the directory could not be opened
+         */
+        bool exists_ = false;
+
+        /**
+         * @return The entry with this name, or nullptr if there is none
+         */
+        const FileEntry *find(std::string_view name) const;
+    };
+
+    /**
+     * @brief Listings of the root of a build and of its asset folders.
+     */
+    struct BuildListing {
+        DirectoryListing root_;
+        std::map<std::string, DirectoryListing, std::less<>> folders_;
+
+        /**
+         * @return The listing of a sub folder, empty if it was not listed or does not exist
+         */
+        const DirectoryListing &folder(std::string_view name) const;
+    };
+
+    /**
+     * @brief Lists a directory and stats every entry in the same pass.
+     * @details Entries are stat'ed relative to the open directory, so each one costs a single call
+     * and no path resolution. Subdirectories are not descended into.
+     * @param path The path of the directory
+     * @return The entries of the directory, sorted by name
+     */
+    DirectoryListing listDirectory(const std::string &path);
+
+    /**
+     * @brief Lists the root of a build and the given sub folders, each folder on its own thread.
+     * @param path The root of the build
+     * @param folders Names of the sub folders to list
+     */
+    BuildListing listBuild(const std::string &path, const std::vector<std::string> &folders);
+
+} // utils
+
+#endif //CU_SUBMITTER_DIRSCAN_H
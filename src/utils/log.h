@@ -1,9 +1,17 @@
-#ifndef CU_SUBMITTER_LOG_H
-#define CU_SUBMITTER_LOG_H
-
-#include <iostream>
-#include <string>
-
-void log(const std::string& message);
-
-#endif //CU_SUBMITTER_LOG_H
+#ifndef CU_SUBMITTER_LOG_H
+#define CU_SUBMITTER_LOG_H
+
+#include <iostream>
+#include <string>
+
+/**
+ * @brief Logs an information line. Asynchronous, see logging::write.
+ */
+void log(const std::string& message);
+
+/**
+ * @brief Logs a line that is only written at the debug level, for per-file details.
+ */
+void debug(const std::string& message);
+
+#endif //CU_SUBMITTER_LOG_H
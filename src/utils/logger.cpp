@@ -0,0 +1,368 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace logging {
+
+    namespace {
+
+        using Clock = std::chrono::system_clock;
+
+        struct Record {
+            Level level_ = INFO;
+            Clock::time_point time_;
+            std::string message_;
+        };
+
+        /**
+         * @brief Single producer (the owning thread), single consumer (the writer) ring buffer.
+         */
+        class RecordQueue {
+        public:
+            static constexpr size_t capacity = 1024;
+
+            bool push(Record &record) {
+                const size_t tail = tail_.load(std::memory_order_relaxed);
+                if (tail - head_.load(std::memory_order_acquire) == capacity) {
+                    return false;
+                }
+
+                slots_[tail % capacity] = std::move(record);
+                tail_.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+
+            bool pop(Record &record) {
+                const size_t head = head_.load(std::memory_order_relaxed);
+                if (head == tail_.load(std::memory_order_acquire)) {
+                    return false;
+                }
+
+                record = std::move(slots_[head % capacity]);
+                head_.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            bool empty() const {
+                return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+            }
+
+            /**
+             * @brief Set when the owning thread exits, so that the writer can drop the queue once drained
+             */
+            std::atomic<bool> closed_{false};
+
+        private:
+            std::array<Record, capacity> slots_;
+            alignas(64) std::atomic<size_t> head_{0};
+            alignas(64) std::atomic<size_t> tail_{0};
+        };
+
+        class Backend {
+        public:
+            Backend() {
+                writer_ = std::thread(&Backend::run, this);
+            }
+
+            std::atomic<int> level_{INFO};
+
+            std::shared_ptr<RecordQueue> registerQueue() {
+                auto queue = std::make_shared<RecordQueue>();
+
+                std::lock_guard lock(queues_mutex_);
+                queues_.push_back(queue);
+                return queue;
+            }
+
+            void wake() {
+                if (!pending_.exchange(true, std::memory_order_acq_rel)) {
+                    cv_.notify_one();
+                }
+            }
+
+            void flush() {
+                std::unique_lock lock(mutex_);
+                const uint64_t ticket = ++flush_requested_;
+                pending_.store(true, std::memory_order_release);
+                cv_.notify_one();
+
+                flushed_cv_.wait(lock, [this, ticket] { return flushed_ >= ticket; });
+            }
+
+            bool setFile(const std::string &path, size_t max_size, size_t max_files) {
+                std::lock_guard lock(file_mutex_);
+
+                if (file_) {
+                    std::fclose(file_);
+                }
+
+                file_path_ = path;
+                max_size_ = max_size;
+                max_files_ = max_files;
+                file_ = std::fopen(path.c_str(), "a");
+
+                std::error_code ec;
+                file_size_ = file_ ? static_cast<size_t>(fs::file_size(path, ec)) : 0;
+                if (ec) {
+                    file_size_ = 0;
+                }
+
+                return file_ != nullptr;
+            }
+
+        private:
+            void run() {
+                std::vector<Record> batch;
+                std::vector<std::shared_ptr<RecordQueue>> queues;
+
+                while (true) {
+                    uint64_t ticket;
+                    {
+                        std::unique_lock lock(mutex_);
+                        // the timeout bounds the latency of a wake up lost between the flag and the wait
+                        cv_.wait_for(lock, std::chrono::milliseconds(50), [this] {
+                            return pending_.load(std::memory_order_acquire);
+                        });
+                        pending_.store(false, std::memory_order_release);
+                        ticket = flush_requested_;
+                    }
+
+                    {
+                        std::lock_guard lock(queues_mutex_);
+                        // queues of exited threads are dropped once they have been drained
+                        queues_.erase(std::remove_if(queues_.begin(), queues_.end(), [](const auto &queue) {
+                            return queue->closed_.load(std::memory_order_acquire) && queue->empty();
+                        }), queues_.end());
+                        queues = queues_;
+                    }
+
+                    for (const auto &queue: queues) {
+                        Record record;
+                        while (queue->pop(record)) {
+                            batch.push_back(std::move(record));
+                        }
+                    }
+
+                    // each thread's lines are in order, this interleaves the threads by time
+                    std::stable_sort(batch.begin(), batch.end(), [](const Record &lhs, const Record &rhs) {
+                        return lhs.time_ < rhs.time_;
+                    });
+
+                    writeBatch(batch);
+                    batch.clear();
+
+                    {
+                        std::lock_guard lock(mutex_);
+                        flushed_ = ticket;
+                    }
+                    flushed_cv_.notify_all();
+                }
+            }
+
+            /**
+             * @return "[dd/mm/yyyy - hh:mm:ss] ", computed once per second
+             */
+            const std::string &timestamp(Clock::time_point time) {
+                const std::time_t seconds = Clock::to_time_t(time);
+                if (seconds != cached_second_ || cached_timestamp_.empty()) {
+                    std::tm date{};
+                    localtime_r(&seconds, &date);
+
+                    char buffer[32];
+                    std::strftime(buffer, sizeof(buffer), "[%d/%m/%Y - %H:%M:%S] ", &date);
+
+                    cached_second_ = seconds;
+                    cached_timestamp_ = buffer;
+                }
+
+                return cached_timestamp_;
+            }
+
+            void writeBatch(const std::vector<Record> &batch) {
+                if (batch.empty()) {
+                    return;
+                }
+
+                std::string out;
+                std::string err;
+                std::string file_lines;
+
+                std::lock_guard lock(file_mutex_);
+
+                for (const auto &record: batch) {
+                    std::string line = timestamp(record.time_);
+                    if (record.level_ == ERROR) {
+                        line += "Error: ";
+                    } else if (record.level_ == WARNING) {
+                        line += "Warning: ";
+                    }
+                    line += record.message_;
+                    line += '\n';
+
+                    // keep the order of the lines when both streams go to the same terminal
+                    if (record.level_ == ERROR) {
+                        writeStream(stdout, out);
+                        err += line;
+                    } else {
+                        writeStream(stderr, err);
+                        out += line;
+                    }
+
+                    if (file_) {
+                        file_lines += line;
+                    }
+                }
+
+                writeStream(stdout, out);
+                writeStream(stderr, err);
+
+                if (file_) {
+                    std::fwrite(file_lines.data(), 1, file_lines.size(), file_);
+                    std::fflush(file_);
+                    file_size_ += file_lines.size();
+
+                    if (file_size_ >= max_size_) {
+                        rotate();
+                    }
+                }
+            }
+
+            static void writeStream(std::FILE *stream, std::string &lines) {
+                if (lines.empty()) {
+                    return;
+                }
+
+                std::fwrite(lines.data(), 1, lines.size(), stream);
+                std::fflush(stream);
+                lines.clear();
+            }
+
+            void rotate() {
+                std::fclose(file_);
+
+                std::error_code ec;
+                if (max_files_ == 0) {
+                    fs::remove(file_path_, ec);
+                } else {
+                    fs::remove(file_path_ + "." + std::to_string(max_files_), ec);
+                    for (size_t i = max_files_; i > 1; i--) {
+                        fs::rename(file_path_ + "." + std::to_string(i - 1), file_path_ + "." + std::to_string(i), ec);
+                    }
+                    fs::rename(file_path_, file_path_ + ".1", ec);
+                }
+
+                file_ = std::fopen(file_path_.c_str(), "a");
+                file_size_ = 0;
+            }
+
+            std::mutex mutex_;
+            std::condition_variable cv_;
+            std::condition_variable flushed_cv_;
+            std::atomic<bool> pending_{false};
+            uint64_t flush_requested_ = 0;
+            uint64_t flushed_ = 0;
+
+            std::mutex queues_mutex_;
+            std::vector<std::shared_ptr<RecordQueue>> queues_;
+
+            std::mutex file_mutex_;
+            std::FILE *file_ = nullptr;
+            std::string file_path_;
+            size_t file_size_ = 0;
+            size_t max_size_ = 0;
+            size_t max_files_ = 0;
+
+            std::time_t cached_second_ = 0;
+            std::string cached_timestamp_;
+
+            std::thread writer_;
+        };
+
+        Backend &backend() {
+            // never destroyed, so that threads still logging during static destruction stay safe;
+            // the lines still queued at exit are written by the atexit handler
+            static Backend *instance = [] {
+                auto *created = new Backend();
+                std::atexit([] { logging::flush(); });
+                return created;
+            }();
+            return *instance;
+        }
+
+        /**
+         * @brief Owns the queue of a thread and closes it when the thread exits
+         */
+        struct ThreadQueue {
+            std::shared_ptr<RecordQueue> queue_ = backend().registerQueue();
+
+            ~ThreadQueue() {
+                queue_->closed_.store(true, std::memory_order_release);
+            }
+        };
+
+    }
+
+    bool parseLevel(const std::string &name, Level &level) {
+        if (name == "debug") {
+            level = DEBUG;
+        } else if (name == "info") {
+            level = INFO;
+        } else if (name == "warning") {
+            level = WARNING;
+        } else if (name == "error") {
+            level = ERROR;
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    void setLevel(Level level) {
+        backend().level_.store(level, std::memory_order_relaxed);
+    }
+
+    bool enabled(Level level) {
+        return level >= backend().level_.load(std::memory_order_relaxed);
+    }
+
+    bool setFile(const std::string &path, size_t max_size, size_t max_files) {
+        return backend().setFile(path, max_size, max_files);
+    }
+
+    void write(Level level, std::string message) {
+        if (!enabled(level)) {
+            return;
+        }
+
+        thread_local ThreadQueue thread_queue;
+
+        Record record{level, Clock::now(), std::move(message)};
+
+        while (!thread_queue.queue_->push(record)) {
+            // the writer is behind: hand it the CPU rather than dropping the line
+            backend().wake();
+            std::this_thread::yield();
+        }
+
+        backend().wake();
+    }
+
+    void flush() {
+        backend().flush();
+    }
+
+} // logging
@@ -0,0 +1,60 @@
+#ifndef CU_SUBMITTER_LOGGER_H
+#define CU_SUBMITTER_LOGGER_H
+
+#include <cstddef>
+#include <string>
+
+namespace logging {
+
+    /**
+     * @brief Severity of a log line. Lines below the current level are discarded.
+     */
+    enum Level {
+        DEBUG,
+        INFO,
+        WARNING,
+        ERROR
+    };
+
+    /**
+     * @brief Parses a level name (debug, info, warning, error)
+     * @param name
+     * @param level Set to the parsed level
+     * @return false if the name is not a level name
+     */
+    bool parseLevel(const std::string &name, Level &level);
+
+    /**
+     * @brief Sets the minimum level of the lines that are written. INFO by default.
+     */
+    void setLevel(Level level);
+
+    /**
+     * @return True if lines of this level are written
+     */
+    bool enabled(Level level);
+
+    /**
+     * @brief Also writes every line to a file, rotated when it grows past max_size.
+     * @param path The log file. Rotated files are named path.1 (newest) to path.<max_files>.
+     * @param max_size Size in bytes after which the file is rotated
+     * @param max_files Number of rotated files kept
+     * @return false if the file could not be opened
+     */
+    bool setFile(const std::string &path, size_t max_size = 10 * 1024 * 1024, size_t max_files = 5);
+
+    /**
+     * @brief Queues a line for the background writer.
+     * @details Each thread has its own lock-free queue, so logging never waits on other threads or on the
+     * console. Lines go to stdout, errors to stderr.
+     */
+    void write(Level level, std::string message);
+
+    /**
+     * @brief Blocks until every line queued before the call has been written.
+     */
+    void flush();
+
+} // logging
+
+#endif //CU_SUBMITTER_LOGGER_H
@@ -0,0 +1,166 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace metrics {
+
+    namespace {
+
+        /**
+         * @brief Number of recent samples the quantiles of a phase are computed from
+         */
+        constexpr size_t reservoir_size = 1024;
+
+        struct Phase {
+            uint64_t count_ = 0;
+            double sum_ = 0;
+            /**
+             * @brief Ring buffer of the most recent durations
+             */
+            std::vector<double> recent_;
+            size_t next_ = 0;
+        };
+
+        std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+
+        std::mutex phases_mutex;
+        std::map<std::pair<std::string, std::string>, Phase> phase_table;
+
+        double quantile(const std::vector<double> &sorted, double q) {
+            if (sorted.empty()) {
+                return 0;
+            }
+
+            const auto rank = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+            return sorted[std::min(rank, sorted.size() - 1)];
+        }
+
+        std::string format_double(double value) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+            return buffer;
+        }
+
+        std::string format_labels(const PhaseSummary &summary, const std::string &extra = "") {
+            std::string labels = "{operation=\"" + summary.operation_ + "\",phase=\"" + summary.phase_ + "\"";
+            if (!extra.empty()) {
+                labels += "," + extra;
+            }
+            return labels + "}";
+        }
+
+        void write_counter(std::string &s, const std::string &name, const std::string &help, Counter counter) {
+            s += "# HELP " + name + " " + help + "\n";
+            s += "# TYPE " + name + " counter\n";
+            s += name + " " + std::to_string(value(counter)) + "\n";
+        }
+
+    }
+
+    void add(Counter counter, uint64_t value) {
+        counters[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t value(Counter counter) {
+        return counters[counter].load(std::memory_order_relaxed);
+    }
+
+    void observe(const std::string &operation, const std::string &phase, double seconds) {
+        std::lock_guard lock(phases_mutex);
+
+        auto &entry = phase_table[{operation, phase}];
+        entry.count_++;
+        entry.sum_ += seconds;
+
+        if (entry.recent_.size() < reservoir_size) {
+            entry.recent_.push_back(seconds);
+        } else {
+            entry.recent_[entry.next_] = seconds;
+            entry.next_ = (entry.next_ + 1) % reservoir_size;
+        }
+    }
+
+    std::vector<PhaseSummary> phases() {
+        std::vector<std::pair<PhaseSummary, std::vector<double>>> snapshot;
+
+        {
+            std::lock_guard lock(phases_mutex);
+            for (const auto &[key, entry]: phase_table) {
+                PhaseSummary summary;
+                summary.operation_ = key.first;
+                summary.phase_ = key.second;
+                summary.count_ = entry.count_;
+                summary.sum_ = entry.sum_;
+                snapshot.emplace_back(summary, entry.recent_);
+            }
+        }
+
+        // sorting happens outside of the lock, so that timers are never blocked by a scrape
+        std::vector<PhaseSummary> summaries;
+        for (auto &[summary, recent]: snapshot) {
+            std::sort(recent.begin(), recent.end());
+            summary.p50_ = quantile(recent, 0.50);
+            summary.p95_ = quantile(recent, 0.95);
+            summary.p99_ = quantile(recent, 0.99);
+            summaries.push_back(summary);
+        }
+
+        return summaries;
+    }
+
+    std::string prometheus() {
+        std::string s;
+
+        const std::string duration = "cu_submitter_phase_duration_seconds";
+        s += "# HELP " + duration + " Time spent in each phase of scans, transfers and submissions\n";
+        s += "# TYPE " + duration + " summary\n";
+
+        for (const auto &summary: phases()) {
+            s += duration + format_labels(summary, "quantile=\"0.5\"") + " " + format_double(summary.p50_) + "\n";
+            s += duration + format_labels(summary, "quantile=\"0.95\"") + " " + format_double(summary.p95_) + "\n";
+            s += duration + format_labels(summary, "quantile=\"0.99\"") + " " + format_double(summary.p99_) + "\n";
+            s += duration + "_sum" + format_labels(summary) + " " + format_double(summary.sum_) + "\n";
+            s += duration + "_count" + format_labels(summary) + " " + std::to_string(summary.count_) + "\n";
+        }
+
+        write_counter(s, "cu_submitter_read_bytes_total", "Bytes of game files read to compare or parse them",
+                      BYTES_READ);
+        write_counter(s, "cu_submitter_copied_bytes_total", "Bytes of game files copied by transfers and submissions",
+                      BYTES_COPIED);
+        write_counter(s, "cu_submitter_compared_files_total", "Pairs of files compared byte by byte",
+                      FILES_COMPARED);
+
+        return s;
+    }
+
+    ScopedTimer::ScopedTimer(std::string operation, std::string phase)
+            : operation_(std::move(operation)), phase_(std::move(phase)), start_(std::chrono::steady_clock::now()),
+              session_(trace::Session::current()) {
+    }
+
+    ScopedTimer::~ScopedTimer() {
+        stop();
+    }
+
+    void ScopedTimer::stop() {
+        if (stopped_) {
+            return;
+        }
+        stopped_ = true;
+
+        const auto end = std::chrono::steady_clock::now();
+        const std::chrono::duration<double> elapsed = end - start_;
+        observe(operation_, phase_, elapsed.count());
+
+        if (session_) {
+            session_->record(operation_, phase_, start_, end);
+        }
+    }
+
+} // metrics
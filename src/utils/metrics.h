@@ -0,0 +1,102 @@
+#ifndef CU_SUBMITTER_METRICS_H
+#define CU_SUBMITTER_METRICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+namespace metrics {
+
+    /**
+     * @brief Process-wide counters, exposed as Prometheus counters.
+     */
+    enum Counter {
+        /**
+         * @brief Bytes of game files read to compare or parse them
+         */
+        BYTES_READ,
+        /**
+         * @brief Bytes of game files copied by transfers and submissions
+         */
+        BYTES_COPIED,
+        /**
+         * @brief Pairs of files compared byte by byte
+         */
+        FILES_COMPARED,
+        COUNTER_COUNT
+    };
+
+    /**
+     * @brief Adds to a counter. Lock free.
+     */
+    void add(Counter counter, uint64_t value = 1);
+
+    /**
+     * @return The current value of a counter
+     */
+    uint64_t value(Counter counter);
+
+    /**
+     * @brief Records the duration of one phase of an operation.
+     * @param operation scan, transfer or submit
+     * @param phase Name of the phase within the operation
+     * @param seconds
+     */
+    void observe(const std::string &operation, const std::string &phase, double seconds);
+
+    /**
+     * @brief Aggregated durations of one phase.
+     */
+    struct PhaseSummary {
+        std::string operation_;
+        std::string phase_;
+        uint64_t count_ = 0;
+        double sum_ = 0;
+        double p50_ = 0;
+        double p95_ = 0;
+        double p99_ = 0;
+    };
+
+    /**
+     * @return The summaries of every phase observed so far, sorted by operation and phase
+     */
+    std::vector<PhaseSummary> phases();
+
+    /**
+     * @return Every metric in the Prometheus text exposition format
+     */
+    std::string prometheus();
+
+    /**
+     * @brief Records the time spent in a scope as a phase duration, and as a trace event if the calling
+     * thread is traced.
+     */
+    class ScopedTimer {
+    public:
+        ScopedTimer(std::string operation, std::string phase);
+
+        ~ScopedTimer();
+
+        ScopedTimer(const ScopedTimer &) = delete;
+
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+        /**
+         * @brief Records the phase now instead of at the end of the scope. Later calls do nothing.
+         */
+        void stop();
+
+    private:
+        std::string operation_;
+        std::string phase_;
+        std::chrono::steady_clock::time_point start_;
+        trace::Session *session_;
+        bool stopped_ = false;
+    };
+
+} // metrics
+
+#endif //CU_SUBMITTER_METRICS_H
@@ -1,5 +1,9 @@
 #include "print.h"
 
+#include "logger.h"
+
 void print(const std::string &message) {
+    // queued log lines come first, so that the output reads in order
+    logging::flush();
     std::cout << message << '\n';
 }
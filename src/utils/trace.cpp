@@ -0,0 +1,110 @@
+#include "trace.h"
+
+#include <atomic>
+#include <fstream>
+#include <utility>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+namespace trace {
+
+    namespace {
+
+        thread_local Session *active_session = nullptr;
+
+        /**
+         * @return A small ID for the calling thread, stable for its lifetime
+         */
+        uint32_t thread_id() {
+            static std::atomic<uint32_t> next_id{1};
+            thread_local const uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+
+    }
+
+    Session::Session() : origin_(Clock::now()) {
+    }
+
+    void Session::record(std::string category, std::string name, Clock::time_point start, Clock::time_point end) {
+        Event event;
+        event.category_ = std::move(category);
+        event.name_ = std::move(name);
+        event.start_us_ = std::chrono::duration_cast<std::chrono::microseconds>(start - origin_).count();
+        event.duration_us_ = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        event.thread_id_ = thread_id();
+
+        std::lock_guard lock(mutex_);
+        events_.push_back(std::move(event));
+    }
+
+    std::string Session::json() const {
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+        writer.StartObject();
+        writer.String("displayTimeUnit");
+        writer.String("ms");
+
+        writer.String("traceEvents");
+        writer.StartArray();
+
+        std::lock_guard lock(mutex_);
+        for (const auto &event: events_) {
+            writer.StartObject();
+            writer.String("name");
+            writer.String(event.name_.c_str(), static_cast<rapidjson::SizeType>(event.name_.size()));
+            writer.String("cat");
+            writer.String(event.category_.c_str(), static_cast<rapidjson::SizeType>(event.category_.size()));
+            writer.String("ph");
+            writer.String("X");
+            writer.String("ts");
+            writer.Int64(event.start_us_);
+            writer.String("dur");
+            writer.Int64(event.duration_us_);
+            writer.String("pid");
+            writer.Int(1);
+            writer.String("tid");
+            writer.Uint(event.thread_id_);
+            writer.EndObject();
+        }
+
+        writer.EndArray();
+        writer.EndObject();
+
+        return buffer.GetString();
+    }
+
+    bool Session::write(const std::string &path) const {
+        std::ofstream file(path);
+        file << json();
+        return static_cast<bool>(file);
+    }
+
+    Session *Session::current() {
+        return active_session;
+    }
+
+    Activate::Activate(Session *session) : previous_(active_session) {
+        active_session = session;
+    }
+
+    Activate::~Activate() {
+        active_session = previous_;
+    }
+
+    Span::Span(const char *category, std::string name)
+            : session_(active_session), category_(category) {
+        if (session_) {
+            name_ = std::move(name);
+            start_ = Clock::now();
+        }
+    }
+
+    Span::~Span() {
+        if (session_) {
+            session_->record(category_, std::move(name_), start_, Clock::now());
+        }
+    }
+
+} // trace
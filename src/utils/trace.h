@@ -0,0 +1,109 @@
+#ifndef CU_SUBMITTER_TRACE_H
+#define CU_SUBMITTER_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace trace {
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief A complete (begin + duration) trace event.
+     */
+    struct Event {
+        std::string category_;
+        std::string name_;
+        /**
+         * @brief Start, in microseconds since the start of the session
+         */
+        int64_t start_us_ = 0;
+        int64_t duration_us_ = 0;
+        uint32_t thread_id_ = 0;
+    };
+
+    /**
+     * @brief Collects the events of one traced scan, transfer or submission.
+     * @details Events are only recorded on threads where the session is active (see Activate), so that
+     * concurrent untraced requests do not show up in the trace.
+     */
+    class Session {
+    public:
+        Session();
+
+        /**
+         * @brief Records an event. Thread safe.
+         */
+        void record(std::string category, std::string name, Clock::time_point start, Clock::time_point end);
+
+        /**
+         * @return The events in the Chrome trace event format, viewable in Perfetto or chrome://tracing
+         */
+        std::string json() const;
+
+        /**
+         * @brief Writes the trace in the Chrome trace event format
+         * @return false if the file could not be written
+         */
+        bool write(const std::string &path) const;
+
+        /**
+         * @return The session active on the calling thread, or nullptr if the thread is not traced
+         */
+        static Session *current();
+
+    private:
+        Clock::time_point origin_;
+
+        mutable std::mutex mutex_;
+        std::vector<Event> events_;
+    };
+
+    /**
+     * @brief Makes a session the active one on the calling thread until the end of the scope.
+     * @details Worker threads started by a traced operation must activate the session of their parent.
+     */
+    class Activate {
+    public:
+        /**
+         * @param session May be null, which deactivates tracing for the scope
+         */
+        explicit Activate(Session *session);
+
+        ~Activate();
+
+        Activate(const Activate &) = delete;
+
+        Activate &operator=(const Activate &) = delete;
+
+    private:
+        Session *previous_;
+    };
+
+    /**
+     * @brief Records the time spent in a scope as an event of the active session. Does nothing if the
+     * calling thread is not traced.
+     */
+    class Span {
+    public:
+        Span(const char *category, std::string name);
+
+        ~Span();
+
+        Span(const Span &) = delete;
+
+        Span &operator=(const Span &) = delete;
+
+    private:
+        Session *session_;
+        const char *category_;
+        std::string name_;
+        Clock::time_point start_;
+    };
+
+} // trace
+
+#endif //CU_SUBMITTER_TRACE_H
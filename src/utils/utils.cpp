@@ -1,37 +1,236 @@
 #include "utils.h"
 
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "metrics.h"
+#include "trace.h"
 
 namespace utils {
 
+    namespace {
+
+        /**
+         * @brief Closes a file descriptor when it goes out of scope
+         */
+        struct FileDescriptor {
+            int fd_ = -1;
+
+            explicit FileDescriptor(int fd) : fd_(fd) {
+            }
+
+            FileDescriptor(FileDescriptor &&other) noexcept : fd_(other.fd_) {
+                other.fd_ = -1;
+            }
+
+            FileDescriptor(const FileDescriptor &) = delete;
+
+            FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+            FileDescriptor &operator=(FileDescriptor &&) = delete;
+
+            ~FileDescriptor() {
+                if (fd_ >= 0) {
+                    ::close(fd_);
+                }
+            }
+        };
+
+        bool write_all(int fd, const char *data, size_t size) {
+            while (size > 0) {
+                const ssize_t written = ::write(fd, data, size);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+        [[noreturn]] void throw_copy_error(const fs::path &from, const fs::path &to) {
+            throw fs::filesystem_error("Could not copy file", from, to, std::error_code(errno, std::generic_category()));
+        }
+
+    }
+
     bool compareFiles(const std::string& path1, const std::string& path2) {
-        std::ifstream img1(path1, std::ios::binary);
-        std::ifstream img2(path2, std::ios::binary);
+        std::ifstream file1(path1, std::ios::binary | std::ios::ate);
+        std::ifstream file2(path2, std::ios::binary | std::ios::ate);
 
-        if (!img1.is_open() || !img2.is_open()) {
-            error("Could not open image file " + (img1.is_open() ? path1 : path2) + " for comparison");
+        if (!file1.is_open() || !file2.is_open()) {
+            error("Could not open file " + (file1.is_open() ? path2 : path1) + " for comparison");
             return false;
         }
 
-        img1.seekg(0, std::ios::end);
-        img2.seekg(0, std::ios::end);
+        if (file1.tellg() != file2.tellg()) {
+            return false;
+        }
 
-        const auto img1_size = img1.tellg();
-        const auto img2_size = img2.tellg();
+        metrics::add(metrics::FILES_COMPARED);
 
-        if (img1_size != img2_size) {
-            return false;
+        file1.seekg(0, std::ios::beg);
+        file2.seekg(0, std::ios::beg);
+
+        // Compare block by block so that we stop reading at the first difference
+        // and never hold more than two blocks in memory
+        constexpr std::streamsize block_size = 64 * 1024;
+        std::vector<char> block1(block_size);
+        std::vector<char> block2(block_size);
+
+        while (file1 && file2) {
+            file1.read(block1.data(), block_size);
+            file2.read(block2.data(), block_size);
+
+            const auto read1 = file1.gcount();
+            const auto read2 = file2.gcount();
+            metrics::add(metrics::BYTES_READ, static_cast<uint64_t>(read1 + read2));
+
+            if (read1 != read2 || std::memcmp(block1.data(), block2.data(), static_cast<size_t>(read1)) != 0) {
+                return false;
+            }
+
+            if (read1 == 0) {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    void copyFile(const fs::path& from, const fs::path& to, fs::copy_options options) {
+        trace::Span span("copy", from.filename().string());
+
+        fs::copy(from, to, options);
+
+        std::error_code ec;
+        const auto size = fs::file_size(from, ec);
+        if (!ec) {
+            metrics::add(metrics::BYTES_COPIED, size);
+        }
+    }
+
+    void copyFileToMany(const fs::path& from, const std::vector<fs::path>& to) {
+        trace::Span span("copy", from.filename().string());
+
+        const FileDescriptor source(::open(from.c_str(), O_RDONLY | O_CLOEXEC));
+        struct stat source_stat{};
+        if (source.fd_ < 0 || ::fstat(source.fd_, &source_stat) != 0) {
+            throw_copy_error(from, to.empty() ? fs::path() : to.front());
+        }
+
+        uint64_t copied = 0;
+        std::vector<FileDescriptor> pending;
+        std::vector<const fs::path *> pending_paths;
+
+        for (const auto &destination: to) {
+            FileDescriptor file(::open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                       source_stat.st_mode & 07777));
+            if (file.fd_ < 0) {
+                throw_copy_error(from, destination);
+            }
+
+#ifdef FICLONE
+            if (::ioctl(file.fd_, FICLONE, source.fd_) == 0) {
+                copied += static_cast<uint64_t>(source_stat.st_size);
+                continue;
+            }
+#endif
+
+            pending.push_back(std::move(file));
+            pending_paths.push_back(&destination);
+        }
+
+        if (!pending.empty()) {
+            constexpr size_t block_size = 256 * 1024;
+            std::vector<char> block(block_size);
+
+            for (;;) {
+                const ssize_t read = ::read(source.fd_, block.data(), block.size());
+                if (read < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw_copy_error(from, *pending_paths.front());
+                }
+                if (read == 0) {
+                    break;
+                }
+
+                metrics::add(metrics::BYTES_READ, static_cast<uint64_t>(read));
+
+                for (size_t i = 0; i < pending.size(); i++) {
+                    if (!write_all(pending[i].fd_, block.data(), static_cast<size_t>(read))) {
+                        throw_copy_error(from, *pending_paths[i]);
+                    }
+                }
+                copied += static_cast<uint64_t>(read) * pending.size();
+            }
+        }
+
+        metrics::add(metrics::BYTES_COPIED, copied);
+    }
+
+    CloneMethod cloneFile(const fs::path& from, const fs::path& to, bool allow_hardlink) {
+        const FileDescriptor source(::open(from.c_str(), O_RDONLY | O_CLOEXEC));
+        struct stat source_stat{};
+        if (source.fd_ < 0 || ::fstat(source.fd_, &source_stat) != 0) {
+            throw_copy_error(from, to);
+        }
+
+        {
+            const FileDescriptor destination(::open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                                                    source_stat.st_mode & 07777));
+            if (destination.fd_ < 0) {
+                throw_copy_error(from, to);
+            }
+
+#ifdef FICLONE
+            if (::ioctl(destination.fd_, FICLONE, source.fd_) == 0) {
+                const struct timespec times[2] = {source_stat.st_atim, source_stat.st_mtim};
+                ::futimens(destination.fd_, times);
+                return CloneMethod::REFLINK;
+            }
+#endif
+        }
+
+        if (allow_hardlink) {
+            // the empty file created for the clone is replaced by the link
+            std::error_code ec;
+            fs::remove(to, ec);
+            fs::create_hard_link(from, to, ec);
+            if (!ec) {
+                return CloneMethod::HARDLINK;
+            }
         }
 
-        img1.seekg(0, std::ios::beg);
-        img2.seekg(0, std::ios::beg);
+        fs::copy_file(from, to, fs::copy_options::overwrite_existing);
+        metrics::add(metrics::BYTES_COPIED, static_cast<uint64_t>(source_stat.st_size));
 
-        std::vector<char> img1_data(img1_size);
-        std::vector<char> img2_data(img2_size);
+        // the scans tell unchanged files by their last write time
+        const struct timespec times[2] = {source_stat.st_atim, source_stat.st_mtim};
+        ::utimensat(AT_FDCWD, to.c_str(), times, 0);
 
-        img1.read(img1_data.data(), img1_size);
-        img2.read(img2_data.data(), img2_size);
+        return CloneMethod::COPY;
+    }
+
+    uint64_t hashBytes(const char* data, size_t size, uint64_t seed) {
+        uint64_t hash = seed;
+
+        for (size_t i = 0; i < size; i++) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 0x100000001b3ULL;
+        }
 
-        return img1_data == img2_data;
+        return hash;
     }
 
 }
\ No newline at end of file
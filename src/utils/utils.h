@@ -5,9 +5,13 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <cstdint>
+#include <filesystem>
 
 #include "error.h"
 
+namespace fs = std::filesystem;
+
 namespace utils {
 
     /**
@@ -18,6 +22,58 @@ namespace utils {
      */
     bool compareFiles(const std::string& path1, const std::string& path2);
 
+    /**
+     * @brief Copies a file like fs::copy, and counts the copied bytes.
+     * @param from
+     * @param to The destination file, or an existing directory to copy into
+     * @param options
+     * @throws fs::filesystem_error like fs::copy
+     */
+    void copyFile(const fs::path& from, const fs::path& to, fs::copy_options options = fs::copy_options::none);
+
+    /**
+     * @brief Copies a file to several destinations, reading it once.
+     * @details Each destination is first cloned from the source where the filesystem supports it (FICLONE on btrfs
+     * or xfs), which shares its blocks instead of copying them. The source is then read once in blocks, each block
+     * being written to every destination that could not be cloned. Existing destinations are overwritten.
+     * @param from
+     * @param to The destination files
+     * @throws fs::filesystem_error if the source cannot be read or a destination cannot be written
+     */
+    void copyFileToMany(const fs::path& from, const std::vector<fs::path>& to);
+
+    /**
+     * @brief How cloneFile made a copy
+     */
+    enum class CloneMethod {
+        REFLINK,
+        HARDLINK,
+        COPY
+    };
+
+    /**
+     * @brief Makes a copy of a file that is as cheap as the filesystem allows, keeping its permissions and last
+     * write time.
+     * @details The file is first cloned (FICLONE on btrfs or xfs), which shares its blocks until one of the copies is
+     * written. Otherwise it is hard linked if allowed, which shares the file itself: writing to one writes to the
+     * other. Otherwise it is copied.
+     * @param from
+     * @param to The destination file, which must not exist
+     * @param allow_hardlink
+     * @return How the copy was made
+     * @throws fs::filesystem_error if the file cannot be copied
+     */
+    CloneMethod cloneFile(const fs::path& from, const fs::path& to, bool allow_hardlink = false);
+
+    /**
+     * @brief Computes a 64 bit FNV-1a digest of a buffer.
+     * @param data
+     * @param size
+     * @param seed Digest of the previous data, to hash a content in several parts.
+     * @return The digest of the content.
+     */
+    uint64_t hashBytes(const char* data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL);
+
 } // utils
 
 #endif //CU_SUBMITTER_UTILS_H
@@ -0,0 +1,473 @@
+#include "zip.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "error.h"
+#include "metrics.h"
+#include "trace.h"
+
+namespace utils {
+
+    namespace {
+
+        constexpr uint32_t local_header_signature = 0x04034b50;
+        constexpr uint32_t central_header_signature = 0x02014b50;
+        constexpr uint32_t end_signature = 0x06054b50;
+        constexpr uint32_t zip64_end_signature = 0x06064b50;
+        constexpr uint32_t zip64_locator_signature = 0x07064b50;
+
+        constexpr size_t local_header_size = 30;
+        constexpr size_t central_header_size = 46;
+        constexpr size_t end_size = 22;
+        constexpr size_t zip64_end_size = 56;
+        constexpr size_t zip64_locator_size = 20;
+        /**
+         * @brief The end of central directory record is followed by a comment of at most 65535 bytes
+         */
+        constexpr size_t max_end_search = end_size + 0xFFFF;
+        constexpr size_t short_end_search = end_size + 1024;
+
+        constexpr uint16_t zip64_extra_id = 0x0001;
+        constexpr uint16_t encrypted_flag = 0x0001;
+
+        constexpr uint16_t method_stored = 0;
+        constexpr uint16_t method_deflated = 8;
+
+        constexpr size_t block_size = 256 * 1024;
+
+        /**
+         * @brief Most memory reserved up front for an entry read in memory. The recorded size comes from the archive
+         * and may be anything; larger entries grow their buffer as they are inflated.
+         */
+        constexpr size_t max_reserved_size = 16 * 1024 * 1024;
+
+        uint16_t read16(const char *data) {
+            const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+            return static_cast<uint16_t>(bytes[0] | bytes[1] << 8);
+        }
+
+        uint32_t read32(const char *data) {
+            return read16(data) | static_cast<uint32_t>(read16(data + 2)) << 16;
+        }
+
+        uint64_t read64(const char *data) {
+            return read32(data) | static_cast<uint64_t>(read32(data + 4)) << 32;
+        }
+
+        std::string lower(std::string_view name) {
+            std::string lowered(name);
+            std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+            return lowered;
+        }
+
+        [[noreturn]] void throw_entry_error(const ZipEntry &entry, const std::string &reason) {
+            throw std::runtime_error("Could not read " + entry.name_ + " from the archive: " + reason);
+        }
+
+        /**
+         * @brief Reads the 64 bit sizes and offset of a central directory header from its ZIP64 extra field
+         */
+        bool read_zip64_extra(ZipEntry &entry, const char *extra, size_t extra_size) {
+            size_t position = 0;
+            while (position + 4 <= extra_size) {
+                const uint16_t id = read16(extra + position);
+                const uint16_t size = read16(extra + position + 2);
+                position += 4;
+                if (position + size > extra_size) {
+                    return false;
+                }
+
+                if (id == zip64_extra_id) {
+                    // only the fields that did not fit in 32 bits are present, in this order
+                    const char *field = extra + position;
+                    const char *end = field + size;
+                    for (uint64_t *value: {&entry.size_, &entry.compressed_size_, &entry.local_header_offset_}) {
+                        if (*value != 0xFFFFFFFF) {
+                            continue;
+                        }
+                        if (field + 8 > end) {
+                            return false;
+                        }
+                        *value = read64(field);
+                        field += 8;
+                    }
+                    return true;
+                }
+
+                position += size;
+            }
+            return true;
+        }
+
+    }
+
+    std::unique_ptr<ZipArchive> ZipArchive::open(const fs::path &path) {
+        std::unique_ptr<ZipArchive> archive(new ZipArchive());
+        archive->path_ = path;
+
+        archive->fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat archive_stat{};
+        if (archive->fd_ < 0 || ::fstat(archive->fd_, &archive_stat) != 0) {
+            error("Could not open " + path.string());
+            return nullptr;
+        }
+        archive->size_ = static_cast<uint64_t>(archive_stat.st_size);
+
+        if (!archive->readCentralDirectory()) {
+            error(path.string() + " is not a valid ZIP archive");
+            return nullptr;
+        }
+
+        return archive;
+    }
+
+    ZipArchive::~ZipArchive() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    bool ZipArchive::readAt(uint64_t offset, char *data, size_t size) const {
+        while (size > 0) {
+            const ssize_t read = ::pread(fd_, data, size, static_cast<off_t>(offset));
+            if (read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (read <= 0) {
+                return false;
+            }
+            data += read;
+            size -= static_cast<size_t>(read);
+            offset += static_cast<uint64_t>(read);
+        }
+        return true;
+    }
+
+    bool ZipArchive::readCentralDirectory() {
+        if (size_ < end_size) {
+            return false;
+        }
+
+        // the record is found from the end, as the comment after it may be of any size; archives rarely have a
+        // long comment, so a short tail is read first
+        std::string tail;
+        uint64_t tail_offset = 0;
+        size_t end_position = std::string::npos;
+        for (const size_t search: {short_end_search, max_end_search}) {
+            const size_t tail_size = static_cast<size_t>(std::min<uint64_t>(size_, search));
+            tail_offset = size_ - tail_size;
+            tail.assign(tail_size, '\0');
+            if (!readAt(tail_offset, tail.data(), tail_size)) {
+                return false;
+            }
+            metrics::add(metrics::BYTES_READ, tail_size);
+
+            for (size_t position = tail_size - end_size + 1; position-- > 0;) {
+                if (read32(tail.data() + position) == end_signature) {
+                    end_position = position;
+                    break;
+                }
+            }
+            if (end_position != std::string::npos || tail_size == size_) {
+                break;
+            }
+        }
+        if (end_position == std::string::npos) {
+            return false;
+        }
+
+        const char *end = tail.data() + end_position;
+        uint64_t entry_count = read16(end + 10);
+        uint64_t directory_size = read32(end + 12);
+        uint64_t directory_offset = read32(end + 16);
+
+        if (entry_count == 0xFFFF || directory_size == 0xFFFFFFFF || directory_offset == 0xFFFFFFFF) {
+            // ZIP64: the real values are in a record pointed to by a locator right before this one
+            const uint64_t end_offset = tail_offset + end_position;
+            if (end_offset < zip64_locator_size) {
+                return false;
+            }
+
+            char locator[zip64_locator_size];
+            if (!readAt(end_offset - zip64_locator_size, locator, sizeof(locator)) ||
+                read32(locator) != zip64_locator_signature) {
+                return false;
+            }
+
+            char zip64_end[zip64_end_size];
+            if (!readAt(read64(locator + 8), zip64_end, sizeof(zip64_end)) ||
+                read32(zip64_end) != zip64_end_signature) {
+                return false;
+            }
+
+            entry_count = read64(zip64_end + 32);
+            directory_size = read64(zip64_end + 40);
+            directory_offset = read64(zip64_end + 48);
+        }
+
+        if (directory_offset > size_ || directory_size > size_ - directory_offset) {
+            return false;
+        }
+
+        trace::Span span("zip", "central directory");
+
+        std::string directory(static_cast<size_t>(directory_size), '\0');
+        if (!readAt(directory_offset, directory.data(), directory.size())) {
+            return false;
+        }
+        metrics::add(metrics::BYTES_READ, directory_size);
+
+        entries_.reserve(static_cast<size_t>(std::min<uint64_t>(entry_count, directory_size / central_header_size)));
+
+        size_t position = 0;
+        for (uint64_t i = 0; i < entry_count; i++) {
+            if (position + central_header_size > directory.size()) {
+                return false;
+            }
+
+            const char *header = directory.data() + position;
+            if (read32(header) != central_header_signature) {
+                return false;
+            }
+
+            const size_t name_size = read16(header + 28);
+            const size_t extra_size = read16(header + 30);
+            const size_t comment_size = read16(header + 32);
+            if (position + central_header_size + name_size + extra_size + comment_size > directory.size()) {
+                return false;
+            }
+
+            ZipEntry entry;
+            entry.flags_ = read16(header + 8);
+            entry.method_ = read16(header + 10);
+            entry.crc32_ = read32(header + 16);
+            entry.compressed_size_ = read32(header + 20);
+            entry.size_ = read32(header + 24);
+            entry.local_header_offset_ = read32(header + 42);
+            entry.name_.assign(header + central_header_size, name_size);
+
+            if (!read_zip64_extra(entry, header + central_header_size + name_size, extra_size)) {
+                return false;
+            }
+
+            // archives made on Windows may use backslashes
+            std::replace(entry.name_.begin(), entry.name_.end(), '\\', '/');
+
+            index_.emplace(lower(entry.name_), entries_.size());
+            entries_.push_back(std::move(entry));
+
+            position += central_header_size + name_size + extra_size + comment_size;
+        }
+
+        return true;
+    }
+
+    const ZipEntry *ZipArchive::find(std::string_view name) const {
+        const auto found = index_.find(lower(name));
+        return found == index_.end() ? nullptr : &entries_[found->second];
+    }
+
+    void ZipArchive::read(const ZipEntry &entry, const Sink &sink) const {
+        if (entry.flags_ & encrypted_flag) {
+            throw_entry_error(entry, "encrypted entries are not supported");
+        }
+        if (entry.method_ != method_stored && entry.method_ != method_deflated) {
+            throw_entry_error(entry, "unsupported compression method " + std::to_string(entry.method_));
+        }
+
+        // the sizes of the local header may be left out, only its name and extra field sizes are needed
+        char local_header[local_header_size];
+        if (!readAt(entry.local_header_offset_, local_header, sizeof(local_header)) ||
+            read32(local_header) != local_header_signature) {
+            throw_entry_error(entry, "invalid local header");
+        }
+
+        uint64_t offset = entry.local_header_offset_ + local_header_size + read16(local_header + 26) +
+                          read16(local_header + 28);
+        if (offset > size_ || entry.compressed_size_ > size_ - offset) {
+            throw_entry_error(entry, "truncated archive");
+        }
+
+        z_stream stream{};
+        if (entry.method_ == method_deflated && inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            throw_entry_error(entry, "could not initialize zlib");
+        }
+
+        std::vector<char> input(block_size);
+        std::vector<char> output(entry.method_ == method_deflated ? block_size : 0);
+
+        uLong crc = crc32(0, nullptr, 0);
+        uint64_t remaining = entry.compressed_size_;
+        uint64_t produced = 0;
+        bool finished = entry.method_ == method_stored;
+
+        // stops as soon as the entry outgrows its recorded size, rather than inflating a ZIP bomb to the end
+        const auto consume = [&](const char *data, size_t size) {
+            produced += size;
+            if (produced > entry.size_) {
+                throw_entry_error(entry, "larger than its recorded size");
+            }
+            crc = crc32(crc, reinterpret_cast<const Bytef *>(data), static_cast<uInt>(size));
+            sink(data, size);
+        };
+
+        try {
+            while (remaining > 0) {
+                const size_t size = static_cast<size_t>(std::min<uint64_t>(remaining, input.size()));
+                if (!readAt(offset, input.data(), size)) {
+                    throw_entry_error(entry, "truncated archive");
+                }
+                offset += size;
+                remaining -= size;
+                metrics::add(metrics::BYTES_READ, size);
+
+                if (entry.method_ == method_stored) {
+                    consume(input.data(), size);
+                    continue;
+                }
+
+                stream.next_in = reinterpret_cast<Bytef *>(input.data());
+                stream.avail_in = static_cast<uInt>(size);
+                while (stream.avail_in > 0 && !finished) {
+                    stream.next_out = reinterpret_cast<Bytef *>(output.data());
+                    stream.avail_out = static_cast<uInt>(output.size());
+
+                    const int status = inflate(&stream, Z_NO_FLUSH);
+                    if (status != Z_OK && status != Z_STREAM_END) {
+                        throw_entry_error(entry, "corrupted data");
+                    }
+
+                    consume(output.data(), output.size() - stream.avail_out);
+
+                    finished = status == Z_STREAM_END;
+                }
+            }
+
+            // the last block may end with output still buffered in zlib
+            while (!finished) {
+                stream.next_out = reinterpret_cast<Bytef *>(output.data());
+                stream.avail_out = static_cast<uInt>(output.size());
+
+                const int status = inflate(&stream, Z_FINISH);
+                const size_t inflated = output.size() - stream.avail_out;
+                if (status != Z_STREAM_END && (inflated == 0 || (status != Z_OK && status != Z_BUF_ERROR))) {
+                    throw_entry_error(entry, "truncated data");
+                }
+
+                consume(output.data(), inflated);
+
+                finished = status == Z_STREAM_END;
+            }
+        } catch (...) {
+            if (entry.method_ == method_deflated) {
+                inflateEnd(&stream);
+            }
+            throw;
+        }
+
+        if (entry.method_ == method_deflated) {
+            inflateEnd(&stream);
+        }
+
+        if (produced != entry.size_ || crc != entry.crc32_) {
+            throw_entry_error(entry, "CRC or size mismatch");
+        }
+    }
+
+    std::string ZipArchive::read(const ZipEntry &entry) const {
+        std::string content;
+        content.reserve(static_cast<size_t>(std::min<uint64_t>(entry.size_, max_reserved_size)));
+        read(entry, [&content](const char *data, size_t size) {
+            content.append(data, size);
+        });
+        return content;
+    }
+
+    void ZipArchive::extract(const ZipEntry &entry, const std::vector<fs::path> &to) const {
+        trace::Span span("extract", entry.name_);
+
+        // each entry is written next to its destination and only renamed over it once its CRC-32 matched, so that a
+        // corrupted archive leaves the destinations as they were
+        std::vector<fs::path> partial;
+        partial.reserve(to.size());
+        for (const auto &path: to) {
+            partial.push_back(fs::path(path).concat(".cu_partial"));
+        }
+
+        std::vector<int> files;
+        const auto close_files = [&files]() {
+            for (const int fd: files) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+        };
+        const auto remove_partial = [&partial]() {
+            for (const auto &path: partial) {
+                std::error_code ec;
+                fs::remove(path, ec);
+            }
+        };
+
+        const auto write_error = [&to](size_t i) {
+            return fs::filesystem_error("Could not write file", to[i], std::error_code(errno, std::generic_category()));
+        };
+
+        try {
+            for (size_t i = 0; i < to.size(); i++) {
+                const int fd = ::open(partial[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                if (fd < 0) {
+                    throw write_error(i);
+                }
+                files.push_back(fd);
+            }
+
+            read(entry, [&](const char *data, size_t size) {
+                for (size_t i = 0; i < files.size(); i++) {
+                    const char *remaining = data;
+                    size_t remaining_size = size;
+                    while (remaining_size > 0) {
+                        const ssize_t written = ::write(files[i], remaining, remaining_size);
+                        if (written < 0 && errno == EINTR) {
+                            continue;
+                        }
+                        if (written < 0) {
+                            throw write_error(i);
+                        }
+                        remaining += written;
+                        remaining_size -= static_cast<size_t>(written);
+                    }
+                }
+            });
+
+            // the last write errors of some filesystems are only reported on close
+            for (size_t i = 0; i < files.size(); i++) {
+                const int fd = files[i];
+                files[i] = -1;
+                if (::close(fd) != 0) {
+                    throw write_error(i);
+                }
+            }
+
+            for (size_t i = 0; i < to.size(); i++) {
+                fs::rename(partial[i], to[i]);
+            }
+        } catch (...) {
+            close_files();
+            remove_partial();
+            throw;
+        }
+
+        metrics::add(metrics::BYTES_COPIED, entry.size_ * to.size());
+    }
+
+} // utils
@@ -0,0 +1,127 @@
+#ifndef CU_SUBMITTER_ZIP_H
+#define CU_SUBMITTER_ZIP_H
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace utils {
+
+    /**
+     * @brief A file of a ZIP archive, as listed in its central directory
+     */
+    struct ZipEntry {
+        /**
+         * @brief Path of the file in the archive, with '/' separators
+         */
+        std::string name_;
+        /**
+         * @brief 0 for stored files, 8 for deflated files
+         */
+        uint16_t method_ = 0;
+        uint16_t flags_ = 0;
+        uint32_t crc32_ = 0;
+        uint64_t compressed_size_ = 0;
+        uint64_t size_ = 0;
+        uint64_t local_header_offset_ = 0;
+
+        bool isDirectory() const {
+            return !name_.empty() && name_.back() == '/';
+        }
+    };
+
+    /**
+     * @brief Reads the files of a ZIP archive in place.
+     * @details Opening an archive only reads its central directory, at the end of the file. Entries are then
+     * read one by one where they are stored, inflated as they are read: nothing is extracted to a temporary folder.
+     * Stored and deflated entries are supported, in ZIP and ZIP64 archives; encrypted entries are not.
+     */
+    class ZipArchive {
+    public:
+        using Sink = std::function<void(const char *data, size_t size)>;
+
+        /**
+         * @brief Opens an archive and reads its central directory
+         * @return nullptr if the file cannot be read or is not a ZIP archive
+         */
+        static std::unique_ptr<ZipArchive> open(const fs::path &path);
+
+        ~ZipArchive();
+
+        ZipArchive(const ZipArchive &) = delete;
+
+        ZipArchive &operator=(const ZipArchive &) = delete;
+
+        const fs::path &path() const {
+            return path_;
+        }
+
+        /**
+         * @return Every entry, in central directory order
+         */
+        const std::vector<ZipEntry> &entries() const {
+            return entries_;
+        }
+
+        /**
+         * @brief Finds an entry by path. Case is ignored, like the game does on Windows.
+         * @return nullptr if there is no such entry
+         */
+        const ZipEntry *find(std::string_view name) const;
+
+        /**
+         * @brief Hands the content of an entry to a sink, block by block, and checks its CRC-32
+         * @throws std::runtime_error if the entry cannot be read, is corrupted or uses an unsupported compression
+         */
+        void read(const ZipEntry &entry, const Sink &sink) const;
+
+        /**
+         * @return The content of an entry
+         * @throws std::runtime_error like read
+         */
+        std::string read(const ZipEntry &entry) const;
+
+        /**
+         * @brief Writes an entry to several files, reading and inflating it once
+         * @details Each file is written to a temporary file next to it, renamed over it once the CRC-32 of the
+         * entry matched: an entry that cannot be read leaves the destinations untouched.
+         * @param to The destination files. Existing files are overwritten.
+         * @throws std::runtime_error like read, fs::filesystem_error if a destination cannot be written
+         */
+        void extract(const ZipEntry &entry, const std::vector<fs::path> &to) const;
+
+    private:
+        ZipArchive() = default;
+
+        /**
+         * @brief Finds the end of central directory record and reads every central directory header
+         */
+        bool readCentralDirectory();
+
+        /**
+         * @brief Reads exactly size bytes at offset
+         * @return false if the file is shorter
+         */
+        bool readAt(uint64_t offset, char *data, size_t size) const;
+
+        fs::path path_;
+        int fd_ = -1;
+        uint64_t size_ = 0;
+
+        std::vector<ZipEntry> entries_;
+        /**
+         * @brief Position in entries_ of every lower case entry name
+         */
+        std::unordered_map<std::string, size_t> index_;
+    };
+
+} // utils
+
+#endif //CU_SUBMITTER_ZIP_H